@@ -56,7 +56,6 @@ void
 display_ports(const struct ports_t *ports, const struct options_t *opts)
 {
 	struct vector_iterator_t	vi;
-	struct port_t			*port;
 	char				*filename;
 	int				rawfiles_is_on;
 	int				show_portpath;
@@ -71,19 +70,18 @@ display_ports(const struct ports_t *ports, const struct options_t *opts)
 	ports_cnt = 0;
 	files_cnt = 0;
 	for (i = 0; i < ports->sz; i++)
-		if (ports->arr[i]->matched == opts->search_crit)
+		if (ports->matched[i] == opts->search_crit)
 		{
 			ports_cnt++;
 
-			port = ports->arr[i];
-
 			if (rawfiles_is_on)
 			{
-				vi_reset(&vi, &port->plist);
+				vi_reset(&vi, &ports->plists[i]);
 				while (vi_next(&vi, (void **)&filename))
 				{
 					if (show_portpath)
-						printf("%s:", port->path);
+						printf("%s:",
+						       PORT_FLD(ports, i, PF_PATH));
 					printf("%s\n", filename);
 				}
 				continue;
@@ -93,44 +91,55 @@ display_ports(const struct ports_t *ports, const struct options_t *opts)
 				switch (opts->outflds_parsed[ii])
 				{
 				case DISP_NAME:
-					printf("Port:\t%s\n", port->pkgname);
+					printf("Port:\t%s\n",
+					       PORT_FLD(ports, i, PF_PKGNAME));
 					break;
 				case DISP_PATH:
-					printf("Path:\t%s\n", port->path);
+					printf("Path:\t%s\n",
+					       PORT_FLD(ports, i, PF_PATH));
 					break;
 				case DISP_INFO:
-					printf("Info:\t%s\n", port->comment);
+					printf("Info:\t%s\n",
+					       PORT_FLD(ports, i, PF_COMMENT));
 					break;
 				case DISP_MAINT:
-					printf("Maint:\t%s\n", port->maint);
+					printf("Maint:\t%s\n",
+					       PORT_FLD(ports, i, PF_MAINT));
 					break;
 				case DISP_CAT:
-					printf("Index:\t%s\n", port->categories);
+					printf("Index:\t%s\n",
+					       PORT_FLD(ports, i, PF_CATEGORIES));
 					break;
 				case DISP_FDEP:
-					printf("F-deps:\t%s\n", port->fdep);
+					printf("F-deps:\t%s\n",
+					       PORT_FLD(ports, i, PF_FDEP));
 					break;
 				case DISP_EDEP:
-					printf("E-deps:\t%s\n", port->edep);
+					printf("E-deps:\t%s\n",
+					       PORT_FLD(ports, i, PF_EDEP));
 					break;
 				case DISP_PDEP:
-					printf("P-deps:\t%s\n", port->pdep);
+					printf("P-deps:\t%s\n",
+					       PORT_FLD(ports, i, PF_PDEP));
 					break;
 				case DISP_BDEP:
-					printf("B-deps:\t%s\n", port->bdep);
+					printf("B-deps:\t%s\n",
+					       PORT_FLD(ports, i, PF_BDEP));
 					break;
 				case DISP_RDEP:
-					printf("R-deps:\t%s\n", port->rdep);
+					printf("R-deps:\t%s\n",
+					       PORT_FLD(ports, i, PF_RDEP));
 					break;
 				case DISP_WWW:
-					printf("WWW:\t%s\n", port->www);
+					printf("WWW:\t%s\n",
+					       PORT_FLD(ports, i, PF_WWW));
 					break;
 				}
 
 			if (ISSET(SEARCH_BY_PFILE, opts->search_crit))
 			{
 				printf("Files:\t");
-				vi_reset(&vi, &port->plist);
+				vi_reset(&vi, &ports->plists[i]);
 
 				vi_next(&vi, (void **)&filename);
 				files_cnt++;
@@ -177,7 +186,7 @@ matched_ports_cnt(const struct ports_t *ports, int search_crit)
 
 	cnt = 0;
 	for (i = 0; i < ports->sz; i++)
-		if (ports->arr[i]->matched == search_crit)
+		if (ports->matched[i] == search_crit)
 			cnt++;
 
 	return cnt;
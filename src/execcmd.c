@@ -30,6 +30,8 @@
 
 #include <errno.h>
 #include <err.h>
+#include <fcntl.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -42,66 +44,95 @@
 #define PIPE_IN		1
 #define PIPE_OUT	0
 
+extern char	**environ;
+
 void
 execcmd(const char *cmd, char *const args[],
 	void (*process)(char *, void *), void *process_arg)
 {
-	int	p[2];
 	pid_t	pid;
-	int	status;
-
+	int	fd;
 	FILE	*fp;
 
+	pid = execcmd_start(cmd, args, &fd);
+
+	if ((fp = fdopen(fd, "r")) == NULL)
+		err(EX_OSERR, "fdopen(): %d", fd);
+
+	exhaust_fp(fp, process, process_arg);
+
+	if (fclose(fp) != 0)
+		err(EX_OSERR, "fclose()");
+
+	execcmd_wait(cmd, pid);
+}
+
+pid_t
+execcmd_start(const char *cmd, char *const args[], int *fd)
+{
+	posix_spawn_file_actions_t	fa;
+	int				p[2];
+	pid_t				pid;
+	int				rc;
+
 	if (pipe(p) == -1)
 		err(EX_OSERR, "pipe()");
 
-	switch ((pid = fork()))
-	{
-	case -1:
-		err(EX_OSERR, "fork()");
+	/*
+	 * Several commands may run at the same time, do not let them
+	 * inherit each other's pipes. dup2(2) clears the flag on
+	 * the child's stdout.
+	 */
+	if (fcntl(p[PIPE_IN], F_SETFD, FD_CLOEXEC) == -1 ||
+	    fcntl(p[PIPE_OUT], F_SETFD, FD_CLOEXEC) == -1)
+		err(EX_OSERR, "fcntl()");
 
-		/* NOTREACHED */
-		break;
-	case 0:
-		if (dup2(p[PIPE_IN], STDOUT_FILENO) == -1)
-			err(EX_OSERR, "dup2()");
+	if ((rc = posix_spawn_file_actions_init(&fa)) != 0)
+		errc(EX_OSERR, rc, "posix_spawn_file_actions_init()");
 
-		execvp(cmd, args);
+	if ((rc = posix_spawn_file_actions_adddup2(&fa, p[PIPE_IN],
+						   STDOUT_FILENO)) != 0)
+		errc(EX_OSERR, rc, "posix_spawn_file_actions_adddup2()");
 
-		/* FAILURE */
+	/*
+	 * Unlike fork(2) this does not copy our address space, which is
+	 * big while the old store is loaded during -u, so starting a
+	 * command costs the same regardless of it.
+	 */
+	if ((rc = posix_spawnp(&pid, cmd, &fa, NULL, args, environ)) != 0)
+		errc(EX_UNAVAILABLE, rc, "posix_spawnp(): %s", cmd);
 
-		err(EX_UNAVAILABLE, "execvp(): %s", cmd);
+	posix_spawn_file_actions_destroy(&fa);
 
-		/* NOTREACHED */
-		break;
-	default:
-		if (close(p[PIPE_IN]) == -1)
-			err(EX_OSERR, "close(): %d", p[PIPE_IN]);
+	if (close(p[PIPE_IN]) == -1)
+		err(EX_OSERR, "close(): %d", p[PIPE_IN]);
 
-		if ((fp = fdopen(p[PIPE_OUT], "r")) == NULL)
-			err(EX_OSERR, "fdopen(): %d", p[PIPE_OUT]);
+	*fd = p[PIPE_OUT];
 
-		exhaust_fp(fp, process, process_arg);
+	return pid;
+}
 
-		if (fclose(fp) != 0)
-			err(EX_OSERR, "fclose()");
+void
+execcmd_wait(const char *cmd, pid_t pid)
+{
+	int	status;
 
-		if (waitpid(pid, &status, 0) == -1)
+	while (waitpid(pid, &status, 0) == -1)
+		if (errno != EINTR)
 			err(EX_OSERR, "waitpid()");
 
-		if (WIFEXITED(status))
-		{
-			if (WEXITSTATUS(status) != 0)
-				errx(WEXITSTATUS(status),
-				     "%s: exited with error %d",
-				     cmd, WEXITSTATUS(status));
-		}
-		else if (WIFSIGNALED(status))
-		{
-			errx(EX_OSERR, "%s: exited on signal %d%s",
-			     cmd, WTERMSIG(status),
-			     WCOREDUMP(status) ? " (core dumped)" : "");
-		}
+	if (WIFEXITED(status))
+	{
+		if (WEXITSTATUS(status) != 0)
+			errx(WEXITSTATUS(status),
+			     "%s: exited with error %d",
+			     cmd, WEXITSTATUS(status));
+	}
+	else if (WIFSIGNALED(status))
+	{
+		errx(EX_OSERR, "%s: exited on signal %d%s",
+		     cmd, WTERMSIG(status),
+		     WCOREDUMP(status) ? " (core dumped)" : "");
 	}
 }
 
@@ -27,14 +27,29 @@
 #ifndef EXECCMD_H
 #define EXECCMD_H
 
+#include <sys/types.h>
+
 /*
- * Execute command `cmd' with execvp(3) and call `process' for each line
+ * Execute command `cmd' with posix_spawnp(3) and call `process' for each line
  * of output. Line (process' first argument) is overwritten by
  * subsequent calls and free()'d at the end.
  */
 void execcmd(const char *cmd, char *const args[],
 	     void (*process)(char *, void *), void *process_arg);
 
+/*
+ * Start command `cmd' with posix_spawnp(3) without waiting for it. Its
+ * output can be read from `*fd', which the caller must close. The
+ * command must be reaped with execcmd_wait().
+ */
+pid_t execcmd_start(const char *cmd, char *const args[], int *fd);
+
+/*
+ * Wait for command `cmd' started by execcmd_start() to exit,
+ * exit if it did not succeed.
+ */
+void execcmd_wait(const char *cmd, pid_t pid);
+
 #endif  /* EXECCMD_H */
 
 /* EOF */
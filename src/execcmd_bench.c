@@ -0,0 +1,187 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Measure how long starting a command with execcmd_start() takes
+ * depending on the size of the caller's heap, compared to fork(2) and
+ * execvp(3).
+ *
+ * usage: execcmd_bench [iterations [heap_mb ...]]
+ */
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include <err.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include "execcmd.h"
+
+#define CMD	"true"
+
+/*
+ * Start CMD the way execcmd_start() did before posix_spawn(3), with its
+ * stdout on a pipe, and wait for it
+ */
+static void fork_cmd(void);
+
+/*
+ * Start CMD with execcmd_start() and wait for it
+ */
+static void spawn_cmd(void);
+
+/*
+ * Run `fn' `iterations' times, return microseconds per run
+ */
+static double measure(void (*fn)(void), int iterations);
+
+/***/
+
+int
+main(int argc, char **argv)
+{
+	static const int	dflt_heaps[] = {0, 64, 256, 1024};
+	int			iterations;
+	int			heaps_cnt;
+	int			heap_mb;
+	char			*heap;
+	int			i;
+
+	iterations = argc > 1 ? atoi(argv[1]) : 200;
+	if (iterations < 1)
+		errx(EX_USAGE, "invalid number of iterations: %s", argv[1]);
+
+	heaps_cnt = argc > 2 ? argc - 2 :
+		(int)(sizeof(dflt_heaps) / sizeof(dflt_heaps[0]));
+
+	printf("%8s %12s %12s\n", "heap MB", "fork us", "spawn us");
+
+	for (i = 0; i < heaps_cnt; i++)
+	{
+		heap_mb = argc > 2 ? atoi(argv[i + 2]) : dflt_heaps[i];
+
+		/* touch every page, so that it has to be mapped in the child */
+		heap = NULL;
+		if (heap_mb > 0)
+		{
+			if ((heap = malloc((size_t)heap_mb << 20)) == NULL)
+				err(EX_OSERR, "malloc(): %d MB", heap_mb);
+			memset(heap, 1, (size_t)heap_mb << 20);
+		}
+
+		printf("%8d %12.1f %12.1f\n", heap_mb,
+		       measure(fork_cmd, iterations),
+		       measure(spawn_cmd, iterations));
+
+		free(heap);
+	}
+
+	return 0;
+}
+
+static void
+fork_cmd(void)
+{
+	char *const	args[] = {CMD, NULL};
+	int		p[2];
+	pid_t		pid;
+	char		buf[64];
+
+	if (pipe(p) == -1)
+		err(EX_OSERR, "pipe()");
+
+	switch ((pid = fork()))
+	{
+	case -1:
+		err(EX_OSERR, "fork()");
+
+		/* NOTREACHED */
+		break;
+	case 0:
+		if (dup2(p[1], STDOUT_FILENO) == -1)
+			err(EX_OSERR, "dup2()");
+
+		execvp(CMD, args);
+
+		err(EX_UNAVAILABLE, "execvp(): %s", CMD);
+
+		/* NOTREACHED */
+		break;
+	}
+
+	close(p[1]);
+
+	while (read(p[0], buf, sizeof(buf)) > 0)
+		;
+
+	close(p[0]);
+
+	execcmd_wait(CMD, pid);
+}
+
+static void
+spawn_cmd(void)
+{
+	char *const	args[] = {CMD, NULL};
+	int		fd;
+	pid_t		pid;
+	char		buf[64];
+
+	pid = execcmd_start(CMD, args, &fd);
+
+	while (read(fd, buf, sizeof(buf)) > 0)
+		;
+
+	close(fd);
+
+	execcmd_wait(CMD, pid);
+}
+
+static double
+measure(void (*fn)(void), int iterations)
+{
+	struct timeval	start, end;
+	int		i;
+
+	gettimeofday(&start, NULL);
+
+	for (i = 0; i < iterations; i++)
+		fn();
+
+	gettimeofday(&end, NULL);
+
+	return ((end.tv_sec - start.tv_sec) * 1e6 +
+		(end.tv_usec - start.tv_usec)) / iterations;
+}
+
+/* EOF */
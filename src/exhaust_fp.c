@@ -33,42 +33,73 @@
 #include <sysexits.h>
 
 #include "exhaust_fp.h"
+#include "sepscan.h"
 
 void
 exhaust_fp(FILE *fp, void (*process)(char *, void *), void *process_arg)
 {
-	char	*buf;
-	size_t	bufsz = BUFSIZ;  /* start with some reasonable size */
-	size_t	bufofft = 0;
-	size_t	buflen;
+	struct sepscan_t	ss;
+	char			*buf;
+	size_t			bufsz = 64 * 1024;  /* start with some reasonable size */
+	size_t			buflen = 0;
+	size_t			rd;
+	size_t			lnofft;
+	size_t			i;
 
-        if ((buf = (char *)malloc(bufsz)) == NULL)
+	if ((buf = (char *)malloc(bufsz)) == NULL)
 		err(EX_OSERR, "malloc(): %u", (unsigned)bufsz);
 
-        while (fgets(buf + bufofft, bufsz - bufofft, fp) != NULL)
+	ss_start(&ss);
+
+	/*
+	 * read big blocks and find all newlines of a block at once, the
+	 * incomplete last line is moved to the front of the buffer and
+	 * completed by the next block
+	 */
+	for (;;)
 	{
-                buflen = strlen(buf);
-                if (buf[buflen - 1] != '\n')
+		/* one slot is kept for the terminating '\0' of the last line */
+		if (buflen + 1 >= bufsz)
 		{
-                        bufsz *= 2;
-                        if ((buf = realloc(buf, bufsz)) == NULL)
+			bufsz *= 2;
+			if ((buf = realloc(buf, bufsz)) == NULL)
 				err(EX_OSERR, "realloc(): %u", (unsigned)bufsz);
-                        bufofft = buflen;
-                        continue;
-                }
+		}
 
-		/* remove trailing newline */
-		buf[buflen - 1] = '\0';
+		rd = fread(buf + buflen, 1, bufsz - buflen - 1, fp);
+		if (rd == 0)
+			break;
 
-		process(buf, process_arg);
+		ss_scan(&ss, buf, buflen + rd, '\n', '\n');
+
+		lnofft = 0;
+		/* the last record is not terminated unless it ends at a '\n' */
+		for (i = 0; i < ss.rs_cnt && ss.rs[i] < buflen + rd; i++)
+		{
+			buf[ss.rs[i]] = '\0';
+
+			process(buf + lnofft, process_arg);
 
-                bufofft = 0;
-        }
+			lnofft = ss.rs[i] + 1;
+		}
+
+		buflen = buflen + rd - lnofft;
+		memmove(buf, buf + lnofft, buflen);
+	}
 
 	if (ferror(fp))
 		errx(EX_IOERR, "ferror()");
 
-        free(buf);
+	/* the last line is not terminated by a newline */
+	if (buflen > 0)
+	{
+		buf[buflen] = '\0';
+		process(buf, process_arg);
+	}
+
+	ss_destroy(&ss);
+
+	free(buf);
 }
 
 /* EOF */
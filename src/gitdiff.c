@@ -0,0 +1,258 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <sys/param.h>
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include "execcmd.h"
+#include "gitdiff.h"
+#include "hash.h"
+#include "xlibc.h"
+
+/* directories whose files every port may include */
+static const char *const	framework_dirs[] = {
+	"Mk/",
+	"Templates/",
+	"Keywords/",
+	NULL
+};
+
+/* execcmd() argument for gd_head() */
+struct head_arg_t {
+	char	*commit;
+	size_t	commit_sz;
+};
+
+/*
+ * Check whether `dir' is in a git checkout, i.e. whether it or one of
+ * its parents has a .git (a directory, or a file for a worktree)
+ * Returns 1 if it is and 0 otherwise
+ */
+static int in_checkout(const char *dir);
+
+/*
+ * Check whether the file `rel', relative to PORTSDIR and `len' bytes
+ * long, is in a changed port, category or is a changed file at the top,
+ * see gitdiff_t.dirs
+ * Returns 1 if it is and 0 otherwise
+ */
+static int file_changed(const struct gitdiff_t *gd, const char *rel,
+			size_t len);
+
+/*
+ * Store in `key' the entry of gitdiff_t.dirs for the file `rel', relative
+ * to PORTSDIR and `len' bytes long: its port for category/port/..., its
+ * category for category/file and the file itself at the top
+ */
+static void dir_key(const struct gitdiff_t *gd, const char *rel, size_t len,
+		    char *key, size_t key_sz);
+
+/*
+ * execcmd() callbacks for gd_head() and gd_start()
+ */
+static void _gd_head(char *line, void *arg_void);
+static void _gd_start(char *line, void *gd_void);
+
+/***/
+
+void
+gd_head(const char *portsdir, char *commit, size_t commit_sz)
+{
+	struct head_arg_t	arg;
+	char			*cmd = "git";
+	char *const		args[] = {cmd,
+		"-C", (char *)portsdir, "rev-parse", "HEAD", NULL};
+
+	commit[0] = '\0';
+
+	/* not all ports trees are git checkouts */
+	if (!in_checkout(portsdir))
+		return;
+
+	arg.commit = commit;
+	arg.commit_sz = commit_sz;
+
+	execcmd(cmd, args, _gd_head, &arg);
+}
+
+void
+gd_start(struct gitdiff_t *gd, const char *portsdir, const char *rev)
+{
+	char		*cmd = "git";
+	/*
+	 * Against the working tree, uncommitted changes count too. The
+	 * names are relative to portsdir, which does not have to be the
+	 * top of the checkout, files outside it are not listed.
+	 */
+	char *const	args[] = {cmd,
+		"-C", (char *)portsdir, "diff", "--name-only", "--relative",
+		(char *)rev, "--", NULL};
+
+	if (!in_checkout(portsdir))
+		errx(EX_USAGE, "--since: %s is not in a git checkout",
+		     portsdir);
+
+	gd->portsdir = portsdir;
+	gd->framework = 0;
+
+	h_start(&gd->dirs, 256);
+
+	execcmd(cmd, args, _gd_start, gd);
+}
+
+int
+gd_port_changed(const struct gitdiff_t *gd, const char *portpath,
+		const char *fdeps)
+{
+	size_t		dir_len;
+	const char	*rel, *nl;
+
+	dir_len = strlen(gd->portsdir);
+	if (strncmp(portpath, gd->portsdir, dir_len) != 0 ||
+	    portpath[dir_len] != '/')
+		return 1;
+
+	/* the port's own files, including its category's Makefile.inc */
+	rel = portpath + dir_len + 1;
+	if (h_find(&gd->dirs, portpath) != NULL ||
+	    file_changed(gd, rel, strlen(rel)))
+		return 1;
+
+	/* e.g. the master port's files */
+	for (; fdeps != NULL && (nl = strchr(fdeps, '\n')) != NULL;
+	     fdeps = nl + 1)
+		if (file_changed(gd, fdeps, nl - fdeps))
+			return 1;
+
+	return 0;
+}
+
+void
+gd_end(struct gitdiff_t *gd)
+{
+	size_t	i;
+
+	/* keys, allocated by _gd_start(), are also the values */
+	for (i = 0; i < gd->dirs.ents_sz; i++)
+		if (gd->dirs.ents[i].key != NULL)
+			xfree(gd->dirs.ents[i].val);
+
+	h_destroy(&gd->dirs);
+}
+
+static int
+in_checkout(const char *dir)
+{
+	char	path[PATH_MAX];
+	char	gitdir[PATH_MAX];
+	char	*slash;
+
+	if (realpath(dir, path) == NULL)
+		return 0;
+
+	for (;;)
+	{
+		snprintf(gitdir, sizeof(gitdir), "%s/.git",
+			 strcmp(path, "/") == 0 ? "" : path);
+		if (access(gitdir, F_OK) == 0)
+			return 1;
+
+		if ((slash = strrchr(path, '/')) == NULL || path[1] == '\0')
+			return 0;
+
+		/* "/usr" -> "/" */
+		slash[slash == path ? 1 : 0] = '\0';
+	}
+}
+
+static int
+file_changed(const struct gitdiff_t *gd, const char *rel, size_t len)
+{
+	char	key[PATH_MAX];
+
+	dir_key(gd, rel, len, key, sizeof(key));
+
+	return h_find(&gd->dirs, key) != NULL;
+}
+
+static void
+dir_key(const struct gitdiff_t *gd, const char *rel, size_t len, char *key,
+	size_t key_sz)
+{
+	const char	*slash1, *slash2;
+
+	/* the port, or the category for a file of a category */
+	if ((slash1 = memchr(rel, '/', len)) != NULL)
+	{
+		slash2 = memchr(slash1 + 1, '/', len - (slash1 + 1 - rel));
+		len = (slash2 != NULL ? slash2 : slash1) - rel;
+	}
+
+	snprintf(key, key_sz, "%s/%.*s", gd->portsdir, (int)len, rel);
+}
+
+static void
+_gd_head(char *line, void *arg_void)
+{
+	struct head_arg_t	*arg = (struct head_arg_t *)arg_void;
+
+	snprintf(arg->commit, arg->commit_sz, "%s", line);
+}
+
+static void
+_gd_start(char *line, void *gd_void)
+{
+	struct gitdiff_t	*gd = (struct gitdiff_t *)gd_void;
+	char			path[PATH_MAX];
+	char			*key;
+	int			i;
+
+	for (i = 0; framework_dirs[i] != NULL; i++)
+		if (strncmp(line, framework_dirs[i],
+			    strlen(framework_dirs[i])) == 0)
+		{
+			gd->framework = 1;
+			return;
+		}
+
+	dir_key(gd, line, strlen(line), path, sizeof(path));
+
+	if (h_find(&gd->dirs, path) == NULL)
+	{
+		key = xstrdup(path);
+		h_add(&gd->dirs, key, key);
+	}
+}
+
+/* EOF */
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * The ports changed in a git checkout of the ports tree since a given
+ * revision, used by -u --since to skip the ports that were not touched.
+ */
+
+#ifndef GITDIFF_H
+#define GITDIFF_H
+
+#include <stdio.h>
+
+#include "hash.h"
+
+struct gitdiff_t {
+	const char	*portsdir;
+	/*
+	 * Full paths of the changed ports, of the categories with changed
+	 * files (e.g. Makefile.inc) and of the changed files at the top
+	 */
+	struct hash_t	dirs;
+	/* Mk/, Templates/ or Keywords/ changed, every port may have */
+	int		framework;
+};
+
+/*
+ * Set `commit' to the revision the git checkout containing `portsdir' is
+ * at, or to an empty string if `portsdir' is not in a git checkout
+ */
+void gd_head(const char *portsdir, char *commit, size_t commit_sz);
+
+/*
+ * Collect the ports whose files differ between git revision `rev' and
+ * the working tree of `portsdir', which may be a subdirectory of the
+ * checkout. Exits if `portsdir' is not in a git checkout.
+ */
+void gd_start(struct gitdiff_t *gd, const char *portsdir, const char *rev);
+
+/*
+ * Check whether the files of the port at `portpath', of its category or
+ * the other files in `fdeps' (see port_t) have changed
+ * Returns 1 if they have and 0 otherwise
+ */
+int gd_port_changed(const struct gitdiff_t *gd, const char *portpath,
+		    const char *fdeps);
+
+/*
+ * Free resources, allocated by gd_start()
+ */
+void gd_end(struct gitdiff_t *gd);
+
+#endif  /* GITDIFF_H */
+
+/* EOF */
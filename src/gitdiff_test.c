@@ -0,0 +1,269 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Check gd_head(), gd_start() and gd_port_changed() on a small ports tree
+ * in a git checkout made under /tmp: once at the top of the checkout and
+ * once in a subdirectory of a bigger one, with committed and uncommitted
+ * changes to ports, to a master port, to a category's Makefile.inc, to
+ * files outside the ports tree and to Mk/ and Templates/. The test is
+ * skipped if git(1) can not be run.
+ * Exits with 1 if any check fails.
+ *
+ * usage: gitdiff_test
+ */
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <sys/param.h>
+
+#include <err.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include "gitdiff.h"
+#include "xlibc.h"
+
+/* files of the ports tree, relative to it */
+static const char *const	files[] = {
+	"Mk/bsd.port.mk",
+	"Templates/BSD.local.dist",
+	"cat/Makefile",
+	"cat/a/Makefile",
+	"cat/b/Makefile",
+	"cat/b/pkg-plist",
+	"cat/c/Makefile",
+	"devel/Makefile.inc",
+	"devel/d/Makefile",
+	"devel/m/Makefile",
+	"devel/m/pkg-plist",
+	"devel/s/Makefile",
+	"misc/e/Makefile",
+	"misc/Makefile.inc",
+	NULL
+};
+
+/* a port and whether it is changed after the changes in check_tree() */
+struct port_case_t {
+	const char	*port;
+	const char	*fdeps;  /* see port_t */
+	int		changed;
+};
+
+static const struct port_case_t	ports[] = {
+	{"cat/a", NULL, 1},  /* committed after the base revision */
+	{"cat/b", NULL, 1},  /* not committed */
+	{"cat/c", NULL, 0},
+	{"devel/d", "cat/c/Makefile\n", 0},
+	{"devel/m", NULL, 1},
+	/* a slave of devel/m */
+	{"devel/s", "devel/m/Makefile\ndevel/m/pkg-plist\n", 1},
+	{"misc/e", NULL, 1},  /* misc/Makefile.inc changed */
+};
+
+#define PORTS_CNT	(sizeof(ports) / sizeof(ports[0]))
+
+static int	failed;
+
+/*
+ * Run the shell command made of `fmt' and the rest of the arguments as
+ * with printf(3), exit if it fails
+ */
+static void run(const char *fmt, ...);
+
+/*
+ * Make a git checkout in a temporary directory with the ports tree in
+ * its subdirectory `sub' ("" for the top) and check it
+ */
+static void check_tree(const char *sub);
+
+/*
+ * Check the ports changed in `portsdir' since git revision "base",
+ * `dirs' ports or categories in all
+ */
+static void check_changed(const char *name, const char *portsdir,
+			  int framework, size_t dirs);
+
+/***/
+
+int
+main(void)
+{
+	char	dir[] = "/tmp/gitdiff_test.XXXXXX";
+	char	commit[64];
+
+	if (system("git --version >/dev/null 2>&1") != 0)
+	{
+		printf("gitdiff_test: git can not be run, skipped\n");
+		return 0;
+	}
+
+	/* a tree outside of any checkout has no revision */
+	if (mkdtemp(dir) == NULL)
+		err(EX_CANTCREAT, "mkdtemp(): %s", dir);
+	gd_head(dir, commit, sizeof(commit));
+	if (commit[0] != '\0')
+	{
+		fprintf(stderr, "gitdiff_test: %s: revision %s outside git\n",
+			dir, commit);
+		failed = 1;
+	}
+	if (rmdir(dir) == -1)
+		err(EX_OSERR, "rmdir(): %s", dir);
+
+	check_tree("");
+	check_tree("/ports");
+
+	if (failed)
+		return 1;
+
+	printf("gitdiff_test: %u ports ok\n", (unsigned)PORTS_CNT);
+
+	return 0;
+}
+
+static void
+run(const char *fmt, ...)
+{
+	char	cmd[BUFSIZ];
+	va_list	ap;
+
+	va_start(ap, fmt);
+	vsnprintf(cmd, sizeof(cmd), fmt, ap);
+	va_end(ap);
+
+	if (system(cmd) != 0)
+		errx(EX_SOFTWARE, "failed: %s", cmd);
+}
+
+static void
+check_tree(const char *sub)
+{
+	char	dir[] = "/tmp/gitdiff_test.XXXXXX";
+	char	portsdir[PATH_MAX];
+	char	commit[64];
+	int	i;
+
+	if (mkdtemp(dir) == NULL)
+		err(EX_CANTCREAT, "mkdtemp(): %s", dir);
+
+	snprintf(portsdir, sizeof(portsdir), "%s%s", dir, sub);
+
+	run("cd %s && git init -q && git config user.email test@localhost "
+	    "&& git config user.name test", dir);
+
+	for (i = 0; files[i] != NULL; i++)
+		run("mkdir -p $(dirname %s/%s) && echo %s > %s/%s",
+		    portsdir, files[i], files[i], portsdir, files[i]);
+	/*
+	 * Outside the ports tree if it is in a subdirectory, but looks
+	 * like a port to a diff that is not relative to it
+	 */
+	run("mkdir -p %s/other/x && echo x > %s/other/x/y", dir, dir);
+
+	run("cd %s && git add -A && git commit -q -m base && git tag base",
+	    dir);
+
+	gd_head(portsdir, commit, sizeof(commit));
+	if (strlen(commit) != 40)
+	{
+		fprintf(stderr, "gitdiff_test: %s: revision \"%s\"\n",
+			portsdir, commit);
+		failed = 1;
+	}
+
+	run("cd %s && echo 1 >> %s/cat/a/Makefile && echo 1 >> other/x/y && "
+	    "echo 1 >> %s/misc/Makefile.inc && git commit -q -a -m change",
+	    dir, portsdir, portsdir);
+	run("echo 2 >> %s/cat/b/pkg-plist && echo 2 >> %s/devel/m/pkg-plist",
+	    portsdir, portsdir);
+
+	/* cat/a, cat/b, devel/m, misc and other/x at the top */
+	check_changed(sub[0] == '\0' ? "top" : "subdirectory", portsdir, 0,
+		      sub[0] == '\0' ? 5 : 4);
+
+	run("echo 3 >> %s/Mk/bsd.port.mk", portsdir);
+
+	check_changed(sub[0] == '\0' ? "top, Mk" : "subdirectory, Mk",
+		      portsdir, 1, sub[0] == '\0' ? 5 : 4);
+
+	run("cd %s && git checkout -q -- Mk && "
+	    "echo 4 >> Templates/BSD.local.dist", portsdir);
+
+	check_changed(sub[0] == '\0' ? "top, Templates" :
+		      "subdirectory, Templates",
+		      portsdir, 1, sub[0] == '\0' ? 5 : 4);
+
+	run("rm -rf %s", dir);
+}
+
+static void
+check_changed(const char *name, const char *portsdir, int framework,
+	      size_t dirs)
+{
+	struct gitdiff_t	gd;
+	char			path[PATH_MAX];
+	size_t			i;
+	int			changed;
+
+	gd_start(&gd, portsdir, "base");
+
+	if (gd.framework != framework)
+	{
+		fprintf(stderr, "gitdiff_test: %s: framework %schanged\n", name,
+			gd.framework ? "" : "not ");
+		failed = 1;
+	}
+
+	for (i = 0; i < PORTS_CNT; i++)
+	{
+		snprintf(path, sizeof(path), "%s/%s", portsdir, ports[i].port);
+
+		changed = gd_port_changed(&gd, path, ports[i].fdeps);
+		if (changed != ports[i].changed)
+		{
+			fprintf(stderr, "gitdiff_test: %s: %s %schanged\n",
+				name, ports[i].port, changed ? "" : "not ");
+			failed = 1;
+		}
+	}
+
+	if (gd.dirs.nelems != dirs)
+	{
+		fprintf(stderr, "gitdiff_test: %s: %u ports or categories "
+			"changed\n", name,
+			(unsigned)gd.dirs.nelems);
+		failed = 1;
+	}
+
+	gd_end(&gd);
+}
+
+/* EOF */
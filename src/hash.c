@@ -0,0 +1,167 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+
+#include <err.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+
+#include "hash.h"
+
+/*
+ * FNV-1a hash of `key'
+ */
+static uint32_t h_hash(const char *key);
+
+/*
+ * Return the slot where `key' is or should be inserted
+ */
+static struct hash_ent_t *h_slot(const struct hash_t *h, const char *key);
+
+/*
+ * Allocate `ents_sz' empty slots for `h'
+ */
+static void h_alloc(struct hash_t *h, size_t ents_sz);
+
+/***/
+
+void
+h_start(struct hash_t *h, size_t initial_sz)
+{
+	size_t	ents_sz;
+
+	/* keep the load factor below 1/2 */
+	for (ents_sz = 16; ents_sz < initial_sz * 2; ents_sz *= 2)
+		;
+
+	h_alloc(h, ents_sz);
+}
+
+void
+h_add(struct hash_t *h, const char *key, void *val)
+{
+	struct hash_ent_t	*old_ents;
+	struct hash_ent_t	*e;
+	size_t			old_sz;
+	size_t			i;
+
+	if ((h->nelems + 1) * 2 > h->ents_sz)
+	{
+		old_ents = h->ents;
+		old_sz = h->ents_sz;
+
+		h_alloc(h, old_sz * 2);
+
+		for (i = 0; i < old_sz; i++)
+			if (old_ents[i].key != NULL)
+			{
+				e = h_slot(h, old_ents[i].key);
+				*e = old_ents[i];
+				h->nelems++;
+			}
+
+		free(old_ents);
+	}
+
+	e = h_slot(h, key);
+
+	if (e->key == NULL)
+	{
+		e->key = key;
+		h->nelems++;
+	}
+
+	e->val = val;
+}
+
+void *
+h_find(const struct hash_t *h, const char *key)
+{
+	return h_slot(h, key)->val;
+}
+
+void
+h_destroy(struct hash_t *h)
+{
+	free(h->ents);
+
+	h->ents = NULL;
+	h->ents_sz = h->nelems = 0;
+}
+
+/***/
+
+static uint32_t
+h_hash(const char *key)
+{
+	uint32_t	hash;
+
+	for (hash = 2166136261U; *key != '\0'; key++)
+	{
+		hash ^= (unsigned char)*key;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+static struct hash_ent_t *
+h_slot(const struct hash_t *h, const char *key)
+{
+	struct hash_ent_t	*e;
+	size_t			mask;
+	size_t			i;
+
+	mask = h->ents_sz - 1;
+
+	/* linear probing, there is always at least one empty slot */
+	for (i = h_hash(key) & mask; ; i = (i + 1) & mask)
+	{
+		e = &h->ents[i];
+
+		if (e->key == NULL || strcmp(e->key, key) == 0)
+			return e;
+	}
+}
+
+static void
+h_alloc(struct hash_t *h, size_t ents_sz)
+{
+	size_t	malloc_bytes;
+
+	malloc_bytes = ents_sz * sizeof(struct hash_ent_t);
+
+	if ((h->ents = calloc(ents_sz, sizeof(struct hash_ent_t))) == NULL)
+		err(EX_OSERR, "calloc(): %u", (unsigned)malloc_bytes);
+	h->ents_sz = ents_sz;
+	h->nelems = 0;
+}
+
+/* EOF */
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Hash table that maps NUL terminated strings to pointers. Keys are not
+ * copied, they must stay valid while the table is used.
+ */
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdio.h>
+
+struct hash_ent_t {
+	const char	*key;  /* NULL for an empty slot */
+	void		*val;
+};
+
+struct hash_t {
+	struct hash_ent_t	*ents;
+	size_t			ents_sz;  /* always a power of 2 */
+	size_t			nelems;
+};
+
+/*
+ * Create hash table, big enough for `initial_sz' elements
+ * without growing
+ */
+void h_start(struct hash_t *h, size_t initial_sz);
+
+/*
+ * Add `key' -> `val' to `h', if `key' already exists its value is replaced
+ */
+void h_add(struct hash_t *h, const char *key, void *val);
+
+/*
+ * Find the value for `key'
+ * Returns NULL if `key' does not exist in `h'
+ */
+void *h_find(const struct hash_t *h, const char *key);
+
+/*
+ * Free resources, allocated by `h'
+ */
+void h_destroy(struct hash_t *h);
+
+#endif  /* HASH_H */
+
+/* EOF */
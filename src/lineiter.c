@@ -0,0 +1,175 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <err.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include "lineiter.h"
+#include "sepscan.h"
+
+/* bytes scanned at once, doubled for lines that do not fit */
+#define LI_WIN	(1024 * 1024)
+
+/***/
+
+/*
+ * Scan the window that starts at `li->offt', make it big enough to hold
+ * at least one whole line
+ */
+static void li_scan(struct lineiter_t *li);
+
+/***/
+
+int
+li_open(struct lineiter_t *li, const char *filename)
+{
+	int		fd;
+	struct stat	sb;
+	void		*map;
+
+	if ((fd = open(filename, O_RDONLY)) == -1)
+		err(EX_NOINPUT, "open(): %s", filename);
+
+	if (fstat(fd, &sb) == -1)
+		err(EX_OSERR, "fstat(): %s", filename);
+
+	if (!S_ISREG(sb.st_mode))
+	{
+		close(fd);
+		return -1;
+	}
+
+	/* an empty file can not be mmap(2)ed */
+	map = NULL;
+	if (sb.st_size > 0)
+	{
+		if ((map = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED,
+				fd, 0)) == MAP_FAILED)
+			err(EX_OSERR, "mmap(): %s", filename);
+
+		if (madvise(map, sb.st_size, MADV_SEQUENTIAL) == -1)
+			err(EX_OSERR, "madvise(): %s", filename);
+	}
+
+	close(fd);
+
+	li_start(li, (const char *)map, sb.st_size);
+
+	li->mapped = map != NULL;
+
+	return 0;
+}
+
+void
+li_start(struct lineiter_t *li, const char *buf, size_t sz)
+{
+	li->buf = buf;
+	li->sz = sz;
+	li->mapped = 0;
+	li->win = LI_WIN;
+	li->wstart = li->wend = 0;
+	li->next = 0;
+	li->offt = 0;
+
+	ss_start(&li->scan);
+}
+
+int
+li_next(struct lineiter_t *li, const char **line, size_t *len)
+{
+	size_t	end;
+
+	for (;;)
+	{
+		if (li->next < li->scan.rs_cnt)
+		{
+			end = li->wstart + li->scan.rs[li->next];
+
+			/* a line cut by the end of the window is scanned again */
+			if (end < li->wend || li->wend == li->sz)
+			{
+				*line = li->buf + li->offt;
+				*len = end - li->offt;
+
+				li->offt = end + 1;
+				li->next++;
+
+				return 1;
+			}
+		}
+
+		if (li->offt >= li->sz)
+			return 0;
+
+		li_scan(li);
+	}
+}
+
+void
+li_close(struct lineiter_t *li)
+{
+	ss_destroy(&li->scan);
+
+	if (li->mapped && munmap((void *)li->buf, li->sz) == -1)
+		err(EX_OSERR, "munmap()");
+}
+
+static void
+li_scan(struct lineiter_t *li)
+{
+	li->wstart = li->offt;
+
+	for (;;)
+	{
+		li->wend = li->sz - li->wstart > li->win ?
+			li->wstart + li->win : li->sz;
+
+		ss_scan(&li->scan, li->buf + li->wstart,
+			li->wend - li->wstart, '\n', '\n');
+
+		/* the window ends in the middle of its first line */
+		if (li->wend < li->sz && li->scan.rs_cnt == 1 &&
+		    li->scan.rs[0] == li->wend - li->wstart)
+		{
+			li->win *= 2;
+			continue;
+		}
+
+		break;
+	}
+
+	li->next = 0;
+}
+
+/* EOF */
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Line iterator: hand out the lines of a mmap(2)ed file or of a buffer
+ * as (pointer, length) pairs without copying them. The line ends are
+ * found by sepscan a window at a time, so the bytes are looked at only
+ * once and the file is read sequentially.
+ */
+
+#ifndef LINEITER_H
+#define LINEITER_H
+
+#include <stdio.h>
+
+#include "sepscan.h"
+
+struct lineiter_t {
+	const char		*buf;
+	size_t			sz;
+	int			mapped;  /* buf is mmap(2)ed by li_open() */
+	size_t			win;  /* bytes scanned at once */
+	size_t			wstart;  /* the scanned window, offsets in buf */
+	size_t			wend;
+	size_t			next;  /* index in scan.rs of the next line */
+	size_t			offt;  /* where the next line starts */
+	struct sepscan_t	scan;
+};
+
+/*
+ * Start iterating over the lines of `filename', which is mmap(2)ed for
+ * sequential reading
+ * Return 0 on success and -1 if `filename' is not a regular file (e.g.
+ * a pipe), which can be read with exhaust_fp() instead
+ */
+int li_open(struct lineiter_t *li, const char *filename);
+
+/*
+ * Start iterating over the lines of `buf', which is `sz' bytes long
+ */
+void li_start(struct lineiter_t *li, const char *buf, size_t sz);
+
+/*
+ * Store the next line in `line' and its length, without the trailing
+ * newline, in `len'. The line is not NUL terminated and stays valid
+ * until li_close().
+ * Return 1 if a line was stored and 0 at the end
+ */
+int li_next(struct lineiter_t *li, const char **line, size_t *len);
+
+/*
+ * Free resources, allocated by li_open() or li_start()
+ */
+void li_close(struct lineiter_t *li);
+
+#endif  /* LINEITER_H */
+
+/* EOF */
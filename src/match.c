@@ -0,0 +1,526 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+
+#include <ctype.h>
+#include <regex.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "match.h"
+#include "xlibc.h"
+
+/*
+ * The substring search compares 32 bytes at a time with AVX2 if the CPU
+ * has it, 16 with SSE2 on amd64 otherwise, as sepscan does. Without
+ * either it compares one byte at a time.
+ */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define M_HAVE_SSE2
+#endif
+
+#if (defined(__amd64__) || defined(__x86_64__) || defined(__i386__)) && \
+    defined(__GNUC__)
+#include <immintrin.h>
+#define M_HAVE_AVX2
+#endif
+
+/*
+ * We never call setlocale(3), so REG_ICASE folds ASCII letters only,
+ * do the same
+ */
+#define M_FOLD(c)	((c) >= 'A' && (c) <= 'Z' ? (c) - 'A' + 'a' : (c))
+
+/* which case the ASCII letter `c' is in, 0 if it is not a letter */
+#define M_CASE(c)	((c) >= 'A' && (c) <= 'Z' ? 1 : \
+			 (c) >= 'a' && (c) <= 'z' ? 2 : 0)
+
+/*
+ * Recognize `pattern' and set up `m' for it
+ * Returns -1 if `pattern' is not a (possibly anchored) literal
+ */
+static int analyze(struct match_t *m, const char *pattern);
+
+/*
+ * Bits to OR a byte with, so that it becomes equal to m->lit[i] if it
+ * is the same letter in another case
+ */
+static char fold_bits(const struct match_t *m, size_t i);
+
+/*
+ * Check whether the m->lit_len bytes at `p' are equal to the literal
+ */
+static int lit_eq(const struct match_t *m, const char *p);
+
+/*
+ * Check whether the literal occurs in `str' which is `len' bytes long
+ */
+static int find_substr(const struct match_t *m, const char *str, size_t len);
+
+#ifdef M_HAVE_SSE2
+/*
+ * Look for the literal in `str' 16 positions at a time, starting at *i
+ * and up to `last'. *i is left where it stopped, less than 16 positions
+ * before `last'.
+ * Return 1 if the literal was found
+ */
+static int find_sse2(const struct match_t *m, const char *str, size_t last,
+		     size_t *i);
+#endif
+
+#ifdef M_HAVE_AVX2
+/*
+ * Same as find_sse2() but 32 positions at a time
+ */
+static int find_avx2(const struct match_t *m, const char *str, size_t last,
+		     size_t *i)
+	__attribute__((target("avx2")));
+#endif
+
+/***/
+
+void
+m_comp(struct match_t *m, const char *pattern, int cflags)
+{
+	m->icase = (cflags & REG_ICASE) != 0;
+	m->lit = NULL;
+	m->any = NULL;
+#ifdef M_HAVE_AVX2
+	m->avx2 = __builtin_cpu_supports("avx2") != 0;
+#else
+	m->avx2 = 0;
+#endif
+
+	if (analyze(m, pattern) == 0)
+		return;
+
+	xfree(m->lit);
+	xfree(m->any);
+	m->lit = NULL;
+	m->any = NULL;
+
+	m->kind = M_REGEX;
+	xregcomp(&m->re, pattern, cflags);
+}
+
+int
+m_match(const struct match_t *m, const char *str, size_t len)
+{
+	size_t	n;
+
+	n = m->lit_len;
+
+	switch (m->kind)
+	{
+	case M_SUBSTR:
+		return find_substr(m, str, len);
+	case M_PREFIX:
+		return len >= n && lit_eq(m, str);
+	case M_SUFFIX:
+		return len >= n && lit_eq(m, str + len - n);
+	case M_EXACT:
+		return len == n && lit_eq(m, str);
+	case M_BASENAME:
+		return len >= n && lit_eq(m, str + len - n) &&
+			(len == n || str[len - n - 1] == '/');
+	default:
+		return regexec(&m->re, str, 0, NULL, 0) == 0;
+	}
+}
+
+void
+m_fold(char *dst, const char *src, size_t len)
+{
+	size_t	i;
+
+	for (i = 0; i < len; i++)
+		dst[i] = M_FOLD(src[i]);
+}
+
+char *
+m_fold_pattern(const char *pattern)
+{
+	const char	*p;
+	char		*folded;
+	char		*f;
+	int		bracket;  /* inside [...] */
+
+	folded = (char *)xmalloc(strlen(pattern) + 1);
+
+	bracket = 0;
+
+	for (p = pattern, f = folded; *p != '\0'; p++)
+	{
+		if (!bracket)
+		{
+			switch (*p)
+			{
+			case '\\':
+				/* \W and the like differ from \w */
+				if (M_CASE(p[1]) != 0)
+				{
+					xfree(folded);
+					return NULL;
+				}
+				*f++ = *p++;
+				if (*p == '\0')
+					p--;
+				else
+					*f++ = *p;
+				continue;
+			case '[':
+				bracket = 1;
+				*f++ = *p;
+				/* a leading ] is not the end */
+				if (p[1] == '^')
+					*f++ = *++p;
+				if (p[1] == ']')
+					*f++ = *++p;
+				continue;
+			}
+		}
+		else if (*p == ']')
+			bracket = 0;
+		else if (*p == '[' &&
+			 (p[1] == ':' || p[1] == '=' || p[1] == '.'))
+		{
+			/* classes like [:upper:] are not folded by regcomp(3) */
+			xfree(folded);
+			return NULL;
+		}
+		else if (p[1] == '-' && p[2] != ']' && p[2] != '\0' &&
+			 M_CASE(p[0]) != M_CASE(p[2]))
+		{
+			/* A-z contains more than letters */
+			xfree(folded);
+			return NULL;
+		}
+
+		*f++ = M_FOLD(*p);
+	}
+
+	*f = '\0';
+
+	return folded;
+}
+
+const char *
+m_kind_name(const struct match_t *m)
+{
+	switch (m->kind)
+	{
+	case M_SUBSTR:
+		return "substring";
+	case M_PREFIX:
+		return "prefix";
+	case M_SUFFIX:
+		return "suffix";
+	case M_EXACT:
+		return "exact";
+	case M_BASENAME:
+		return "basename";
+	default:
+		return "regex";
+	}
+}
+
+void
+m_free(struct match_t *m)
+{
+	if (m->kind == M_REGEX)
+		xregfree(&m->re);
+	else
+	{
+		xfree(m->lit);
+		xfree(m->any);
+	}
+}
+
+/***/
+
+static int
+analyze(struct match_t *m, const char *pattern)
+{
+	const char	*p;
+	int		anchor_start, anchor_end, basename;
+	size_t		n;
+
+	basename = anchor_start = anchor_end = 0;
+
+	p = pattern;
+
+	if (strncmp(p, "(^|/)", 5) == 0)
+	{
+		basename = 1;
+		p += 5;
+	}
+	else if (p[0] == '^')
+	{
+		anchor_start = 1;
+		p++;
+	}
+
+	n = strlen(p);
+
+	m->lit = (char *)xmalloc(n + 1);
+	m->any = (char *)xmalloc(n + 1);
+	m->has_any = 0;
+	m->lit_len = 0;
+
+	for (; *p != '\0'; p++)
+	{
+		n = m->lit_len;
+
+		switch (*p)
+		{
+		case '\\':
+			/*
+			 * \. is a literal dot, but \1, \< or the GNU anchors
+			 * \` and \' are not literals
+			 */
+			p++;
+			if (*p == '\0' || isalnum((unsigned char)*p) || *p == '<' ||
+			    *p == '>' || *p == '`' || *p == '\'')
+				return -1;
+			m->lit[n] = *p;
+			m->any[n] = 0;
+			break;
+		case '.':
+			m->lit[n] = '.';
+			m->any[n] = 1;
+			m->has_any = 1;
+			break;
+		case '$':
+			if (p[1] != '\0')
+				return -1;
+			anchor_end = 1;
+			continue;
+		case '[': case ']': case '(': case ')': case '{': case '}':
+		case '*': case '+': case '?': case '|': case '^':
+			return -1;
+		default:
+			m->lit[n] = *p;
+			m->any[n] = 0;
+			break;
+		}
+
+		if (m->icase)
+			m->lit[n] = M_FOLD(m->lit[n]);
+
+		m->lit_len++;
+	}
+
+	m->lit[m->lit_len] = '\0';
+
+	/* leave "", "^" and the like to the regex engine */
+	if (m->lit_len == 0)
+		return -1;
+
+	if (basename)
+	{
+		if (!anchor_end)
+			return -1;
+		m->kind = M_BASENAME;
+	}
+	else if (anchor_start && anchor_end)
+		m->kind = M_EXACT;
+	else if (anchor_start)
+		m->kind = M_PREFIX;
+	else if (anchor_end)
+		m->kind = M_SUFFIX;
+	else
+	{
+		/* the substring search looks for the first and last bytes */
+		if (m->any[0] || m->any[m->lit_len - 1])
+			return -1;
+		m->kind = M_SUBSTR;
+	}
+
+	return 0;
+}
+
+static char
+fold_bits(const struct match_t *m, size_t i)
+{
+	if (m->icase && m->lit[i] >= 'a' && m->lit[i] <= 'z')
+		return 'a' - 'A';
+	return 0;
+}
+
+static int
+lit_eq(const struct match_t *m, const char *p)
+{
+	size_t	i;
+	char	c;
+
+	if (!m->icase && !m->has_any)
+		return memcmp(p, m->lit, m->lit_len) == 0;
+
+	for (i = 0; i < m->lit_len; i++)
+	{
+		if (m->any[i])
+			continue;
+
+		c = p[i];
+		if (m->icase)
+			c = M_FOLD(c);
+
+		if (c != m->lit[i])
+			return 0;
+	}
+
+	return 1;
+}
+
+static int
+find_substr(const struct match_t *m, const char *str, size_t len)
+{
+	size_t	n;
+	size_t	last;  /* last position where the literal may start */
+	size_t	i;
+	char	first_c, last_c;
+	char	first_bits, last_bits;
+
+	n = m->lit_len;
+
+	if (len < n)
+		return 0;
+
+	last = len - n;
+
+	i = 0;
+
+#ifdef M_HAVE_AVX2
+	if (m->avx2 && find_avx2(m, str, last, &i))
+		return 1;
+#endif
+#ifdef M_HAVE_SSE2
+	if (find_sse2(m, str, last, &i))
+		return 1;
+#endif
+
+	first_c = m->lit[0];
+	last_c = m->lit[n - 1];
+	first_bits = fold_bits(m, 0);
+	last_bits = fold_bits(m, n - 1);
+
+	for (; i <= last; i++)
+		if ((str[i] | first_bits) == first_c &&
+		    (str[i + n - 1] | last_bits) == last_c &&
+		    lit_eq(m, str + i))
+			return 1;
+
+	return 0;
+}
+
+/*
+ * Both find_sse2() and find_avx2() find the positions where the first
+ * and the last byte of the literal match and compare the rest only
+ * there. Both loads stay within `str'.
+ */
+
+#ifdef M_HAVE_SSE2
+static int
+find_sse2(const struct match_t *m, const char *str, size_t last, size_t *i)
+{
+	__m128i		first_v, last_v;
+	__m128i		first_bits_v, last_bits_v;
+	__m128i		head, tail;
+	uint32_t	mask;
+	size_t		n;
+
+	n = m->lit_len;
+
+	first_v = _mm_set1_epi8(m->lit[0]);
+	last_v = _mm_set1_epi8(m->lit[n - 1]);
+	first_bits_v = _mm_set1_epi8(fold_bits(m, 0));
+	last_bits_v = _mm_set1_epi8(fold_bits(m, n - 1));
+
+	for (; *i + 15 <= last; *i += 16)
+	{
+		head = _mm_loadu_si128((const __m128i *)(str + *i));
+		tail = _mm_loadu_si128((const __m128i *)(str + *i + n - 1));
+
+		head = _mm_cmpeq_epi8(first_v,
+				      _mm_or_si128(head, first_bits_v));
+		tail = _mm_cmpeq_epi8(last_v, _mm_or_si128(tail, last_bits_v));
+
+		mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(head, tail));
+
+		for (; mask != 0; mask &= mask - 1)
+			if (lit_eq(m, str + *i + ffs((int)mask) - 1))
+				return 1;
+	}
+
+	return 0;
+}
+#endif
+
+#ifdef M_HAVE_AVX2
+static int
+find_avx2(const struct match_t *m, const char *str, size_t last, size_t *i)
+{
+	__m256i		first_v, last_v;
+	__m256i		first_bits_v, last_bits_v;
+	__m256i		head, tail;
+	uint32_t	mask;
+	size_t		n;
+
+	n = m->lit_len;
+
+	first_v = _mm256_set1_epi8(m->lit[0]);
+	last_v = _mm256_set1_epi8(m->lit[n - 1]);
+	first_bits_v = _mm256_set1_epi8(fold_bits(m, 0));
+	last_bits_v = _mm256_set1_epi8(fold_bits(m, n - 1));
+
+	for (; *i + 31 <= last; *i += 32)
+	{
+		head = _mm256_loadu_si256((const __m256i *)(str + *i));
+		tail = _mm256_loadu_si256((const __m256i *)(str + *i + n - 1));
+
+		head = _mm256_cmpeq_epi8(first_v,
+					 _mm256_or_si256(head, first_bits_v));
+		tail = _mm256_cmpeq_epi8(last_v,
+					 _mm256_or_si256(tail, last_bits_v));
+
+		mask = (uint32_t)_mm256_movemask_epi8(
+		    _mm256_and_si256(head, tail));
+
+		for (; mask != 0; mask &= mask - 1)
+			if (lit_eq(m, str + *i + ffs((int)mask) - 1))
+				return 1;
+	}
+
+	return 0;
+}
+#endif
+
+/* EOF */
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Matching of search patterns. Most patterns are plain strings, possibly
+ * anchored, for which the regular expression engine is unnecessarily
+ * slow. Such patterns are recognized and matched with a substring search,
+ * anything else goes to regexec(3).
+ */
+
+#ifndef MATCH_H
+#define MATCH_H
+
+#include <sys/types.h>
+
+#include <regex.h>
+
+enum match_kind {
+	M_REGEX,  /* anything that is not recognized below */
+	M_SUBSTR,  /* foo */
+	M_PREFIX,  /* ^foo */
+	M_SUFFIX,  /* foo$ */
+	M_EXACT,  /* ^foo$ */
+	M_BASENAME  /* (^|/)foo$, as generated by -b */
+};
+
+struct match_t {
+	enum match_kind	kind;
+	int		icase;
+	char		*lit;  /* the literal, lowercased if icase */
+	char		*any;  /* any[i] is nonzero if lit[i] was `.' */
+	int		has_any;  /* any of any[] is nonzero */
+	size_t		lit_len;
+	int		avx2;  /* the CPU has AVX2, for M_SUBSTR */
+	regex_t		re;  /* M_REGEX only */
+};
+
+/*
+ * Compile extended regular expression `pattern', `cflags' are the same
+ * as for regcomp(3) and must contain REG_EXTENDED and REG_NOSUB
+ */
+void m_comp(struct match_t *m, const char *pattern, int cflags);
+
+/*
+ * Check whether `str', which is `len' bytes long, matches `m'
+ * `str' must be NUL terminated at `len'
+ * Returns 1 if it matches, 0 otherwise
+ */
+int m_match(const struct match_t *m, const char *str, size_t len);
+
+/*
+ * Lowercase the `len' bytes at `src' into `dst' the way REG_ICASE
+ * compares them, `dst' may be equal to `src'
+ */
+void m_fold(char *dst, const char *src, size_t len);
+
+/*
+ * Lowercase `pattern', so that matching it without REG_ICASE against text
+ * lowercased by m_fold() gives the same result as matching `pattern' with
+ * REG_ICASE against the original text
+ * Returns a malloc'ed pattern or NULL if this can not be done, e.g. for
+ * a [:upper:] class
+ */
+char *m_fold_pattern(const char *pattern);
+
+/*
+ * Get a short description of how `m' is matched, e.g. "substring"
+ */
+const char *m_kind_name(const struct match_t *m);
+
+/*
+ * Free resources, allocated by m_comp()
+ */
+void m_free(struct match_t *m);
+
+#endif  /* MATCH_H */
+
+/* EOF */
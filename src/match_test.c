@@ -0,0 +1,360 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Check that the patterns m_comp() recognizes as plain strings are
+ * classified as expected and that m_match() gives the same result as
+ * regexec(3) for them, with and without REG_ICASE. Also check that the
+ * patterns lowercased by m_fold_pattern() match the lowercased subjects
+ * exactly when the original ones match with REG_ICASE, and that it
+ * refuses the patterns that can not be lowercased.
+ * Exits with 1 if any check fails.
+ *
+ * usage: match_test
+ */
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+#include <err.h>
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+
+#include "match.h"
+#include "xlibc.h"
+
+/* padding around the subjects, long enough for the vector loops */
+#define PAD	"/usr/local/share/some/long/directory/"
+#define PAD_LEN	37
+
+/* a pattern and how m_comp() should match it */
+struct pattern_t {
+	const char	*pattern;
+	enum match_kind	kind;
+};
+
+static const struct pattern_t	patterns[] = {
+	{"port", M_SUBSTR},
+	{"Port", M_SUBSTR},
+	{"a", M_SUBSTR},
+	{"^bin/", M_PREFIX},
+	{"^Bin/port", M_PREFIX},
+	{"README$", M_SUFFIX},
+	{".gz$", M_SUFFIX},
+	{"^bin/port0001$", M_EXACT},
+	{"^b.n/p.rt$", M_EXACT},
+	{"(^|/)ls$", M_BASENAME},
+	{"(^|/)README$", M_BASENAME},
+	{"(^|/)l.$", M_BASENAME},
+	/* escaped metacharacters are literals */
+	{"a\\.b", M_SUBSTR},
+	{"a\\+b", M_SUBSTR},
+	{"\\(x\\)", M_SUBSTR},
+	{"\\[1\\]", M_SUBSTR},
+	{"c\\^d\\$e", M_SUBSTR},
+	{"Weird\\|Pipe", M_SUBSTR},
+	{"back\\\\slash", M_SUBSTR},
+	{"^\\.so$", M_EXACT},
+	/* `.' inside the literal */
+	{"p.rt", M_SUBSTR},
+	{"so.1", M_SUBSTR},
+	/* left to the regular expression engine */
+	{".port", M_REGEX},
+	{"port.", M_REGEX},
+	{"", M_REGEX},
+	{"^", M_REGEX},
+	{"$", M_REGEX},
+	{"^$", M_REGEX},
+	{"a$b", M_REGEX},
+	{"a^b", M_REGEX},
+	{"(^|/)ls", M_REGEX},
+	{"port|doc", M_REGEX},
+	{"po*rt", M_REGEX},
+	{"[Pp]ort", M_REGEX},
+	{"\\<port", M_REGEX},
+	{"port\\>", M_REGEX},
+	{"\\`bin", M_REGEX},
+	{"gz\\'", M_REGEX},
+	{"\\w", M_REGEX},
+	{"(a)\\1", M_REGEX},
+};
+
+#define PATTERNS_CNT	(sizeof(patterns) / sizeof(patterns[0]))
+
+static const char *const	subjects[] = {
+	"",
+	"a",
+	"ls",
+	"bin/ls",
+	"bin/lsx",
+	"xbin/ls",
+	"bin/port0001",
+	"BIN/PORT0001",
+	"bin/port0001x",
+	"share/doc/port0001/README",
+	"share/doc/port0001/readme",
+	"share/doc/README.txt",
+	"share/man/man1/ls.1.gz",
+	"share/man/man1/ls.1xgz",
+	"lib/libfoo.so.1",
+	"lib/libfoo.so11",
+	".so",
+	"xso",
+	"share/a.b/c^d$e",
+	"share/aXb/c",
+	"libexec/a+b",
+	"share/(x)",
+	"share/data[1].dat",
+	"share/Weird|Pipe/File",
+	"share/weird|pipe/file",
+	"share/back\\slash",
+	"b.n/p.rt",
+	"bun/pert",
+	"portport",
+	"ppport",
+	"PORT",
+	"Xort",
+	"_ort",
+	"]x",
+	"AX",
+	"-",
+	"F",
+	"g",
+	"3.dat",
+	"[1]",
+	"share/\\slash",
+	"[",
+	"`",
+};
+
+#define SUBJECTS_CNT	(sizeof(subjects) / sizeof(subjects[0]))
+
+/* a pattern and whether m_fold_pattern() can lowercase it */
+struct fold_t {
+	const char	*pattern;
+	int		foldable;
+};
+
+static const struct fold_t	folds[] = {
+	{"README", 1},
+	{"Bin/Port", 1},
+	{"Port.*Doc", 1},
+	{"^BIN|readme$", 1},
+	{"(^|/)LS$", 1},
+	{"X{2}", 1},
+	/* brackets */
+	{"[Pp]ORT", 1},
+	{"[^A-Z]ort", 1},
+	{"[]A]x", 1},
+	{"[^]a]X", 1},
+	{"[A-Z]ort", 1},
+	{"[a-z]ORT", 1},
+	{"[A-Fa-f]", 1},
+	{"[0-9]\\.DAT", 1},
+	{"[-A]", 1},
+	{"[A-]", 1},
+	{"[A-z]", 0},
+	{"[Z-a]", 0},
+	{"[0-Z]", 0},
+	/* classes and the like are not lowercased by regcomp(3) */
+	{"[[:upper:]]", 0},
+	{"[[:lower:]]ort", 0},
+	{"x[[:alpha:]]", 0},
+	{"[[=A=]]", 0},
+	{"[[.A.]]", 0},
+	/* escapes */
+	{"a\\.B", 1},
+	{"\\[1\\]", 1},
+	{"\\<Port", 1},
+	{"\\\\Slash", 1},
+	{"\\w", 0},
+	{"\\W", 0},
+	{"\\bPort", 0},
+	{"\\S", 0},
+};
+
+#define FOLDS_CNT	(sizeof(folds) / sizeof(folds[0]))
+
+static int	failed;
+
+/*
+ * Check the pattern `p' compiled with `cflags' against all subjects, as
+ * they are and surrounded by PAD, with and without AVX2
+ */
+static void check_pattern(const struct pattern_t *p, int cflags);
+
+/*
+ * Check that `m' and `re' agree on `str'
+ */
+static void check_subject(const struct match_t *m, const regex_t *re,
+			  const char *pattern, const char *str);
+
+/*
+ * Check m_fold_pattern() on `f' against all subjects
+ */
+static void check_fold(const struct fold_t *f);
+
+/***/
+
+int
+main(void)
+{
+	size_t	i;
+
+	for (i = 0; i < PATTERNS_CNT; i++)
+	{
+		check_pattern(&patterns[i], REG_EXTENDED | REG_NOSUB);
+		check_pattern(&patterns[i],
+			      REG_EXTENDED | REG_NOSUB | REG_ICASE);
+	}
+
+	for (i = 0; i < FOLDS_CNT; i++)
+		check_fold(&folds[i]);
+
+	if (failed)
+		return 1;
+
+	printf("match_test: %u patterns, %u lowercased patterns ok\n",
+	       (unsigned)PATTERNS_CNT, (unsigned)FOLDS_CNT);
+
+	return 0;
+}
+
+static void
+check_pattern(const struct pattern_t *p, int cflags)
+{
+	struct match_t	m;
+	regex_t		re;
+	char		str[2 * PAD_LEN + 64];
+	size_t		i;
+
+	m_comp(&m, p->pattern, cflags);
+
+	if (m.kind != p->kind)
+	{
+		fprintf(stderr, "match_test: %s: matched as %s\n",
+			p->pattern, m_kind_name(&m));
+		failed = 1;
+	}
+
+	xregcomp(&re, p->pattern, cflags);
+
+	for (;;)
+	{
+		for (i = 0; i < SUBJECTS_CNT; i++)
+		{
+			check_subject(&m, &re, p->pattern, subjects[i]);
+
+			snprintf(str, sizeof(str), "%s%s", PAD, subjects[i]);
+			check_subject(&m, &re, p->pattern, str);
+
+			snprintf(str, sizeof(str), "%s%s", subjects[i], PAD);
+			check_subject(&m, &re, p->pattern, str);
+
+			snprintf(str, sizeof(str), "%s%s%s", PAD, subjects[i],
+				 PAD);
+			check_subject(&m, &re, p->pattern, str);
+		}
+
+		if (!m.avx2)
+			break;
+
+		/* once more without AVX2 */
+		m.avx2 = 0;
+	}
+
+	xregfree(&re);
+	m_free(&m);
+}
+
+static void
+check_subject(const struct match_t *m, const regex_t *re,
+	      const char *pattern, const char *str)
+{
+	int	expected;
+
+	expected = regexec(re, str, 0, NULL, 0) == 0;
+
+	if (m_match(m, str, strlen(str)) != expected)
+	{
+		fprintf(stderr, "match_test: %s%s%s: %s \"%s\"\n", pattern,
+			m->icase ? " (icase)" : "", m->avx2 ? " (AVX2)" : "",
+			expected ? "does not match" : "matches", str);
+		failed = 1;
+	}
+}
+
+static void
+check_fold(const struct fold_t *f)
+{
+	regex_t		re, fre;
+	char		*folded;
+	char		str[PAD_LEN + 64];
+	size_t		i;
+	int		expected;
+
+	folded = m_fold_pattern(f->pattern);
+
+	if ((folded != NULL) != f->foldable)
+	{
+		fprintf(stderr, "match_test: %s: %s\n", f->pattern,
+			f->foldable ? "not lowercased" : "lowercased");
+		failed = 1;
+	}
+
+	if (folded == NULL)
+		return;
+
+	xregcomp(&re, f->pattern, REG_EXTENDED | REG_NOSUB | REG_ICASE);
+	xregcomp(&fre, folded, REG_EXTENDED | REG_NOSUB);
+
+	for (i = 0; i < SUBJECTS_CNT; i++)
+	{
+		snprintf(str, sizeof(str), "%s", subjects[i]);
+
+		expected = regexec(&re, str, 0, NULL, 0) == 0;
+
+		m_fold(str, str, strlen(str));
+
+		if ((regexec(&fre, str, 0, NULL, 0) == 0) != expected)
+		{
+			fprintf(stderr, "match_test: %s lowercased to %s: %s "
+				"\"%s\"\n", f->pattern, folded,
+				expected ? "does not match" : "matches",
+				subjects[i]);
+			failed = 1;
+		}
+	}
+
+	xregfree(&re);
+	xregfree(&fre);
+	xfree(folded);
+}
+
+/* EOF */
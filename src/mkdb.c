@@ -29,32 +29,102 @@
 #include <sys/param.h>
 #include <sys/stat.h>
 
+#include <dirent.h>
 #include <err.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sysexits.h>
-#if __FreeBSD_version < 500000
-/* we use chdir(2) on 4.x */
 #include <unistd.h>
-#endif
 
 #include "execcmd.h"
 #include "exhaust_fp.h"
+#include "gitdiff.h"
+#include "lineiter.h"
 #include "logmsg.h"
 #include "mkdb.h"
 #include "parse_indexln.h"
+#include "plistexp.h"
 #include "portdef.h"
 #include "portsearch.h"
+#include "sepscan.h"
 #include "store.h"
 #include "vector.h"
 #include "xlibc.h"
 
+/* FNV-1a */
+#define FPRINT_INIT	14695981039346656037ULL
+#define FPRINT_PRIME	1099511628211ULL
+
+/*
+ * Files in the port's directory a port's plist depends on, the other
+ * files make reads are found with MAKEFILES_VAR, see port_t.fdeps
+ */
+static const char *const	fprint_files[] = {
+	"Makefile",
+	"pkg-plist",
+	"distinfo",
+	"Makefile.inc",
+	NULL
+};
+
+/*
+ * What show-plist in Mk/Makefile uses, in the order pe_expand() takes
+ * them. PLIST_DIRS is not needed, it only produces @dir lines.
+ */
+#define PLIST_VARS_CNT	3
+static const char *const	plist_vars[PLIST_VARS_CNT] = {
+	"PLIST_SUB_SANITIZED",
+	"PLIST_FILES",
+	"PLIST"
+};
+
+/* the makefiles make has read, asked for along with plist_vars */
+#define MAKEFILES_VAR	".MAKE.MAKEFILES"
+
+enum job_state {
+	JOB_PENDING,  /* plist source not decided yet */
+	JOB_RUNNING,  /* make is generating the plist */
+	JOB_DONE  /* ready to be added to the store */
+};
+
+/* a port on its way to the store */
+struct job_t {
+	struct port_t	port;
+	enum job_state	state;
+	pid_t		pid;  /* of make, when running */
+	int		fd;  /* make's stdout, when running */
+	char		*out;  /* make's output collected so far */
+	size_t		out_len;
+	size_t		out_sz;
+};
+
 /* process_indexline parameter */
 struct pi_arg_t {
 	const struct options_t	*opts;
 	struct store_t		*store;
 	int			s_exists;
+	int			mk_changed;  /* since the old store was made */
+	int			since;  /* only ports changed in `gd' are checked */
+	struct gitdiff_t	gd;
 	char			*category;
+	struct sepscan_t	ss;  /* for parse_indexln() */
+
+	/*
+	 * Ports are queued in INDEX order and leave the queue in the
+	 * same order, so that ids do not depend on which make finishes
+	 * first.
+	 */
+	struct job_t		*jobs;
+	size_t			jobs_sz;  /* allocated elements in jobs */
+	size_t			jobs_head;
+	size_t			jobs_cnt;
+	int			running;  /* number of make processes */
+	struct pollfd		*pfds;  /* opts->jobs elements */
+	struct job_t		**pjobs;  /* job for each element of pfds */
 };
 
 static char	portsindex[PATH_MAX];
@@ -66,24 +136,53 @@ static void set_portsindex(const char *portsdir);
 static void _set_portsindex(char *line, void *arg);
 
 /*
- * Process single line from ports' INDEX file
+ * Process single line from ports' INDEX file, which starts at `line'
+ * and is `len' bytes long, the newline is not included
  */
-static void process_indexline(char *line, void *arg_void);
+static void process_indexline(const char *line, size_t len,
+			      struct pi_arg_t *arg);
+
+/*
+ * exhaust_fp() callback for process_indexline(), used if the INDEX file
+ * can not be mmap(2)ed
+ */
+static void process_indexline_fp(char *line, void *arg_void);
 
 /*
  * port->path must be initialized
  * Initialize:
  * port->id using internal counter
- * port->plist by either generating it or retrieving it from
- * the old store (if one exists and port has not been modified recently)
+ * port->plist by retrieving it from the old store (if one exists and
+ * port has not been modified recently)
+ * Return nonzero if the plist has to be generated instead.
  */
-static void set_port_data(struct port_t *port, const struct pi_arg_t *arg);
+static int set_port_data(struct port_t *port, const struct pi_arg_t *arg);
 
 /*
- * Create the packing list for a given port using make generate-plist
- * port->path must be initialized
+ * Start creating the packing list for a given port, make is only asked
+ * for the variables the packing list is made of (PLIST_VARS) and for the
+ * makefiles it read (MAKEFILES_VAR), the packing list is expanded by
+ * pe_expand() when make exits. There is one make per port,
+ * bsd.port.mk defines its variables from the port's Makefile, so a make
+ * process can not evaluate them for several ports.
+ * job->port.path must be initialized
+ */
+static void mkplist(struct job_t *job, struct pi_arg_t *arg);
+
+/*
+ * Wait until some of the running make processes produce output or exit
  */
-static void mkplist(struct port_t *port, const struct pi_arg_t *arg);
+static void wait_jobs(struct pi_arg_t *arg);
+
+/*
+ * Read available output of a running job, finish it on EOF
+ */
+static void read_job(struct job_t *job, struct pi_arg_t *arg);
+
+/*
+ * Add the finished jobs at the head of the queue to the store
+ */
+static void flush_jobs(struct pi_arg_t *arg);
 
 /*
  * Add file to port's plist
@@ -101,47 +200,175 @@ static const char *mk_port_short_path(const char *portsdir,
  */
 static const char *mk_pkgversion(const char *pkgname);
 
+/*
+ * Add `len' bytes at `data' to fingerprint `h' and return the result
+ */
+static uint64_t fprint_add(uint64_t h, const void *data, size_t len);
+
+/*
+ * Add file `name' to fingerprint `h', its size and modification time
+ * or that it does not exist
+ */
+static uint64_t fprint_file(uint64_t h, const char *name,
+			    const struct stat *sb);
+
+/*
+ * Fingerprint of the files in the port's directory, see fprint_files,
+ * and of the files in `fdeps' (see port_t), which may be NULL. The plist
+ * does not have to be generated again while it is the same.
+ */
+static uint64_t port_fprint(const char *portsdir, const char *portpath,
+			    const char *fdeps);
+
+/*
+ * Make port_t.fdeps for the port at `portpath' out of the space
+ * separated lists of files `plist' (PLIST) and `makefiles'
+ * (MAKEFILES_VAR)
+ */
+static char *mk_fdeps(const char *portsdir, const char *portpath,
+		      const char *plist, const char *makefiles);
+
+/*
+ * Add `file', which is `file_len' bytes long, to `*fdeps' unless the
+ * fingerprint covers it already. `*fdeps' has `*len' bytes used out of
+ * `*sz' and is reallocated as needed.
+ */
+static void add_fdep(char **fdeps, size_t *len, size_t *sz,
+		     const char *portsdir, const char *portpath,
+		     const char *file, size_t file_len);
+
+/*
+ * Fingerprint of all files below directory `dir', 0 if it can not be
+ * read
+ */
+static uint64_t dir_fprint(const char *dir);
+
 /***/
 
 void
 mkdb(const struct options_t *opts)
 {
-	struct pi_arg_t	arg;
-	FILE		*portsindex_fp;
+	struct pi_arg_t		arg;
+	struct store_meta_t	meta;
+	struct store_meta_t	old_meta;
+	int			old_meta_ok;
+	char			mk_dir[PATH_MAX];
+	const char		*rev;
+	FILE			*portsindex_fp;
+	struct lineiter_t	li;
+	const char		*line;
+	size_t			line_len;
 
 	arg.opts = opts;
 
+	/* leave room for ports whose plists are taken from the old store */
+	arg.jobs_sz = opts->jobs * 4;
+	arg.jobs = (struct job_t *)xmalloc(arg.jobs_sz * sizeof(struct job_t));
+	arg.jobs_head = 0;
+	arg.jobs_cnt = 0;
+	arg.running = 0;
+	arg.pfds = (struct pollfd *)xmalloc(opts->jobs * sizeof(struct pollfd));
+	arg.pjobs = (struct job_t **)xmalloc(opts->jobs * sizeof(struct job_t *));
+	ss_start(&arg.ss);
+
 	set_portsindex(opts->portsdir);
 
 	logmsg(L_NOTICE, opts->verbose, "Creating store\n");
 
 	alloc_store(&arg.store);
 
+	snprintf(mk_dir, sizeof(mk_dir), "%s/Mk", opts->portsdir);
+	meta.mk_fprint = dir_fprint(mk_dir);
+
+	gd_head(opts->portsdir, meta.commit, sizeof(meta.commit));
+
 	arg.s_exists = s_exists();
+	arg.mk_changed = 0;
+	arg.since = 0;
+	old_meta_ok = 0;
 	if (arg.s_exists)
 	{
 		s_read_start(arg.store);
 		logmsg(L_NOTICE, opts->verbose,
 		       "Using data from existent store\n");
+
+		old_meta_ok = s_read_meta(&old_meta);
+
+		/* every plist may depend on the framework */
+		if (old_meta_ok && old_meta.mk_fprint != 0 &&
+		    old_meta.mk_fprint != meta.mk_fprint)
+			arg.mk_changed = 1;
 	}
 	else
 		logmsg(L_NOTICE, opts->verbose,
 		       "Previous store does not exist, creating from scratch\n");
 
+	if (opts->update_since != NULL && arg.s_exists)
+	{
+		rev = opts->update_since;
+		if (strcmp(rev, SINCE_STORED) == 0)
+			rev = old_meta_ok ? old_meta.commit : "";
+
+		if (rev[0] != '\0')
+		{
+			gd_start(&arg.gd, opts->portsdir, rev);
+			arg.since = 1;
+			/* every plist may depend on the framework */
+			if (arg.gd.framework)
+				arg.mk_changed = 1;
+			logmsg(L_NOTICE, opts->verbose,
+			       "%u ports or categories changed since %s\n",
+			       (unsigned)arg.gd.dirs.nelems, rev);
+		}
+		else
+			logmsg(L_WARNING, opts->verbose,
+			       "The store does not record a git revision, checking all ports\n");
+	}
+
+	if (arg.mk_changed)
+		logmsg(L_NOTICE, opts->verbose,
+		       "%s changed, recreating data for all ports\n", mk_dir);
+
 	s_new_start(arg.store);
 
-	portsindex_fp = xfopen(portsindex, "r");
+	/* spare the searches from asking make again */
+	snprintf(meta.portsdir, sizeof(meta.portsdir), "%s", opts->portsdir);
+	snprintf(meta.indexfile, sizeof(meta.indexfile), "%s", portsindex);
+	s_new_meta(arg.store, &meta);
+
+	if (li_open(&li, portsindex) == 0)
+	{
+		while (li_next(&li, &line, &line_len))
+			process_indexline(line, line_len, &arg);
 
-	exhaust_fp(portsindex_fp, process_indexline, &arg);
+		li_close(&li);
+	}
+	else
+	{
+		portsindex_fp = xfopen(portsindex, "r");
 
-	xfclose(portsindex_fp, portsindex);
+		exhaust_fp(portsindex_fp, process_indexline_fp, &arg);
+
+		xfclose(portsindex_fp, portsindex);
+	}
+
+	while (arg.jobs_cnt > 0)
+		wait_jobs(&arg);
 
 	s_new_end(arg.store);
 
+	if (arg.since)
+		gd_end(&arg.gd);
+
 	if (arg.s_exists)
 		s_read_end(arg.store);
 
 	free_store(arg.store);
+
+	xfree(arg.jobs);
+	xfree(arg.pfds);
+	xfree(arg.pjobs);
+	ss_destroy(&arg.ss);
 }
 
 static void
@@ -168,37 +395,54 @@ _set_portsindex(char *line, void *arg)
 }
 
 static void
-process_indexline(char *line, void *arg_void)
+process_indexline(const char *line, size_t len, struct pi_arg_t *arg)
 {
-	struct pi_arg_t	*arg = (struct pi_arg_t *)arg_void;
-	struct port_t	addport;
+	struct job_t	*job;
 
-	addport.indexln_raw = line;
+	/* the head of a full queue is always running */
+	while (arg->jobs_cnt == arg->jobs_sz)
+		wait_jobs(arg);
 
-	v_start(&addport.plist, 256);
+	job = &arg->jobs[(arg->jobs_head + arg->jobs_cnt) % arg->jobs_sz];
+	arg->jobs_cnt++;
 
-	parse_indexln(&addport);
+	job->state = JOB_PENDING;
+	job->out = NULL;
 
-#define TEST	0
+	/* `line' is not ours to keep, but the port may wait */
+	job->port.fdeps = NULL;
+
+	job->port.indexln_raw = (char *)xmalloc(len + 1);
+	memcpy(job->port.indexln_raw, line, len);
+	job->port.indexln_raw[len] = '\0';
+
+	v_start(&job->port.plist, 256);
+
+	parse_indexln(&job->port, len, &arg->ss);
 
-#if TEST
-	if (strncmp("/usr/ports/archivers", addport.path, 20) == 0)
-	{
-#endif
 	logmsg(L_INFO, arg->opts->verbose, "==> %s\n",
-	       mk_port_short_path(arg->opts->portsdir, addport.path));
+	       mk_port_short_path(arg->opts->portsdir, job->port.path));
 
-	set_port_data(&addport, arg);
+	if (set_port_data(&job->port, arg))
+	{
+		while (arg->running >= arg->opts->jobs)
+			wait_jobs(arg);
 
-	s_add_port(arg->store, &addport);
-#if TEST
+		mkplist(job, arg);
 	}
-#endif
+	else
+		job->state = JOB_DONE;
 
-	v_destroy(&addport.plist);
+	flush_jobs(arg);
 }
 
 static void
+process_indexline_fp(char *line, void *arg_void)
+{
+	process_indexline(line, strlen(line), (struct pi_arg_t *)arg_void);
+}
+
+static int
 set_port_data(struct port_t *port, const struct pi_arg_t *arg)
 {
 	static unsigned	portid = 1;
@@ -207,22 +451,49 @@ set_port_data(struct port_t *port, const struct pi_arg_t *arg)
 	const char	*pkgver_index;
 	const char	*pkgver_store;
 
-	struct port_t	*store_port;
+	const struct ports_t	*store_ports;
+	size_t		store_idx;  /* of the port in store_ports */
+	int		found;  /* in the old store */
 	int		gen_plist;
+	int		untouched;  /* not changed in git, see --since */
 
 	spath = mk_port_short_path(arg->opts->portsdir, port->path);
 
 	pkgver_index = mk_pkgversion(port->pkgname);
 
+	found = arg->s_exists &&
+		s_load_port_by_path(arg->store, port->path, &store_idx) != -1;
+
+	if (found)
+	{
+		store_ports = get_ports(arg->store);
+
+		/* the other files make read when the stored plist was made */
+		if (store_ports->fdeps[store_idx] != NULL)
+			port->fdeps = xstrdup(store_ports->fdeps[store_idx]);
+	}
+
+	/*
+	 * Without the list of the other files, a change to e.g. the master
+	 * port would go unnoticed, the fingerprint is checked instead
+	 */
+	untouched = arg->since && !arg->mk_changed && port->fdeps != NULL &&
+		!gd_port_changed(&arg->gd, port->path, port->fdeps);
+
+	/* before make runs, so that changes made meanwhile are noticed */
+	port->fprint = untouched ? 0 :
+		port_fprint(arg->opts->portsdir, port->path, port->fdeps);
+
 	logmsg(L_DEBUG, arg->opts->verbose, "===> %s INDEX version: %s\n",
 	       spath, pkgver_index);
 
 	if (arg->s_exists)
 	{
-		if (s_load_port_by_path(arg->store, port->path, &store_port)
-		    != -1)
+		if (found)
 		{
-			pkgver_store = mk_pkgversion(store_port->pkgname);
+			pkgver_store = mk_pkgversion(PORT_FLD(store_ports,
+							      store_idx,
+							      PF_PKGNAME));
 
 			logmsg(L_DEBUG, arg->opts->verbose,
 			       "===> %s STORE version: %s\n", spath,
@@ -235,6 +506,30 @@ set_port_data(struct port_t *port, const struct pi_arg_t *arg)
 				       spath);
 				gen_plist = 1;
 			}
+			else if (untouched)
+			{
+				logmsg(L_INFO, arg->opts->verbose,
+				       "===> %s not changed in git, using stored data\n",
+				       spath);
+				port->fprint = store_ports->fprints[store_idx];
+				gen_plist = 0;
+			}
+			/* not known for stores made by older versions */
+			else if (store_ports->fprints[store_idx] != 0 &&
+				 store_ports->fprints[store_idx] != port->fprint)
+			{
+				logmsg(L_INFO, arg->opts->verbose,
+				       "===> %s files changed, recreating data\n",
+				       spath);
+				gen_plist = 1;
+			}
+			else if (arg->mk_changed)
+			{
+				logmsg(L_INFO, arg->opts->verbose,
+				       "===> %s Mk changed, recreating data\n",
+				       spath);
+				gen_plist = 1;
+			}
 			else
 			{
 				logmsg(L_INFO, arg->opts->verbose,
@@ -255,45 +550,202 @@ set_port_data(struct port_t *port, const struct pi_arg_t *arg)
 	else  /* store does not exist */
 		gen_plist = 1;
 
-	if (gen_plist)
-		mkplist(port, arg);
-	else
+	if (!gen_plist)
 	{
-		port->id = store_port->id;  /* temporary set to the old id */
+		/* temporary set to the old id */
+		port->id = store_ports->ids[store_idx];
 		s_load_port_plist(arg->store, port);
 	}
 
 	port->id = portid;
 
 	portid++;
+
+	return gen_plist;
 }
 
 static void
-mkplist(struct port_t *port, const struct pi_arg_t *arg)
+mkplist(struct job_t *job, struct pi_arg_t *arg)
 {
-	char		our_makefile[PATH_MAX];
+	struct port_t	*port = &job->port;
 	char		port_makefile[PATH_MAX];
 	char		*cmd = "make";
 #if __FreeBSD_version >= 500000
 	char *const	args[] = {cmd,
-		"-C", port->path, "-f", port_makefile, "-f", our_makefile,
-		"show-plist", NULL};
+		"-C", port->path, "-f", port_makefile,
+		"-V", (char *)plist_vars[0],
+		"-V", (char *)plist_vars[1],
+		"-V", (char *)plist_vars[2],
+		"-V", MAKEFILES_VAR, NULL};
 #else  /* 4.x handles -C differently */
 	char		curdir_arg[PATH_MAX];
 	char *const	args[] = {cmd,
 		"-C", port->path, curdir_arg,
-		"-f", port_makefile, "-f", our_makefile,
-		"show-plist", NULL};
+		"-f", port_makefile,
+		"-V", (char *)plist_vars[0],
+		"-V", (char *)plist_vars[1],
+		"-V", (char *)plist_vars[2],
+		"-V", MAKEFILES_VAR, NULL};
 	snprintf(curdir_arg, sizeof(curdir_arg), ".CURDIR=%s", port->path);
 
 	/* math/vecfem does .include <Makefile.inc>, no hope for this on 4.x */
 	chdir(port->path);
 #endif
 
-	snprintf(our_makefile, sizeof(our_makefile), "%s/Makefile", DATADIR);
 	snprintf(port_makefile, sizeof(port_makefile), "%s/Makefile", port->path);
 
-	execcmd(cmd, args, add_pfile, port);
+	job->pid = execcmd_start(cmd, args, &job->fd);
+
+	job->out_sz = BUFSIZ;
+	job->out = (char *)xmalloc(job->out_sz);
+	job->out_len = 0;
+
+	job->state = JOB_RUNNING;
+
+	arg->running++;
+}
+
+static void
+wait_jobs(struct pi_arg_t *arg)
+{
+	struct job_t	*job;
+	nfds_t		n;
+	size_t		i;
+
+	n = 0;
+	for (i = 0; i < arg->jobs_cnt; i++)
+	{
+		job = &arg->jobs[(arg->jobs_head + i) % arg->jobs_sz];
+
+		if (job->state != JOB_RUNNING)
+			continue;
+
+		arg->pfds[n].fd = job->fd;
+		arg->pfds[n].events = POLLIN;
+		arg->pfds[n].revents = 0;
+		arg->pjobs[n] = job;
+		n++;
+	}
+
+	if (n > 0 && poll(arg->pfds, n, -1) == -1)
+	{
+		if (errno != EINTR)
+			err(EX_OSERR, "poll()");
+		return;
+	}
+
+	for (i = 0; i < n; i++)
+		if (arg->pfds[i].revents != 0)
+			read_job(arg->pjobs[i], arg);
+
+	flush_jobs(arg);
+}
+
+static void
+read_job(struct job_t *job, struct pi_arg_t *arg)
+{
+	ssize_t	rd_len;
+	char	*line, *nl;
+	char	*vals[PLIST_VARS_CNT + 1];
+	char	*fdeps;
+	int	i;
+
+	if (job->out_sz - job->out_len < BUFSIZ)
+	{
+		job->out_sz *= 2;
+		if ((job->out = realloc(job->out, job->out_sz)) == NULL)
+			err(EX_OSERR, "realloc(): %u", (unsigned)job->out_sz);
+	}
+
+	/* leave room for the terminating NUL */
+	rd_len = read(job->fd, job->out + job->out_len,
+		      job->out_sz - job->out_len - 1);
+
+	if (rd_len == -1)
+	{
+		if (errno == EINTR || errno == EAGAIN)
+			return;
+		err(EX_IOERR, "read(): %s", job->port.path);
+	}
+
+	if (rd_len > 0)
+	{
+		job->out_len += rd_len;
+		return;
+	}
+
+	/* EOF, make is done */
+
+	if (close(job->fd) == -1)
+		err(EX_OSERR, "close(): %d", job->fd);
+
+	execcmd_wait("make", job->pid);
+
+	job->out[job->out_len] = '\0';
+
+	/* one line for each of plist_vars and MAKEFILES_VAR */
+	line = job->out;
+	for (i = 0; i < PLIST_VARS_CNT + 1; i++)
+	{
+		vals[i] = line;
+		if ((nl = strchr(line, '\n')) != NULL)
+		{
+			nl[0] = '\0';
+			line = nl + 1;
+		}
+		else
+			line += strlen(line);
+	}
+
+	/* before pe_expand(), which splits PLIST in place */
+	fdeps = mk_fdeps(arg->opts->portsdir, job->port.path, vals[2],
+			 vals[PLIST_VARS_CNT]);
+
+	/*
+	 * The fingerprint was taken with the files make read the last time,
+	 * take it again if these are not the same any more
+	 */
+	if (job->port.fdeps == NULL || strcmp(job->port.fdeps, fdeps) != 0)
+		job->port.fprint = port_fprint(arg->opts->portsdir,
+					       job->port.path, fdeps);
+
+	if (job->port.fdeps != NULL)
+		xfree(job->port.fdeps);
+	job->port.fdeps = fdeps;
+
+	pe_expand(job->port.path, vals[0], vals[1], vals[2],
+		  add_pfile, &job->port);
+
+	xfree(job->out);
+	job->out = NULL;
+
+	job->state = JOB_DONE;
+
+	arg->running--;
+}
+
+static void
+flush_jobs(struct pi_arg_t *arg)
+{
+	struct job_t	*job;
+
+	while (arg->jobs_cnt > 0)
+	{
+		job = &arg->jobs[arg->jobs_head];
+
+		if (job->state != JOB_DONE)
+			break;
+
+		s_add_port(arg->store, &job->port);
+
+		v_destroy(&job->port.plist);
+		xfree(job->port.indexln_raw);
+		if (job->port.fdeps != NULL)
+			xfree(job->port.fdeps);
+
+		arg->jobs_head = (arg->jobs_head + 1) % arg->jobs_sz;
+		arg->jobs_cnt--;
+	}
 }
 
 static void
@@ -330,4 +782,205 @@ mk_pkgversion(const char *pkgname)
 	return ++ret;
 }
 
+static uint64_t
+fprint_add(uint64_t h, const void *data, size_t len)
+{
+	const unsigned char	*p = (const unsigned char *)data;
+	size_t			i;
+
+	for (i = 0; i < len; i++)
+	{
+		h ^= p[i];
+		h *= FPRINT_PRIME;
+	}
+
+	return h;
+}
+
+static uint64_t
+fprint_file(uint64_t h, const char *name, const struct stat *sb)
+{
+	int64_t	v;
+
+	h = fprint_add(h, name, strlen(name) + 1);
+
+	if (sb == NULL)
+	{
+		v = -1;
+		return fprint_add(h, &v, sizeof(v));
+	}
+
+	v = (int64_t)sb->st_mtime;
+	h = fprint_add(h, &v, sizeof(v));
+	v = (int64_t)sb->st_size;
+	h = fprint_add(h, &v, sizeof(v));
+
+	return h;
+}
+
+static uint64_t
+port_fprint(const char *portsdir, const char *portpath, const char *fdeps)
+{
+	char		fn[PATH_MAX];
+	char		name[PATH_MAX];
+	struct stat	sb;
+	uint64_t	h;
+	const char	*nl;
+	int		i;
+
+	h = FPRINT_INIT;
+
+	for (i = 0; fprint_files[i] != NULL; i++)
+	{
+		snprintf(fn, sizeof(fn), "%s/%s", portpath, fprint_files[i]);
+
+		h = fprint_file(h, fprint_files[i],
+				stat(fn, &sb) == 0 ? &sb : NULL);
+	}
+
+	for (; fdeps != NULL && (nl = strchr(fdeps, '\n')) != NULL;
+	     fdeps = nl + 1)
+	{
+		snprintf(name, sizeof(name), "%.*s", (int)(nl - fdeps), fdeps);
+		snprintf(fn, sizeof(fn), "%s/%s", portsdir, name);
+
+		h = fprint_file(h, name, stat(fn, &sb) == 0 ? &sb : NULL);
+	}
+
+	/* 0 means unknown */
+	return h != 0 ? h : 1;
+}
+
+static char *
+mk_fdeps(const char *portsdir, const char *portpath, const char *plist,
+	 const char *makefiles)
+{
+	const char	*lists[2];
+	const char	*p, *end;
+	char		*fdeps;
+	size_t		len, sz;
+	int		i;
+
+	lists[0] = plist;
+	lists[1] = makefiles;
+
+	sz = 256;
+	fdeps = (char *)xmalloc(sz);
+	len = 0;
+
+	for (i = 0; i < 2; i++)
+		for (p = lists[i]; *p != '\0'; p = end)
+		{
+			while (*p == ' ' || *p == '\t')
+				p++;
+			for (end = p; *end != '\0' && *end != ' ' &&
+			     *end != '\t'; end++)
+				;
+			if (end > p)
+				add_fdep(&fdeps, &len, &sz, portsdir, portpath,
+					 p, end - p);
+		}
+
+	fdeps[len] = '\0';
+
+	return fdeps;
+}
+
+static void
+add_fdep(char **fdeps, size_t *len, size_t *sz, const char *portsdir,
+	 const char *portpath, const char *file, size_t file_len)
+{
+	const char	*rel, *name, *p;
+	size_t		dir_len, rel_len, name_len;
+	int		i;
+
+	/* files outside the tree, e.g. sys.mk, are not looked at */
+	dir_len = strlen(portsdir);
+	if (file_len <= dir_len + 1 ||
+	    strncmp(file, portsdir, dir_len) != 0 || file[dir_len] != '/')
+		return;
+
+	rel = file + dir_len + 1;
+	rel_len = file_len - dir_len - 1;
+
+	/* the framework has its own fingerprint, see dir_fprint() */
+	if (rel_len > 3 && strncmp(rel, "Mk/", 3) == 0)
+		return;
+
+	/* already in the fingerprint, see fprint_files */
+	dir_len = strlen(portpath);
+	if (file_len > dir_len + 1 &&
+	    strncmp(file, portpath, dir_len) == 0 && file[dir_len] == '/')
+	{
+		name = file + dir_len + 1;
+		name_len = file_len - dir_len - 1;
+
+		for (i = 0; fprint_files[i] != NULL; i++)
+			if (strlen(fprint_files[i]) == name_len &&
+			    strncmp(name, fprint_files[i], name_len) == 0)
+				return;
+	}
+
+	/* make -V .MAKE.MAKEFILES lists a file once per .include */
+	for (p = *fdeps; p < *fdeps + *len; p = strchr(p, '\n') + 1)
+		if (strncmp(p, rel, rel_len) == 0 && p[rel_len] == '\n')
+			return;
+
+	/* the newline and mk_fdeps()'s terminating NUL */
+	if (*len + rel_len + 2 > *sz)
+	{
+		while (*len + rel_len + 2 > *sz)
+			*sz *= 2;
+		if ((*fdeps = realloc(*fdeps, *sz)) == NULL)
+			err(EX_OSERR, "realloc(): %u", (unsigned)*sz);
+	}
+
+	memcpy(*fdeps + *len, rel, rel_len);
+	*len += rel_len;
+	(*fdeps)[(*len)++] = '\n';
+}
+
+static uint64_t
+dir_fprint(const char *dir)
+{
+	DIR		*d;
+	struct dirent	*de;
+	char		fn[PATH_MAX];
+	struct stat	sb;
+	uint64_t	h, sum;
+
+	if ((d = opendir(dir)) == NULL)
+		return 0;
+
+	/* entries are summed, readdir(3) order does not matter */
+	sum = 0;
+
+	while ((de = readdir(d)) != NULL)
+	{
+		if (strcmp(de->d_name, ".") == 0 ||
+		    strcmp(de->d_name, "..") == 0)
+			continue;
+
+		snprintf(fn, sizeof(fn), "%s/%s", dir, de->d_name);
+
+		if (stat(fn, &sb) == -1)
+			continue;
+
+		if (S_ISDIR(sb.st_mode))
+		{
+			h = fprint_add(FPRINT_INIT, de->d_name,
+				       strlen(de->d_name) + 1);
+			h = dir_fprint(fn) ^ h;
+		}
+		else
+			h = fprint_file(FPRINT_INIT, de->d_name, &sb);
+
+		sum += h;
+	}
+
+	closedir(d);
+
+	return sum != 0 ? sum : 1;
+}
+
 /* EOF */
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+
+#include <err.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include "parallel.h"
+#include "xlibc.h"
+
+/* a thread's share of the work */
+struct par_job_t {
+	pthread_t	tid;
+	size_t		i;
+	void		(*fn)(size_t, void *);
+	void		*arg;
+};
+
+/*
+ * Thread start routine, calls job->fn
+ */
+static void *par_start(void *job_void);
+
+/***/
+
+size_t
+par_ncpus()
+{
+	long	n;
+
+	if ((n = sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+		return 1;
+
+	return (size_t)n;
+}
+
+void
+par_run(size_t n, void (*fn)(size_t i, void *arg), void *arg)
+{
+	struct par_job_t	*jobs;
+	size_t			i;
+	int			e;
+
+	/* no need to create threads for a single piece of work */
+	if (n == 1)
+	{
+		fn(0, arg);
+		return;
+	}
+
+	jobs = (struct par_job_t *)xmalloc(n * sizeof(struct par_job_t));
+
+	for (i = 0; i < n; i++)
+	{
+		jobs[i].i = i;
+		jobs[i].fn = fn;
+		jobs[i].arg = arg;
+
+		if ((e = pthread_create(&jobs[i].tid, NULL, par_start, &jobs[i]))
+		    != 0)
+			errx(EX_OSERR, "pthread_create(): %s", strerror(e));
+	}
+
+	for (i = 0; i < n; i++)
+		if ((e = pthread_join(jobs[i].tid, NULL)) != 0)
+			errx(EX_OSERR, "pthread_join(): %s", strerror(e));
+
+	xfree(jobs);
+}
+
+/***/
+
+static void *
+par_start(void *job_void)
+{
+	struct par_job_t	*job = (struct par_job_t *)job_void;
+
+	job->fn(job->i, job->arg);
+
+	return NULL;
+}
+
+/* EOF */
@@ -33,62 +33,51 @@
 
 #include "parse_indexln.h"
 #include "portdef.h"
+#include "sepscan.h"
+
+/* fields of an INDEX line */
+#define IDX_FLDS_CNT	13
 
 void
-parse_indexln(struct port_t *port)
+parse_indexln(struct port_t *port, size_t len, struct sepscan_t *ss)
 {
-	char	fs[2] = {IDXFS, '\0'};
-	char	*fld, *raw_p;
+	char	*raw = port->indexln_raw;
+	char	*flds[IDX_FLDS_CNT];
 	size_t	idx;
 
-	raw_p = port->indexln_raw;
+	ss_scan(ss, raw, len, '\n', IDXFS);
+
+	if (ss->fs_cnt >= IDX_FLDS_CNT)
+	{
+		raw[ss->fs[0]] = '\0';
+		errx(EX_DATAERR, "Cannot parse INDEX line for %s", raw);
+	}
 
-	for (idx = 0; ((fld = strsep(&raw_p, fs)) != NULL); idx++)
-		switch (idx)
+	/* missing fields at the end are empty */
+	for (idx = 0; idx < IDX_FLDS_CNT; idx++)
+		if (idx == 0)
+			flds[idx] = raw;
+		else if (idx <= ss->fs_cnt)
 		{
-		case 0:
-			port->pkgname = fld;
-			break;
-		case 1:
-			snprintf(port->path, sizeof(port->path), "%s", fld);
-			break;
-		case 2:
-			port->prefix = fld;
-			break;
-		case 3:
-			port->comment = fld;
-			break;
-		case 4:
-			port->pkgdescr = fld;
-			break;
-		case 5:
-			port->maint = fld;
-			break;
-		case 6:
-			port->categories = fld;
-			break;
-		case 7:
-			port->bdep = fld;
-			break;
-		case 8:
-			port->rdep = fld;
-			break;
-		case 9:
-			port->www = fld;
-			break;
-		case 10:
-			port->edep = fld;
-			break;
-		case 11:
-			port->pdep = fld;
-			break;
-		case 12:
-			port->fdep = fld;
-			break;
-		default:
-			errx(EX_DATAERR, "Cannot parse INDEX line for %s",
-			     port->pkgname);
+			raw[ss->fs[idx - 1]] = '\0';
+			flds[idx] = raw + ss->fs[idx - 1] + 1;
 		}
+		else
+			flds[idx] = raw + len;
+
+	port->pkgname = flds[0];
+	snprintf(port->path, sizeof(port->path), "%s", flds[1]);
+	port->prefix = flds[2];
+	port->comment = flds[3];
+	port->pkgdescr = flds[4];
+	port->maint = flds[5];
+	port->categories = flds[6];
+	port->bdep = flds[7];
+	port->rdep = flds[8];
+	port->www = flds[9];
+	port->edep = flds[10];
+	port->pdep = flds[11];
+	port->fdep = flds[12];
 }
 
 /* EOF */
@@ -30,12 +30,15 @@
 #include <stdio.h>
 
 #include "portdef.h"
+#include "sepscan.h"
 
 /*
- * Parse `indexln_raw' member and initialize other members of port
- * to point inside it. Separators in `indexln_raw' are replaced with '\0's
+ * Parse `indexln_raw' member, which is `len' bytes long, and initialize
+ * other members of port to point inside it. Separators in `indexln_raw'
+ * are replaced with '\0's. The separators are found with `ss', which can
+ * be reused for all lines.
  */
-void parse_indexln(struct port_t *port);
+void parse_indexln(struct port_t *port, size_t len, struct sepscan_t *ss);
 
 #endif  /* PARSE_INDEXLN_H */
 
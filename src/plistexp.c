@@ -0,0 +1,366 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <sys/param.h>
+
+#include <err.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+
+#include "plistexp.h"
+#include "xlibc.h"
+
+/* one %%VAR%% -> value substitution */
+struct pe_sub_t {
+	char	*pat;  /* "%%VAR%%" */
+	size_t	pat_len;
+	char	*val;
+	size_t	val_len;
+};
+
+struct pe_t {
+	struct pe_sub_t	*subs;
+	size_t		subs_cnt;
+	/* two buffers, the result of a substitution goes to the other one */
+	char		*buf[2];
+	size_t		buf_sz[2];
+	void		(*add)(char *, void *);
+	void		*add_arg;
+};
+
+/*
+ * Split `str' into words the way sh(1) would, without expanding
+ * anything: blanks separate words unless quoted with " or ', a backslash
+ * quotes the next character (within " only $, `, " and a backslash).
+ * The words are allocated, the array is NULL terminated.
+ */
+static char **split_words(const char *str);
+
+/*
+ * Free data allocated by split_words()
+ */
+static void free_words(char **words);
+
+/*
+ * Set sub->val to what sed(1) puts in place of sub->pat for the
+ * replacement `repl': & is the matched text and a backslash quotes the
+ * next character
+ */
+static void set_val(struct pe_sub_t *sub, const char *repl);
+
+/*
+ * Apply all substitutions to `line' and pass the result to pe->add
+ */
+static void expand_line(struct pe_t *pe, const char *line);
+
+/*
+ * Make pe->buf[i] at least `sz' bytes long
+ */
+static void grow_buf(struct pe_t *pe, int i, size_t sz);
+
+/***/
+
+void
+pe_expand(const char *portpath, const char *plist_sub,
+	  const char *plist_files, const char *plist,
+	  void (*add)(char *, void *), void *add_arg)
+{
+	struct pe_t	pe;
+	char		**subs, **files, **plists;
+	char		*eq;
+	char		fn[PATH_MAX];
+	FILE		*fp;
+	char		*line;
+	size_t		line_sz;
+	ssize_t		line_len;
+	size_t		i;
+
+	subs = split_words(plist_sub);
+
+	for (i = 0; subs[i] != NULL; i++)
+		;
+
+	pe.subs = (struct pe_sub_t *)xmalloc((i + 1) * sizeof(struct pe_sub_t));
+	pe.subs_cnt = 0;
+
+	for (i = 0; subs[i] != NULL; i++)
+	{
+		if ((eq = strchr(subs[i], '=')) == NULL)
+			continue;
+
+		pe.subs[pe.subs_cnt].pat_len = eq - subs[i] + 4;
+		pe.subs[pe.subs_cnt].pat =
+			(char *)xmalloc(pe.subs[pe.subs_cnt].pat_len + 1);
+		snprintf(pe.subs[pe.subs_cnt].pat,
+			 pe.subs[pe.subs_cnt].pat_len + 1,
+			 "%%%%%.*s%%%%", (int)(eq - subs[i]), subs[i]);
+
+		set_val(&pe.subs[pe.subs_cnt], eq + 1);
+
+		pe.subs_cnt++;
+	}
+
+	pe.buf[0] = NULL;
+	pe.buf[1] = NULL;
+	pe.buf_sz[0] = 0;
+	pe.buf_sz[1] = 0;
+	pe.add = add;
+	pe.add_arg = add_arg;
+
+	files = split_words(plist_files);
+
+	for (i = 0; files[i] != NULL; i++)
+		expand_line(&pe, files[i]);
+
+	free_words(files);
+
+	plists = split_words(plist);
+
+	line = NULL;
+	line_sz = 0;
+
+	for (i = 0; plists[i] != NULL; i++)
+	{
+		if (plists[i][0] == '/')
+			snprintf(fn, sizeof(fn), "%s", plists[i]);
+		else
+			snprintf(fn, sizeof(fn), "%s/%s", portpath, plists[i]);
+
+		/* show-plist checks with [ -f ] */
+		if ((fp = fopen(fn, "r")) == NULL)
+		{
+			if (errno == ENOENT || errno == ENOTDIR)
+				continue;
+			err(EX_NOINPUT, "fopen(): %s", fn);
+		}
+
+		while ((line_len = getline(&line, &line_sz, fp)) != -1)
+		{
+			if (line_len > 0 && line[line_len - 1] == '\n')
+				line[line_len - 1] = '\0';
+
+			expand_line(&pe, line);
+		}
+
+		if (ferror(fp))
+			err(EX_IOERR, "getline(): %s", fn);
+
+		xfclose(fp, fn);
+	}
+
+	free(line);
+
+	free_words(plists);
+
+	for (i = 0; i < pe.subs_cnt; i++)
+	{
+		xfree(pe.subs[i].pat);
+		xfree(pe.subs[i].val);
+	}
+	xfree(pe.subs);
+
+	free_words(subs);
+
+	free(pe.buf[0]);
+	free(pe.buf[1]);
+}
+
+static char **
+split_words(const char *str)
+{
+	char		**words;
+	size_t		words_cnt;
+	char		*word;
+	size_t		len;
+	const char	*p;
+	char		quote;
+
+	/* there can not be more words than characters */
+	words = (char **)xmalloc((strlen(str) / 2 + 2) * sizeof(char *));
+	words_cnt = 0;
+
+	/* no word is longer than the whole string */
+	word = (char *)xmalloc(strlen(str) + 1);
+
+	p = str;
+
+	for (;;)
+	{
+		while (*p == ' ' || *p == '\t')
+			p++;
+
+		if (*p == '\0')
+			break;
+
+		len = 0;
+		quote = '\0';
+
+		for (; *p != '\0'; p++)
+		{
+			if (*p == '\\' && p[1] != '\0' && quote != '\'' &&
+			    (quote == '\0' || strchr("$`\"\\", p[1]) != NULL))
+				word[len++] = *++p;
+			else if (quote != '\0')
+			{
+				if (*p == quote)
+					quote = '\0';
+				else
+					word[len++] = *p;
+			}
+			else if (*p == '"' || *p == '\'')
+				quote = *p;
+			else if (*p == ' ' || *p == '\t')
+				break;
+			else
+				word[len++] = *p;
+		}
+
+		word[len] = '\0';
+
+		words[words_cnt++] = xstrdup(word);
+	}
+
+	words[words_cnt] = NULL;
+
+	xfree(word);
+
+	return words;
+}
+
+static void
+free_words(char **words)
+{
+	size_t	i;
+
+	for (i = 0; words[i] != NULL; i++)
+		xfree(words[i]);
+
+	xfree(words);
+}
+
+static void
+set_val(struct pe_sub_t *sub, const char *repl)
+{
+	const char	*p;
+	size_t		len;
+
+	/* every & may become the whole pattern */
+	len = 0;
+	for (p = repl; *p != '\0'; p++)
+		len += *p == '&' ? sub->pat_len : 1;
+
+	sub->val = (char *)xmalloc(len + 1);
+	sub->val_len = 0;
+
+	for (p = repl; *p != '\0'; p++)
+	{
+		if (*p == '&')
+		{
+			memcpy(sub->val + sub->val_len, sub->pat, sub->pat_len);
+			sub->val_len += sub->pat_len;
+			continue;
+		}
+
+		if (*p == '\\' && p[1] != '\0')
+			p++;
+
+		sub->val[sub->val_len++] = *p;
+	}
+
+	sub->val[sub->val_len] = '\0';
+}
+
+static void
+expand_line(struct pe_t *pe, const char *line)
+{
+	const struct pe_sub_t	*sub;
+	const char		*src, *m;
+	char			*dst;
+	size_t			src_len;
+	size_t			cnt;
+	size_t			i;
+	int			cur;
+
+	src_len = strlen(line);
+
+	cur = 0;
+	grow_buf(pe, cur, src_len + 1);
+	memcpy(pe->buf[cur], line, src_len + 1);
+
+	/* like sed -e s!%%A%%!a!g -e s!%%B%%!b!g: in order, globally */
+	for (i = 0; i < pe->subs_cnt; i++)
+	{
+		sub = &pe->subs[i];
+		src = pe->buf[cur];
+
+		if ((m = strstr(src, sub->pat)) == NULL)
+			continue;
+
+		cnt = 0;
+		for (; m != NULL; m = strstr(m + sub->pat_len, sub->pat))
+			cnt++;
+
+		grow_buf(pe, !cur, src_len + cnt * sub->val_len + 1);
+
+		/* grow_buf() may have moved the other buffer, not this one */
+		src = pe->buf[cur];
+		dst = pe->buf[!cur];
+
+		while ((m = strstr(src, sub->pat)) != NULL)
+		{
+			memcpy(dst, src, m - src);
+			dst += m - src;
+			memcpy(dst, sub->val, sub->val_len);
+			dst += sub->val_len;
+			src = m + sub->pat_len;
+		}
+		strcpy(dst, src);
+
+		cur = !cur;
+		src_len = strlen(pe->buf[cur]);
+	}
+
+	pe->add(pe->buf[cur], pe->add_arg);
+}
+
+static void
+grow_buf(struct pe_t *pe, int i, size_t sz)
+{
+	if (pe->buf_sz[i] >= sz)
+		return;
+
+	pe->buf_sz[i] = sz > BUFSIZ ? sz : BUFSIZ;
+
+	if ((pe->buf[i] = realloc(pe->buf[i], pe->buf_sz[i])) == NULL)
+		err(EX_OSERR, "realloc(): %u", (unsigned)pe->buf_sz[i]);
+}
+
+/* EOF */
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Expansion of ports' packing lists the way the show-plist target of
+ * Mk/Makefile does it with sed(1): %%VAR%% is replaced by the value
+ * of VAR from PLIST_SUB in every entry of PLIST_FILES and every line of
+ * the files in PLIST. Only the values of these variables are needed
+ * from make.
+ */
+
+#ifndef PLISTEXP_H
+#define PLISTEXP_H
+
+/*
+ * Call `add' for every file of the port in directory `portpath', given
+ * the values of PLIST_SUB (or PLIST_SUB_SANITIZED), PLIST_FILES and
+ * PLIST as printed by make -V. Relative names in `plist' are relative to
+ * `portpath', names that do not exist are skipped. The file passed to
+ * `add' is overwritten by subsequent calls.
+ */
+void pe_expand(const char *portpath, const char *plist_sub,
+	       const char *plist_files, const char *plist,
+	       void (*add)(char *, void *), void *add_arg);
+
+#endif  /* PLISTEXP_H */
+
+/* EOF */
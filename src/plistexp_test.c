@@ -0,0 +1,326 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Check pe_expand() on packing lists with the usual PLIST_SUB values
+ * (quoted, empty, "@comment "), repeated and overlapping %%VAR%%,
+ * characters special to sed(1) and missing PLIST files. If the path to
+ * Mk/Makefile is given, the output of its show-plist target run by make
+ * with the same variables must be the same too.
+ * Exits with 1 if any check fails.
+ *
+ * usage: plistexp_test [Mk/Makefile]
+ */
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/wait.h>
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include "plistexp.h"
+#include "xlibc.h"
+
+/* a port: its plist variables, its pkg-plist file and the result */
+struct case_t {
+	const char	*name;
+	const char	*plist_sub;
+	const char	*plist_files;
+	const char	*plist;
+	const char	*pkg_plist;  /* contents of pkg-plist, NULL for none */
+	const char	*expected;  /* one line for each file */
+};
+
+static const struct case_t	cases[] = {
+	{"options",
+	 "PORTDOCS=\"\" PORTEXAMPLES=\"@comment \"",
+	 "bin/foo %%PORTDOCS%%share/doc/foo/README",
+	 "pkg-plist",
+	 "%%PORTEXAMPLES%%share/examples/foo/x.c\nlib/libfoo.so\n",
+	 "bin/foo\nshare/doc/foo/README\n"
+	 "@comment share/examples/foo/x.c\nlib/libfoo.so\n"},
+	{"repeated",
+	 "NAME=foo VER=1.2",
+	 "lib/%%NAME%%-%%VER%%/%%NAME%%.so %%NAME%%%%NAME%%",
+	 "",
+	 NULL,
+	 "lib/foo-1.2/foo.so\nfoofoo\n"},
+	{"overlapping",
+	 "A=%%B%% B=b",
+	 "%%A%%/x %%%A%%% %%A%%A%% %%B%%%%",
+	 "",
+	 NULL,
+	 "b/x\n%b%\nbA%%\nb%%\n"},
+	{"in order",
+	 "B=b A=%%B%%",
+	 "%%A%% %%C%%",
+	 "",
+	 NULL,
+	 "%%B%%\n%%C%%\n"},
+	{"quoted",
+	 "Q='a b' E= D=\"\" S='@comment ' EQ=x=y",
+	 "%%Q%% %%E%%e %%D%%d %%S%%s %%EQ%%",
+	 "",
+	 NULL,
+	 "a b\ne\nd\n@comment s\nx=y\n"},
+	{"sed",
+	 "AMP=\"x&y\" ESC='x\\&y' BS=a\\\\b",
+	 "%%AMP%% %%ESC%% %%BS%%",
+	 "",
+	 NULL,
+	 "x%%AMP%%y\nx&y\nab\n"},
+	{"missing plists",
+	 "X=x",
+	 "",
+	 "missing pkg-plist sub/missing",
+	 "%%X%%/1\n\n%%X%%/2\n",
+	 "x/1\n\nx/2\n"},
+	{"no plist",
+	 "",
+	 "",
+	 "",
+	 NULL,
+	 ""},
+};
+
+#define CASES_CNT	(sizeof(cases) / sizeof(cases[0]))
+
+/* output of pe_expand() */
+struct out_t {
+	char	*buf;
+	size_t	len;
+	size_t	sz;
+};
+
+static int	failed;
+
+/*
+ * Run case `c' in a temporary port directory, comparing the result with
+ * show-plist of `mk' unless it is NULL
+ */
+static void check_case(const struct case_t *c, const char *mk);
+
+/*
+ * Append `file' and a newline to the out_t `out_void', called by
+ * pe_expand()
+ */
+static void add_file(char *file, void *out_void);
+
+/*
+ * Run make show-plist with the variables of `c' in directory `dir' and
+ * return its malloc'ed output
+ */
+static char *show_plist(const struct case_t *c, const char *dir,
+			const char *mk);
+
+/***/
+
+int
+main(int argc, char **argv)
+{
+	char	mk[PATH_MAX];
+	size_t	i;
+
+	if (argc > 1 && realpath(argv[1], mk) == NULL)
+		err(EX_NOINPUT, "realpath(): %s", argv[1]);
+
+	for (i = 0; i < CASES_CNT; i++)
+		check_case(&cases[i], argc > 1 ? mk : NULL);
+
+	if (failed)
+		return 1;
+
+	printf("plistexp_test: %u cases ok%s\n", (unsigned)CASES_CNT,
+	       argc > 1 ? ", same as show-plist" : "");
+
+	return 0;
+}
+
+static void
+check_case(const struct case_t *c, const char *mk)
+{
+	char		dir[] = "/tmp/plistexp_test.XXXXXX";
+	char		fn[PATH_MAX];
+	FILE		*fp;
+	struct out_t	out;
+	char		*ref;
+
+	if (mkdtemp(dir) == NULL)
+		err(EX_CANTCREAT, "mkdtemp(): %s", dir);
+
+	snprintf(fn, sizeof(fn), "%s/pkg-plist", dir);
+
+	if (c->pkg_plist != NULL)
+	{
+		fp = xfopen(fn, "w");
+		if (fputs(c->pkg_plist, fp) == EOF)
+			err(EX_IOERR, "fputs(): %s", fn);
+		xfclose(fp, fn);
+	}
+
+	out.sz = BUFSIZ;
+	out.buf = (char *)xmalloc(out.sz);
+	out.buf[0] = '\0';
+	out.len = 0;
+
+	pe_expand(dir, c->plist_sub, c->plist_files, c->plist, add_file, &out);
+
+	if (strcmp(out.buf, c->expected) != 0)
+	{
+		fprintf(stderr, "plistexp_test: %s: got\n%s"
+			"plistexp_test: expected\n%s", c->name, out.buf,
+			c->expected);
+		failed = 1;
+	}
+
+	if (mk != NULL)
+	{
+		ref = show_plist(c, dir, mk);
+
+		if (strcmp(out.buf, ref) != 0)
+		{
+			fprintf(stderr, "plistexp_test: %s: got\n%s"
+				"plistexp_test: show-plist gives\n%s",
+				c->name, out.buf, ref);
+			failed = 1;
+		}
+
+		xfree(ref);
+	}
+
+	xfree(out.buf);
+
+	if (c->pkg_plist != NULL && unlink(fn) == -1)
+		err(EX_OSERR, "unlink(): %s", fn);
+	if (rmdir(dir) == -1)
+		err(EX_OSERR, "rmdir(): %s", dir);
+}
+
+static void
+add_file(char *file, void *out_void)
+{
+	struct out_t	*out = (struct out_t *)out_void;
+	size_t		len;
+
+	len = strlen(file);
+
+	if (out->len + len + 2 > out->sz)
+	{
+		out->sz = (out->len + len + 2) * 2;
+		if ((out->buf = realloc(out->buf, out->sz)) == NULL)
+			err(EX_OSERR, "realloc(): %u", (unsigned)out->sz);
+	}
+
+	memcpy(out->buf + out->len, file, len);
+	out->len += len;
+	out->buf[out->len++] = '\n';
+	out->buf[out->len] = '\0';
+}
+
+static char *
+show_plist(const struct case_t *c, const char *dir, const char *mk)
+{
+	char	sub_arg[BUFSIZ], files_arg[BUFSIZ], plist_arg[BUFSIZ];
+	char	*const args[] = {"make", "-f", (char *)mk,
+		"ECHO_CMD=echo", "SED=sed",
+		sub_arg, files_arg, plist_arg, "show-plist", NULL};
+	int	fds[2];
+	pid_t	pid;
+	int	status;
+	char	*buf;
+	size_t	len, sz;
+	ssize_t	rd_len;
+
+	snprintf(sub_arg, sizeof(sub_arg), "PLIST_SUB_SANITIZED=%s",
+		 c->plist_sub);
+	snprintf(files_arg, sizeof(files_arg), "PLIST_FILES=%s",
+		 c->plist_files);
+	snprintf(plist_arg, sizeof(plist_arg), "PLIST=%s", c->plist);
+
+	if (pipe(fds) == -1)
+		err(EX_OSERR, "pipe()");
+
+	switch ((pid = fork()))
+	{
+	case -1:
+		err(EX_OSERR, "fork()");
+
+		/* NOTREACHED */
+		break;
+	case 0:
+		if (chdir(dir) == -1)
+			err(EX_OSERR, "chdir(): %s", dir);
+		if (dup2(fds[1], STDOUT_FILENO) == -1)
+			err(EX_OSERR, "dup2()");
+		close(fds[0]);
+		close(fds[1]);
+
+		execvp(args[0], args);
+		err(EX_OSERR, "execvp(): %s", args[0]);
+
+		/* NOTREACHED */
+		break;
+	}
+
+	close(fds[1]);
+
+	sz = BUFSIZ;
+	buf = (char *)xmalloc(sz);
+	len = 0;
+
+	while ((rd_len = read(fds[0], buf + len, sz - len - 1)) > 0)
+	{
+		len += rd_len;
+		if (sz - len < BUFSIZ)
+		{
+			sz *= 2;
+			if ((buf = realloc(buf, sz)) == NULL)
+				err(EX_OSERR, "realloc(): %u", (unsigned)sz);
+		}
+	}
+	if (rd_len == -1)
+		err(EX_IOERR, "read(): make show-plist");
+
+	buf[len] = '\0';
+
+	close(fds[0]);
+
+	if (waitpid(pid, &status, 0) == -1)
+		err(EX_OSERR, "waitpid()");
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		errx(EX_SOFTWARE, "%s: make show-plist failed", c->name);
+
+	return buf;
+}
+
+/* EOF */
@@ -0,0 +1,499 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include "plistidx.h"
+#include "xlibc.h"
+
+#define PX_MAGIC	"PSPLSTIX"
+#define PX_MAGIC_LEN	8
+#define PX_VERSION	4
+
+/* summaries are at most that many 64 bit words (8 KiB) */
+#define PX_BLOOM_MAX_WORDS	1024
+/* bits per distinct trigram, with 3 probes about 3% false positives */
+#define PX_BLOOM_BITS_PER_KEY	8
+#define PX_BLOOM_PROBES		3
+
+/*
+ * On-disk layout: header and one entry for every id from 0 to
+ * ids_cnt - 1, so a port's entry is found without searching. Ids are
+ * handed out sequentially, the table has (almost) no holes. The
+ * summaries of the ports follow the entries, each one is a Bloom filter
+ * over the (case folded) trigrams of the port's files. The NUL terminated
+ * lists of the ports' other files come last.
+ */
+struct px_hdr_t {
+	char		magic[PX_MAGIC_LEN];
+	uint32_t	version;
+	uint32_t	hdr_sz;  /* sizeof(struct px_hdr_t) */
+	uint32_t	plist_sz;
+	uint32_t	ids_cnt;
+	uint32_t	bloom_words;  /* 64 bit words after the entries */
+	uint32_t	fdeps_sz;  /* bytes after the summaries */
+};
+
+struct px_ent_t {
+	uint32_t	offt;
+	uint32_t	len;  /* zero if the port has no lines */
+	uint32_t	first_line;
+	uint32_t	lines_cnt;
+	uint64_t	fprint;  /* zero if not known */
+	uint32_t	bloom_offt;  /* in 64 bit words */
+	uint32_t	bloom_words;  /* zero if the port has no summary */
+	uint32_t	fdeps_offt;
+	uint32_t	fdeps_len;  /* including the NUL, zero if not known */
+};
+
+struct px_new_t {
+	struct px_ent_t	*ents;
+	size_t		ents_sz;  /* allocated elements in ents */
+	size_t		ids_cnt;  /* highest id added plus one */
+	uint64_t	*blooms;
+	size_t		blooms_sz;  /* allocated elements in blooms */
+	size_t		blooms_cnt;  /* used elements in blooms */
+	char		*fdeps;
+	size_t		fdeps_sz;  /* allocated bytes in fdeps */
+	size_t		fdeps_len;  /* used bytes in fdeps */
+};
+
+struct px_t {
+	void			*map;
+	size_t			map_sz;
+	const struct px_hdr_t	*hdr;
+	const struct px_ent_t	*ents;
+	const uint64_t		*blooms;
+	const char		*fdeps;
+};
+
+/*
+ * Make room for the entry of port `id'
+ */
+static void grow(struct px_new_t *x, unsigned id);
+
+/*
+ * Compare two trigram keys, used with qsort(3)
+ */
+static int keys_cmp(const void *k1v, const void *k2v);
+
+/*
+ * Get the `i'th probe in a Bloom filter of `bits' bits for `key',
+ * `bits' is a power of 2
+ */
+static uint32_t bloom_bit(uint32_t key, unsigned i, uint32_t bits);
+
+/***/
+
+void
+px_new_start(struct px_new_t **xp)
+{
+	struct px_new_t	*x;
+
+	x = (struct px_new_t *)xmalloc(sizeof(struct px_new_t));
+
+	x->ents_sz = 1024;
+	if ((x->ents = calloc(x->ents_sz, sizeof(struct px_ent_t))) == NULL)
+		err(EX_OSERR, "calloc(): %u",
+		    (unsigned)(x->ents_sz * sizeof(struct px_ent_t)));
+	x->ids_cnt = 0;
+
+	x->blooms = NULL;
+	x->blooms_sz = 0;
+	x->blooms_cnt = 0;
+
+	x->fdeps = NULL;
+	x->fdeps_sz = 0;
+	x->fdeps_len = 0;
+
+	*xp = x;
+}
+
+void
+px_new_add(struct px_new_t *x, unsigned id, const struct px_block_t *b)
+{
+	grow(x, id);
+
+	x->ents[id].offt = (uint32_t)b->offt;
+	x->ents[id].len = (uint32_t)b->len;
+	x->ents[id].first_line = b->first_line;
+	x->ents[id].lines_cnt = b->lines_cnt;
+}
+
+void
+px_new_fprint(struct px_new_t *x, unsigned id, uint64_t fprint)
+{
+	grow(x, id);
+
+	x->ents[id].fprint = fprint;
+}
+
+void
+px_new_fdeps(struct px_new_t *x, unsigned id, const char *fdeps)
+{
+	size_t	len;
+
+	len = strlen(fdeps) + 1;
+
+	if (x->fdeps_len + len > x->fdeps_sz)
+	{
+		if (x->fdeps_sz == 0)
+			x->fdeps_sz = 4096;
+		while (x->fdeps_len + len > x->fdeps_sz)
+			x->fdeps_sz *= 2;
+
+		if ((x->fdeps = realloc(x->fdeps, x->fdeps_sz)) == NULL)
+			err(EX_OSERR, "realloc(): %u", (unsigned)x->fdeps_sz);
+	}
+
+	memcpy(x->fdeps + x->fdeps_len, fdeps, len);
+
+	grow(x, id);
+
+	x->ents[id].fdeps_offt = (uint32_t)x->fdeps_len;
+	x->ents[id].fdeps_len = (uint32_t)len;
+
+	x->fdeps_len += len;
+}
+
+void
+px_new_bloom(struct px_new_t *x, unsigned id, uint32_t *keys, size_t cnt)
+{
+	size_t		uniq, i;
+	uint32_t	words, bits;
+	uint64_t	*bloom;
+	unsigned	k;
+
+	if (cnt == 0)
+		return;
+
+	qsort(keys, cnt, sizeof(*keys), keys_cmp);
+	for (uniq = 1, i = 1; i < cnt; i++)
+		if (keys[i] != keys[uniq - 1])
+			keys[uniq++] = keys[i];
+
+	for (words = 1;
+	     words < PX_BLOOM_MAX_WORDS &&
+	     (size_t)words * 64 < uniq * PX_BLOOM_BITS_PER_KEY;
+	     words *= 2)
+		;
+	bits = words * 64;
+
+	if (x->blooms_cnt + words > x->blooms_sz)
+	{
+		if (x->blooms_sz == 0)
+			x->blooms_sz = 4096;
+		while (x->blooms_cnt + words > x->blooms_sz)
+			x->blooms_sz *= 2;
+
+		if ((x->blooms = realloc(x->blooms, x->blooms_sz *
+					 sizeof(uint64_t))) == NULL)
+			err(EX_OSERR, "realloc(): %u",
+			    (unsigned)(x->blooms_sz * sizeof(uint64_t)));
+	}
+
+	bloom = x->blooms + x->blooms_cnt;
+	memset(bloom, 0, words * sizeof(uint64_t));
+
+	for (i = 0; i < uniq; i++)
+		for (k = 0; k < PX_BLOOM_PROBES; k++)
+		{
+			uint32_t	bit = bloom_bit(keys[i], k, bits);
+
+			bloom[bit / 64] |= (uint64_t)1 << (bit % 64);
+		}
+
+	grow(x, id);
+
+	x->ents[id].bloom_offt = (uint32_t)x->blooms_cnt;
+	x->ents[id].bloom_words = words;
+
+	x->blooms_cnt += words;
+}
+
+void
+px_new_end(struct px_new_t *x, size_t plist_sz, const char *fn)
+{
+	struct px_hdr_t	hdr;
+	FILE		*fp;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, PX_MAGIC, PX_MAGIC_LEN);
+	hdr.version = PX_VERSION;
+	hdr.hdr_sz = sizeof(struct px_hdr_t);
+	hdr.plist_sz = (uint32_t)plist_sz;
+	hdr.ids_cnt = (uint32_t)x->ids_cnt;
+	hdr.bloom_words = (uint32_t)x->blooms_cnt;
+	hdr.fdeps_sz = (uint32_t)x->fdeps_len;
+
+	/*
+	 * Offsets are 32 bit, do not create an index for a plist file that
+	 * does not fit, ports' plists will be searched for then.
+	 */
+	if (plist_sz <= UINT32_MAX)
+	{
+		if ((fp = fopen(fn, "w")) == NULL)
+			err(EX_CANTCREAT, "fopen(): %s", fn);
+
+		if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+		    fwrite(x->ents, sizeof(struct px_ent_t), x->ids_cnt, fp)
+		    != x->ids_cnt ||
+		    fwrite(x->blooms, sizeof(uint64_t), x->blooms_cnt, fp)
+		    != x->blooms_cnt ||
+		    fwrite(x->fdeps, 1, x->fdeps_len, fp) != x->fdeps_len)
+			err(EX_IOERR, "fwrite(): %s", fn);
+
+		xfclose(fp, fn);
+	}
+
+	free(x->ents);
+	free(x->blooms);
+	free(x->fdeps);
+	xfree(x);
+}
+
+/***/
+
+int
+px_open(struct px_t **xp, const char *fn, size_t plist_sz)
+{
+	struct px_t		*x;
+	const struct px_hdr_t	*hdr;
+	int			fd;
+	struct stat		sb;
+	void			*map;
+
+	if ((fd = open(fn, O_RDONLY)) == -1)
+	{
+		if (errno == ENOENT)
+			return -1;
+		err(EX_NOINPUT, "open(): %s", fn);
+	}
+
+	if (fstat(fd, &sb) == -1)
+		err(EX_OSERR, "fstat(): %s", fn);
+
+	if ((size_t)sb.st_size < sizeof(struct px_hdr_t))
+	{
+		close(fd);
+		return -1;
+	}
+
+	if ((map = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0))
+	    == MAP_FAILED)
+		err(EX_OSERR, "mmap(): %s", fn);
+
+	close(fd);
+
+	hdr = (const struct px_hdr_t *)map;
+
+	/* an index from another version or for another plist is useless */
+	if (memcmp(hdr->magic, PX_MAGIC, PX_MAGIC_LEN) != 0 ||
+	    hdr->version != PX_VERSION ||
+	    hdr->hdr_sz != sizeof(struct px_hdr_t) ||
+	    hdr->plist_sz != plist_sz ||
+	    sizeof(struct px_hdr_t) +
+	    (size_t)hdr->ids_cnt * sizeof(struct px_ent_t) +
+	    (size_t)hdr->bloom_words * sizeof(uint64_t) +
+	    (size_t)hdr->fdeps_sz != (size_t)sb.st_size)
+	{
+		munmap(map, sb.st_size);
+		return -1;
+	}
+
+	x = (struct px_t *)xmalloc(sizeof(struct px_t));
+
+	x->map = map;
+	x->map_sz = sb.st_size;
+	x->hdr = hdr;
+	x->ents = (const struct px_ent_t *)((const char *)map + hdr->hdr_sz);
+	x->blooms = (const uint64_t *)(x->ents + hdr->ids_cnt);
+	x->fdeps = (const char *)(x->blooms + hdr->bloom_words);
+
+	*xp = x;
+
+	return 0;
+}
+
+void
+px_close(struct px_t *x)
+{
+	if (munmap(x->map, x->map_sz) == -1)
+		err(EX_OSERR, "munmap()");
+
+	xfree(x);
+}
+
+int
+px_port(const struct px_t *x, unsigned id, struct px_block_t *b)
+{
+	const struct px_ent_t	*e;
+
+	if (id >= x->hdr->ids_cnt)
+		return -1;
+
+	e = &x->ents[id];
+
+	/* do not trust the file blindly, it is used to index the plist */
+	if (e->len == 0 || (size_t)e->offt + e->len > x->hdr->plist_sz)
+		return -1;
+
+	b->offt = e->offt;
+	b->len = e->len;
+	b->first_line = e->first_line;
+	b->lines_cnt = e->lines_cnt;
+
+	return 0;
+}
+
+uint64_t
+px_fprint(const struct px_t *x, unsigned id)
+{
+	if (id >= x->hdr->ids_cnt)
+		return 0;
+
+	return x->ents[id].fprint;
+}
+
+const char *
+px_fdeps(const struct px_t *x, unsigned id)
+{
+	const struct px_ent_t	*e;
+
+	if (id >= x->hdr->ids_cnt)
+		return NULL;
+
+	e = &x->ents[id];
+
+	/* the list is used as a C string, it must end inside the file */
+	if (e->fdeps_len == 0 ||
+	    (size_t)e->fdeps_offt + e->fdeps_len > x->hdr->fdeps_sz ||
+	    x->fdeps[e->fdeps_offt + e->fdeps_len - 1] != '\0')
+		return NULL;
+
+	return x->fdeps + e->fdeps_offt;
+}
+
+int
+px_bloom(const struct px_t *x, unsigned id, const uint32_t *keys,
+	 size_t cnt)
+{
+	const struct px_ent_t	*e;
+	const uint64_t		*bloom;
+	uint32_t		bits, bit;
+	size_t			i;
+	unsigned		k;
+
+	if (id >= x->hdr->ids_cnt)
+		return 1;
+
+	e = &x->ents[id];
+
+	/* no summary or a corrupted one, the port has to be searched */
+	if (e->bloom_words == 0 ||
+	    (e->bloom_words & (e->bloom_words - 1)) != 0 ||
+	    (size_t)e->bloom_offt + e->bloom_words > x->hdr->bloom_words)
+		return 1;
+
+	bloom = x->blooms + e->bloom_offt;
+	bits = e->bloom_words * 64;
+
+	for (i = 0; i < cnt; i++)
+		for (k = 0; k < PX_BLOOM_PROBES; k++)
+		{
+			bit = bloom_bit(keys[i], k, bits);
+			if ((bloom[bit / 64] & ((uint64_t)1 << (bit % 64))) == 0)
+				return 0;
+		}
+
+	return 1;
+}
+
+static void
+grow(struct px_new_t *x, unsigned id)
+{
+	size_t	old_sz;
+
+	if (id >= x->ents_sz)
+	{
+		old_sz = x->ents_sz;
+		while (id >= x->ents_sz)
+			x->ents_sz *= 2;
+
+		if ((x->ents = realloc(x->ents, x->ents_sz *
+				       sizeof(struct px_ent_t))) == NULL)
+			err(EX_OSERR, "realloc(): %u",
+			    (unsigned)(x->ents_sz * sizeof(struct px_ent_t)));
+
+		memset(x->ents + old_sz, 0,
+		       (x->ents_sz - old_sz) * sizeof(struct px_ent_t));
+	}
+
+	if (id >= x->ids_cnt)
+		x->ids_cnt = id + 1;
+}
+
+static int
+keys_cmp(const void *k1v, const void *k2v)
+{
+	uint32_t	k1 = *(const uint32_t *)k1v;
+	uint32_t	k2 = *(const uint32_t *)k2v;
+
+	if (k1 < k2)
+		return -1;
+	if (k1 > k2)
+		return 1;
+	return 0;
+}
+
+static uint32_t
+bloom_bit(uint32_t key, unsigned i, uint32_t bits)
+{
+	uint64_t	h;
+	uint32_t	h1, h2;
+
+	/* double hashing, both halves from one multiplicative hash */
+	h = (uint64_t)key * 0x9E3779B97F4A7C15ULL;
+	h1 = (uint32_t)(h >> 32);
+	h2 = (uint32_t)h | 1;
+
+	return (h1 + i * h2) & (bits - 1);
+}
+
+/* EOF */
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Per port index of the plist file. The lines of a port are contiguous
+ * in the plist file, so for every port id it keeps where its block of
+ * lines starts and how long it is. A port's plist can then be read
+ * without looking at the rest of the file. Along with it, the
+ * fingerprint of the port's files the lines were generated from is kept,
+ * the files outside the port's directory that make read for them,
+ * and a summary of the trigrams in the lines, so ports that cannot match
+ * a pattern are skipped without reading their lines.
+ */
+
+#ifndef PLISTIDX_H
+#define PLISTIDX_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+struct px_new_t;
+struct px_t;
+
+/* a port's block of lines in the plist file */
+struct px_block_t {
+	size_t		offt;  /* of the first line */
+	size_t		len;  /* bytes, including the last record separator */
+	uint32_t	first_line;
+	uint32_t	lines_cnt;
+};
+
+/* index creation */
+
+/*
+ * Start building a new index
+ */
+void px_new_start(struct px_new_t **x);
+
+/*
+ * Record the block of port `id', ports may be added in any order
+ */
+void px_new_add(struct px_new_t *x, unsigned id, const struct px_block_t *b);
+
+/*
+ * Record the fingerprint of port `id'
+ */
+void px_new_fprint(struct px_new_t *x, unsigned id, uint64_t fprint);
+
+/*
+ * Record the other files port `id' was made from, see port_t
+ */
+void px_new_fdeps(struct px_new_t *x, unsigned id, const char *fdeps);
+
+/*
+ * Record the summary of port `id' made of the trigram keys of its files,
+ * `keys' is sorted and stripped of duplicates in place
+ */
+void px_new_bloom(struct px_new_t *x, unsigned id, uint32_t *keys,
+		  size_t cnt);
+
+/*
+ * Write the index to `fn' and free `x', `plist_sz' is the size of the
+ * plist file, used to detect an index that does not belong to it
+ */
+void px_new_end(struct px_new_t *x, size_t plist_sz, const char *fn);
+
+/* index usage */
+
+/*
+ * Open index `fn' for the plist file which is `plist_sz' bytes long.
+ * Return -1 if the index does not exist or does not match the plist file.
+ */
+int px_open(struct px_t **x, const char *fn, size_t plist_sz);
+
+/*
+ * Free resources allocated by px_open()
+ */
+void px_close(struct px_t *x);
+
+/*
+ * Get the block of port `id'
+ * Returns 0 on success and -1 if the port has no lines in the plist file
+ */
+int px_port(const struct px_t *x, unsigned id, struct px_block_t *b);
+
+/*
+ * Get the fingerprint of port `id', 0 if it is not known
+ */
+uint64_t px_fprint(const struct px_t *x, unsigned id);
+
+/*
+ * Get the other files port `id' was made from, NULL if they are not known
+ */
+const char *px_fdeps(const struct px_t *x, unsigned id);
+
+/*
+ * Check the summary of port `id' against the trigram keys that every
+ * matching line must contain. Returns 0 if the port surely has no such
+ * line and 1 if it may have, or has no summary.
+ */
+int px_bloom(const struct px_t *x, unsigned id, const uint32_t *keys,
+	     size_t cnt);
+
+#endif  /* PLISTIDX_H */
+
+/* EOF */
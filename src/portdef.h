@@ -27,6 +27,7 @@
 #ifndef PORTDEF_H
 #define PORTDEF_H
 
+#include <stdint.h>
 #include <time.h>
 
 #include "vector.h"
@@ -34,6 +35,7 @@
 /* field separator in /usr/ports/INDEX */
 #define IDXFS	'|'
 
+/* a port as read from INDEX, while the store is being created */
 struct port_t {
 	unsigned	id;  /* port unique number */
 	char		path[128];  /* full port's path, used to identify the port when id is not applicable */
@@ -52,14 +54,80 @@ struct port_t {
 	char		*rdep;
 	char		*www;
 	struct vector_t	plist;  /* plist files */
-	int		matched;  /* logical OR'd SEARCH_BY_* */
+	uint64_t	fprint;  /* of the files plist is made from, 0 if unknown */
+	/*
+	 * The other files make read for the plist, outside the port's
+	 * directory and Mk/ (e.g. a master port's Makefile and pkg-plist),
+	 * relative to PORTSDIR and each one followed by a newline. NULL if
+	 * not known.
+	 */
+	char		*fdeps;
 };
 
+/* string fields of a port, see ports_t */
+enum port_fld {
+	PF_PKGNAME,
+	PF_PATH,
+	PF_PREFIX,
+	PF_COMMENT,
+	PF_PKGDESCR,
+	PF_MAINT,
+	PF_CATEGORIES,
+	PF_FDEP,
+	PF_EDEP,
+	PF_PDEP,
+	PF_BDEP,
+	PF_RDEP,
+	PF_WWW,
+	PF_CNT
+};
+
+/* bit for field `f' in a set of fields */
+#define PF_BIT(f)	(1 << (f))
+
+/* all fields */
+#define PF_ALL		(PF_BIT(PF_CNT) - 1)
+
+/* a string in the heap of a port_col_t, NUL terminated there */
+struct port_str_t {
+	uint32_t	offt;
+	uint32_t	len;  /* without the terminating NUL */
+};
+
+/* one field of all ports */
+struct port_col_t {
+	const struct port_str_t	*strs;  /* indexed like ports_t.ids,
+					   NULL if the column is not loaded */
+	const char		*heap;
+	const char		*fold;  /* heap lowercased by m_fold(), at the
+					   same offsets, NULL if not loaded */
+};
+
+/*
+ * All ports of the store, sorted by id. Each field is kept in its own
+ * column, so that looking at one field of all ports touches only that
+ * field's data. Whatever else is known about a port is kept in the
+ * side arrays, indexed like ids.
+ */
 struct ports_t {
-	struct port_t	**arr;  /* ports' array, there may be NULL pointers in it */
-	size_t		sz;  /* number of allocated elements in arr */
+	const uint32_t		*ids;
+	size_t			sz;  /* number of ports */
+	struct port_col_t	cols[PF_CNT];
+	int			*matched;  /* logical OR'd SEARCH_BY_* */
+	uint64_t		*fprints;  /* see port_t, NULL if not loaded */
+	const char		**fdeps;  /* see port_t, loaded with fprints */
+	struct vector_t		*plists;  /* files matched by -f, see
+					     filter_ports() */
 };
 
+/* string field `f' of the port at index `i' in `ports' */
+#define PORT_FLD(ports, i, f)	\
+	((ports)->cols[f].heap + (ports)->cols[f].strs[i].offt)
+#define PORT_FLD_LEN(ports, i, f)	((ports)->cols[f].strs[i].len)
+/* the same field lowercased, see port_col_t */
+#define PORT_FLD_FOLD(ports, i, f)	\
+	((ports)->cols[f].fold + (ports)->cols[f].strs[i].offt)
+
 #endif  /* PORTDEF_H */
 
 /* EOF */
@@ -27,6 +27,8 @@
 #include <sys/param.h>
 
 #include <err.h>
+#include <getopt.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -38,6 +40,7 @@
 #include "mkdb.h"
 #include "portdef.h"
 #include "portsearch.h"
+#include "server.h"
 #include "store.h"
 #include "xlibc.h"
 
@@ -46,6 +49,19 @@
 #define OPT_KEY		"key="
 #define OPT_KEY_LEN	4
 
+/* values returned by getopt_long(3) for options without a short form */
+#define LOPT_EXPLAIN	1000
+#define LOPT_SINCE	1001
+
+/* environment variables a client passes to the daemon with a search */
+static const char *const	srv_envs[] = {ENV_DFLT_OUTFLDS_NAME, NULL};
+
+/*
+ * Set opts->portsdir unless given with -H, from the store's meta file
+ * if possible or otherwise using set_portsdir()
+ */
+static void need_portsdir(struct options_t *opts);
+
 /*
  * Retrieve PORTSDIR using make -V PORTSDIR
  */
@@ -68,6 +84,28 @@ static void parse_opts(int argc, char **argv, struct options_t *opts);
  */
 static void parse_outflds(const char *outflds, int flds[DISP_FLDS_CNT]);
 
+/*
+ * Convert port's origin (category/port) given with -O to full path the
+ * way it is recorded in INDEX, full paths are taken as is
+ */
+static void set_origin(struct options_t *opts);
+
+/*
+ * Search the already loaded `store' as requested by `opts' and print
+ * the results
+ */
+static void search(struct options_t *opts, struct store_t *store);
+
+/*
+ * Load the store and serve searches on opts->daemon_socket forever
+ */
+static void serve(const struct options_t *opts);
+
+/*
+ * Run a search requested by a client, called by srv_handle()
+ */
+static int serve_query(int argc, char **argv, void *arg);
+
 /*
  * Print version information and exit
  */
@@ -80,33 +118,46 @@ main(int argc, char **argv)
 {
 	struct options_t	opts;
 	struct store_t		*store;
+	const char		*sock;
+	int			status;
 
 	memset(&opts, 0, sizeof(opts));
 
-	set_portsdir(&opts);
-
 	parse_opts(argc, argv, &opts);
 
+	/*
+	 * A running daemon has the store loaded already, let it search.
+	 * Only if asked to, a socket found at some default place may be
+	 * stale or belong to somebody else's store.
+	 */
+	if (opts.search_crit && (sock = getenv(ENV_SOCKET_NAME)) != NULL &&
+	    sock[0] != '\0')
+		if ((status = srv_query(sock, argc, argv, srv_envs)) != -1)
+			return status;
+
 	if (opts.update_db)
+	{
+		/* make knows better than a possibly old store */
+		if (opts.portsdir == NULL)
+			set_portsdir(&opts);
+
 		mkdb(&opts);
+	}
+	else if (opts.daemon_socket != NULL)
+		serve(&opts);
 	else if (opts.search_crit)
 	{
 		if (!s_exists())
 			errx(EX_USAGE, "Database does not exist, please create it first using the -u option");
 
-		if (!ISSET(SEARCH_BY_PFILE, opts.search_crit) &&
-		    strstr(opts.outflds, "rawfiles") != NULL)
-			errx(EX_USAGE, "-o rawfiles is specified without -f or -b");
-
-		parse_outflds(opts.outflds, opts.outflds_parsed);
+		if (opts.search_crit & SEARCH_BY_ORIGIN)
+			set_origin(&opts);
 
 		alloc_store(&store);
 
 		s_search_start(store);
 
-		filter_ports(store, &opts);
-
-		display_ports(get_ports(store), &opts);
+		search(&opts, store);
 
 		s_search_end(store);
 
@@ -116,6 +167,93 @@ main(int argc, char **argv)
 	return 0;
 }
 
+static void
+search(struct options_t *opts, struct store_t *store)
+{
+	if (!ISSET(SEARCH_BY_PFILE, opts->search_crit) &&
+	    strstr(opts->outflds, "rawfiles") != NULL)
+		errx(EX_USAGE, "-o rawfiles is specified without -f or -b");
+
+	parse_outflds(opts->outflds, opts->outflds_parsed);
+
+	filter_ports(store, opts);
+
+	display_ports(get_ports(store), opts);
+}
+
+static void
+serve(const struct options_t *opts)
+{
+	struct store_t	*store;
+	int		lsock;
+	int		conn;
+
+	if (!s_exists())
+		errx(EX_USAGE, "Database does not exist, please create it first using the -u option");
+
+	alloc_store(&store);
+
+	s_search_start(store);
+	/* each search runs in its own child, load everything once here */
+	s_search_preload(store);
+
+	lsock = srv_listen(opts->daemon_socket);
+
+	for (;;)
+	{
+		conn = srv_accept(lsock);
+
+		/* the database has been updated, serve the new one */
+		if (s_search_stale(store) && s_exists())
+		{
+			s_search_end(store);
+			s_search_start(store);
+			s_search_preload(store);
+		}
+
+		srv_handle(lsock, conn, srv_envs, serve_query, store);
+	}
+}
+
+static int
+serve_query(int argc, char **argv, void *arg)
+{
+	struct options_t	opts;
+
+	memset(&opts, 0, sizeof(opts));
+
+	/* parse_opts() has already been run in this process */
+	optreset = 1;
+	optind = 1;
+
+	parse_opts(argc, argv, &opts);
+
+	/* clients only send searches, do not let them do anything else */
+	if (!opts.search_crit || opts.update_db || opts.daemon_socket != NULL)
+		usage();
+
+	if (opts.search_crit & SEARCH_BY_ORIGIN)
+		set_origin(&opts);
+
+	search(&opts, (struct store_t *)arg);
+
+	return 0;
+}
+
+static void
+need_portsdir(struct options_t *opts)
+{
+	static struct store_meta_t	meta;
+
+	if (opts->portsdir != NULL)
+		return;
+
+	if (s_read_meta(&meta))
+		opts->portsdir = meta.portsdir;
+	else
+		set_portsdir(opts);
+}
+
 static void
 set_portsdir(struct options_t *opts)
 {
@@ -149,7 +287,19 @@ usage()
 	fprintf(stderr, "Usage:\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "update/create database:\n");
-	fprintf(stderr, "  $ %s -u [-H portshome] [-vvv]\n", prog);
+	fprintf(stderr, "  $ %s -u [-H portshome] [-j jobs] [-vvv]\n", prog);
+	fprintf(stderr, "  $ %s -u --since rev [-H portshome] [-j jobs] [-vvv]\n", prog);
+	fprintf(stderr, "  -j jobs\trun up to `jobs' make processes at the same time\n");
+	fprintf(stderr, "  --since\twhen portshome is a git checkout, look only at the ports\n");
+	fprintf(stderr, "\t\tchanged since `rev'; `%s' is the revision the database\n", SINCE_STORED);
+	fprintf(stderr, "\t\twas created from\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "serve searches from other %s processes:\n", prog);
+	fprintf(stderr, "  $ %s -d socket [-H portshome]\n", prog);
+	fprintf(stderr, "  keeps the database loaded and answers searches sent to the\n");
+	fprintf(stderr, "  unix domain socket `socket'; searches are sent to the daemon\n");
+	fprintf(stderr, "  only if $%s is set to its socket, and done locally\n", ENV_SOCKET_NAME);
+	fprintf(stderr, "  if nobody listens there\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "search for ports:\n");
 	fprintf(stderr, "  $ %s search_options\n", prog);
@@ -158,6 +308,7 @@ usage()
 	fprintf(stderr, "  -n name\tname (%s can be used)\n", OPT_NAME);
 	fprintf(stderr, "  -k key\tname, comment or dependencies (%s can be used)\n", OPT_KEY);
 	fprintf(stderr, "  -p path\tpath on the filesystem\n");
+	fprintf(stderr, "  -O origin\texact origin, e.g. ports-mgmt/portsearch (not a regex)\n");
 	fprintf(stderr, "  -i info\tinfo (comment)\n");
 	fprintf(stderr, "  -m maint\tmaintainer\n");
 	fprintf(stderr, "  -c cat\tcategory\n");
@@ -179,6 +330,9 @@ usage()
 	fprintf(stderr, "\t\tand can be used only with -f or -b\n");
 	fprintf(stderr, "  -X\t\twhen `-o rawfiles' is specified, prefix each filename with\n");
 	fprintf(stderr, "\t\tport's path even if only one port is found\n");
+	fprintf(stderr, "  --explain\tprint the order in which the criteria are evaluated\n");
+	fprintf(stderr, "\t\tand how many ports or lines each of them examined,\n");
+	fprintf(stderr, "\t\tthe format is described in the README\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "show the packing list (recorded in the database) for the given port(s):\n");
 	fprintf(stderr, "  $ %s -L path\n", prog);
@@ -194,8 +348,15 @@ usage()
 static void
 parse_opts(int argc, char **argv, struct options_t *opts)
 {
+	static const struct option	longopts[] = {
+		{"explain", no_argument, NULL, LOPT_EXPLAIN},
+		{"since", required_argument, NULL, LOPT_SINCE},
+		{NULL, 0, NULL, 0}
+	};
+
 	int	ch;
 	int	major_requests;
+	char	*endp;
 
 	/* get outflds from environment, if not present, use the default */
 	opts->outflds = getenv(ENV_DFLT_OUTFLDS_NAME);
@@ -208,17 +369,29 @@ parse_opts(int argc, char **argv, struct options_t *opts)
 	/* by default, be case sensitive for pfiles (ignoring case is _slow_) */
 	opts->icase_pfiles = 0;
 
-	while ((ch = getopt(argc, argv,
-			    "H:uv"
-			    "B:D:E:F:IP:R:SXb:c:f:i:k:m:n:o:p:w:"
-			    "L:"
-			    "Vh"))
+	/* by default, generate one packing list at a time */
+	opts->jobs = 1;
+
+	while ((ch = getopt_long(argc, argv,
+				 "H:d:j:uv"
+				 "B:D:E:F:IO:P:R:SXb:c:f:i:k:m:n:o:p:w:"
+				 "L:"
+				 "Vh", longopts, NULL))
 	       != -1)
 		switch (ch)
 		{
 		case 'H':
 			opts->portsdir = optarg;
 			break;
+		case 'd':
+			opts->daemon_socket = optarg;
+			break;
+		case 'j':
+			opts->jobs = (int)strtol(optarg, &endp, 10);
+			if (*endp != '\0' || opts->jobs < 1)
+				errx(EX_USAGE, "-j: invalid number of jobs: %s",
+				     optarg);
+			break;
 		case 'u':
 			opts->update_db = 1;
 			break;
@@ -245,6 +418,11 @@ parse_opts(int argc, char **argv, struct options_t *opts)
 		case 'I':
 			opts->icase_pfiles = 1;
 			break;
+		case 'O':
+			opts->search_crit |= SEARCH_BY_ORIGIN;
+			snprintf(opts->search_origin,
+				 sizeof(opts->search_origin), "%s", optarg);
+			break;
 		case 'P':
 			opts->search_crit |= SEARCH_BY_PDEP;
 			opts->search_pdep = optarg;
@@ -309,6 +487,13 @@ parse_opts(int argc, char **argv, struct options_t *opts)
 			opts->outflds = "rawfiles";
 			break;
 
+		case LOPT_EXPLAIN:
+			opts->explain = 1;
+			break;
+		case LOPT_SINCE:
+			opts->update_since = optarg;
+			break;
+
 		case 'V':
 			print_version();
 			/* NOT REACHED */
@@ -340,11 +525,38 @@ parse_opts(int argc, char **argv, struct options_t *opts)
 
 	if (opts->update_db)
 		major_requests++;
+	if (opts->daemon_socket != NULL)
+		major_requests++;
 	if (opts->search_crit)
 		major_requests++;
 
 	if (major_requests != 1)
 		usage();
+
+	if (opts->update_since != NULL &&
+	    (!opts->update_db || opts->update_since[0] == '\0'))
+		usage();
+}
+
+static void
+set_origin(struct options_t *opts)
+{
+	char	origin[PATH_MAX];
+	size_t	len;
+
+	if (opts->search_origin[0] != '/')
+	{
+		need_portsdir(opts);
+
+		snprintf(origin, sizeof(origin), "%s", opts->search_origin);
+		snprintf(opts->search_origin, sizeof(opts->search_origin),
+			 "%s/%s", opts->portsdir, origin);
+	}
+
+	/* ports-mgmt/portsearch/ is the same as ports-mgmt/portsearch */
+	len = strlen(opts->search_origin);
+	while (len > 1 && opts->search_origin[len - 1] == '/')
+		opts->search_origin[--len] = '\0';
 }
 
 static void
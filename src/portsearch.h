@@ -45,6 +45,7 @@
 #define SEARCH_BY_RDEP		004000
 #define SEARCH_BY_DEP		010000
 #define SEARCH_BY_WWW		020000
+#define SEARCH_BY_ORIGIN	040000
 
 #define DISP_NONE		0
 
@@ -66,15 +67,31 @@
 #define DFLT_OUTFLDS		"name,path,info,maint,bdep,rdep,www"
 #define ENV_DFLT_OUTFLDS_NAME	"PORTSEARCH_OUTFIELDS"
 
+#define ENV_SOCKET_NAME		"PORTSEARCH_SOCKET"
+
+/* --since argument for the revision recorded in the store */
+#define SINCE_STORED		"stored"
+
 struct options_t {
 	const char	*portsdir;
 	int		update_db;
+	/*
+	 * update only the ports changed in the git checkout since this
+	 * revision, SINCE_STORED for the one recorded in the store (--since)
+	 */
+	const char	*update_since;
+	/* serve searches on this unix domain socket (-d) */
+	const char	*daemon_socket;
 	int		verbose;
+	/* number of packing lists to generate at the same time */
+	int		jobs;
 	int		search_crit;
 	char		search_file[PATH_MAX];
 	const char	*search_name;
 	const char	*search_key;
 	const char	*search_path;
+	/* port given with -O, full path after set_origin() */
+	char		search_origin[PATH_MAX];
 	const char	*search_info;
 	const char	*search_maint;
 	const char	*search_cat;
@@ -92,6 +109,8 @@ struct options_t {
 	const char	*outflds;
 	int		outflds_parsed[DISP_FLDS_CNT];
 	int		always_show_portpath;
+	/* print the search plan and its statistics to stderr */
+	int		explain;
 };
 
 #endif  /* PORTSEARCH_H */
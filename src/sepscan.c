@@ -0,0 +1,314 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+
+#include <err.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SS_HAVE_SSE2
+#endif
+
+#if (defined(__amd64__) || defined(__x86_64__) || defined(__i386__)) && \
+    defined(__GNUC__)
+#include <immintrin.h>
+#define SS_HAVE_AVX2
+#endif
+
+#include "sepscan.h"
+
+/* the output arrays are grown before each chunk of this many bytes */
+#define SS_CHUNK	4096
+
+/* the kernel used for SS_BEST, set once by choose_best() */
+static pthread_once_t	best_once = PTHREAD_ONCE_INIT;
+static enum ss_kernel	best = SS_SCALAR;
+
+/***/
+
+/*
+ * Set `best' to the fastest kernel the CPU supports
+ */
+static void choose_best(void);
+
+/*
+ * Make room for `n' more offsets in both arrays of `ss'
+ */
+static void reserve(struct sepscan_t *ss, size_t n);
+
+/*
+ * Append `base' + the position of each bit set in `mask' to `out'
+ */
+static void emit(uint32_t *out, size_t *cnt, uint32_t base, uint32_t mask);
+
+/*
+ * Scan the bytes [start, end) of `buf' one by one
+ */
+static void scan_scalar(struct sepscan_t *ss, const char *buf,
+			size_t start, size_t end, char rs, char fs);
+
+#ifdef SS_HAVE_SSE2
+/*
+ * Scan the bytes [start, end) of `buf' 16 at a time, return where it
+ * stopped, the rest is less than 16 bytes
+ */
+static size_t scan_sse2(struct sepscan_t *ss, const char *buf,
+			size_t start, size_t end, char rs, char fs);
+#endif
+
+#ifdef SS_HAVE_AVX2
+/*
+ * Scan the bytes [start, end) of `buf' 32 at a time, return where it
+ * stopped, the rest is less than 32 bytes
+ */
+static size_t scan_avx2(struct sepscan_t *ss, const char *buf,
+			size_t start, size_t end, char rs, char fs)
+	__attribute__((target("avx2")));
+#endif
+
+/***/
+
+void
+ss_start(struct sepscan_t *ss)
+{
+	ss->rs = ss->fs = NULL;
+	ss->rs_cnt = ss->fs_cnt = 0;
+	ss->rs_sz = ss->fs_sz = 0;
+}
+
+void
+ss_scan(struct sepscan_t *ss, const char *buf, size_t len, char rs, char fs)
+{
+	ss_scan_with(ss, buf, len, rs, fs, SS_BEST);
+}
+
+void
+ss_scan_with(struct sepscan_t *ss, const char *buf, size_t len,
+	     char rs, char fs, enum ss_kernel kernel)
+{
+	size_t	start, end, pos;
+
+	if (len > UINT32_MAX)
+		errx(EX_SOFTWARE, "separator scan of %lu bytes exceeds 4GB",
+		     (unsigned long)len);
+
+	if (kernel == SS_BEST)
+	{
+		/* ss_scan() is called from the par_run() threads */
+		pthread_once(&best_once, choose_best);
+		kernel = best;
+	}
+
+	ss->rs_cnt = ss->fs_cnt = 0;
+
+	for (start = 0; start < len; start = end)
+	{
+		end = len - start > SS_CHUNK ? start + SS_CHUNK : len;
+
+		reserve(ss, end - start);
+
+		switch (kernel)
+		{
+#ifdef SS_HAVE_AVX2
+		case SS_AVX2:
+			pos = scan_avx2(ss, buf, start, end, rs, fs);
+			break;
+#endif
+#ifdef SS_HAVE_SSE2
+		case SS_SSE2:
+			pos = scan_sse2(ss, buf, start, end, rs, fs);
+			break;
+#endif
+		default:
+			pos = start;
+			break;
+		}
+
+		scan_scalar(ss, buf, pos, end, rs, fs);
+	}
+
+	if (len > 0 && buf[len - 1] != rs)
+	{
+		reserve(ss, 1);
+		ss->rs[ss->rs_cnt++] = (uint32_t)len;
+	}
+}
+
+int
+ss_supported(enum ss_kernel kernel)
+{
+	switch (kernel)
+	{
+	case SS_SCALAR:
+	case SS_BEST:
+		return 1;
+	case SS_SSE2:
+#ifdef SS_HAVE_SSE2
+		return 1;
+#else
+		return 0;
+#endif
+	case SS_AVX2:
+#ifdef SS_HAVE_AVX2
+		return __builtin_cpu_supports("avx2") != 0;
+#else
+		return 0;
+#endif
+	}
+
+	return 0;
+}
+
+void
+ss_destroy(struct sepscan_t *ss)
+{
+	free(ss->rs);
+	free(ss->fs);
+
+	ss_start(ss);
+}
+
+/***/
+
+static void
+choose_best(void)
+{
+	best = ss_supported(SS_AVX2) ? SS_AVX2 :
+		ss_supported(SS_SSE2) ? SS_SSE2 : SS_SCALAR;
+}
+
+/***/
+
+static void
+reserve(struct sepscan_t *ss, size_t n)
+{
+	size_t	realloc_bytes;
+
+	if (ss->rs_cnt + n > ss->rs_sz)
+	{
+		while (ss->rs_cnt + n > ss->rs_sz)
+			ss->rs_sz = ss->rs_sz == 0 ? SS_CHUNK : ss->rs_sz * 2;
+		realloc_bytes = ss->rs_sz * sizeof(uint32_t);
+		if ((ss->rs = realloc(ss->rs, realloc_bytes)) == NULL)
+			err(EX_OSERR, "realloc(): %u", (unsigned)realloc_bytes);
+	}
+
+	if (ss->fs_cnt + n > ss->fs_sz)
+	{
+		while (ss->fs_cnt + n > ss->fs_sz)
+			ss->fs_sz = ss->fs_sz == 0 ? SS_CHUNK : ss->fs_sz * 2;
+		realloc_bytes = ss->fs_sz * sizeof(uint32_t);
+		if ((ss->fs = realloc(ss->fs, realloc_bytes)) == NULL)
+			err(EX_OSERR, "realloc(): %u", (unsigned)realloc_bytes);
+	}
+}
+
+static void
+emit(uint32_t *out, size_t *cnt, uint32_t base, uint32_t mask)
+{
+	while (mask != 0)
+	{
+		out[(*cnt)++] = base + __builtin_ctz(mask);
+		mask &= mask - 1;
+	}
+}
+
+static void
+scan_scalar(struct sepscan_t *ss, const char *buf, size_t start, size_t end,
+	    char rs, char fs)
+{
+	size_t	i;
+
+	for (i = start; i < end; i++)
+		if (buf[i] == rs)
+			ss->rs[ss->rs_cnt++] = (uint32_t)i;
+		else if (buf[i] == fs)
+			ss->fs[ss->fs_cnt++] = (uint32_t)i;
+}
+
+#ifdef SS_HAVE_SSE2
+static size_t
+scan_sse2(struct sepscan_t *ss, const char *buf, size_t start, size_t end,
+	  char rs, char fs)
+{
+	const __m128i	rs_v = _mm_set1_epi8(rs);
+	const __m128i	fs_v = _mm_set1_epi8(fs);
+	__m128i		v;
+	size_t		i;
+
+	for (i = start; i + 16 <= end; i += 16)
+	{
+		v = _mm_loadu_si128((const __m128i *)(buf + i));
+
+		emit(ss->rs, &ss->rs_cnt, (uint32_t)i,
+		     (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, rs_v)));
+
+		if (fs != rs)
+			emit(ss->fs, &ss->fs_cnt, (uint32_t)i,
+			     (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v,
+									fs_v)));
+	}
+
+	return i;
+}
+#endif
+
+#ifdef SS_HAVE_AVX2
+static size_t
+scan_avx2(struct sepscan_t *ss, const char *buf, size_t start, size_t end,
+	  char rs, char fs)
+{
+	const __m256i	rs_v = _mm256_set1_epi8(rs);
+	const __m256i	fs_v = _mm256_set1_epi8(fs);
+	__m256i		v;
+	size_t		i;
+
+	for (i = start; i + 32 <= end; i += 32)
+	{
+		v = _mm256_loadu_si256((const __m256i *)(buf + i));
+
+		emit(ss->rs, &ss->rs_cnt, (uint32_t)i,
+		     (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v,
+								       rs_v)));
+
+		if (fs != rs)
+			emit(ss->fs, &ss->fs_cnt, (uint32_t)i,
+			     (uint32_t)_mm256_movemask_epi8(
+				 _mm256_cmpeq_epi8(v, fs_v)));
+	}
+
+	return i;
+}
+#endif
+
+/* EOF */
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Separator scanner: find all record and field separators of a buffer
+ * in a single pass, 16 or 32 bytes at a time where the CPU allows it.
+ * The loaders then walk the offsets instead of looking at every byte
+ * again with strchr(3) or strsep(3).
+ */
+
+#ifndef SEPSCAN_H
+#define SEPSCAN_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* ways of scanning, see ss_scan_with() */
+enum ss_kernel {
+	SS_SCALAR,
+	SS_SSE2,
+	SS_AVX2,
+	SS_BEST  /* the fastest one the CPU supports */
+};
+
+/* results of ss_scan(), offsets from the start of the buffer */
+struct sepscan_t {
+	uint32_t	*rs;  /* record separators */
+	size_t		rs_cnt;
+	size_t		rs_sz;  /* allocated elements in rs */
+	uint32_t	*fs;  /* field separators */
+	size_t		fs_cnt;
+	size_t		fs_sz;  /* allocated elements in fs */
+};
+
+/*
+ * Initialize `ss', it can be used for any number of ss_scan() calls
+ */
+void ss_start(struct sepscan_t *ss);
+
+/*
+ * Find all `rs' and `fs' bytes in `buf', which is `len' bytes long (at
+ * most 4GB), replacing the results of a previous scan. If `buf' does not
+ * end with `rs', `len' is added as the end of the last record, so that
+ * record number i always ends at ss->rs[i]. If `fs' is equal to `rs',
+ * only records are looked for.
+ */
+void ss_scan(struct sepscan_t *ss, const char *buf, size_t len,
+	     char rs, char fs);
+
+/*
+ * Same as ss_scan() but with the given `kernel', which must be supported
+ */
+void ss_scan_with(struct sepscan_t *ss, const char *buf, size_t len,
+		  char rs, char fs, enum ss_kernel kernel);
+
+/*
+ * Check whether `kernel' can be used on this CPU
+ * Return 1 if it can, 0 otherwise
+ */
+int ss_supported(enum ss_kernel kernel);
+
+/*
+ * Free resources, allocated by `ss'
+ */
+void ss_destroy(struct sepscan_t *ss);
+
+#endif  /* SEPSCAN_H */
+
+/* EOF */
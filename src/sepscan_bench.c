@@ -0,0 +1,220 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Measure how long finding the line and field separators of an INDEX
+ * takes with strsep(3), the way the loaders did it before sepscan, and
+ * with each ss_scan_with() kernel the CPU supports.
+ *
+ * usage: sepscan_bench [iterations [INDEX]]
+ */
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+
+#include "sepscan.h"
+
+/* lines of the generated INDEX if none is given */
+#define GEN_LINES	30000
+
+/*
+ * Read `path' into a newly allocated buffer, store its size in `len'
+ */
+static char *read_file(const char *path, size_t *len);
+
+/*
+ * Generate GEN_LINES INDEX-like lines, store the size in `len'
+ */
+static char *gen_index(size_t *len);
+
+/*
+ * Find the separators of `buf' with strsep(3) on a copy in `tmp',
+ * return the number of fields found
+ */
+static size_t scan_strsep(const char *buf, size_t len, char *tmp);
+
+/***/
+
+int
+main(int argc, char **argv)
+{
+	static const char	*names[] = {"scalar", "sse2", "avx2"};
+	struct sepscan_t	ss;
+	struct timeval		start, end;
+	enum ss_kernel		k;
+	int			iterations;
+	char			*buf;
+	char			*tmp;
+	size_t			len;
+	size_t			flds = 0;
+	int			i;
+
+	iterations = argc > 1 ? atoi(argv[1]) : 50;
+	if (iterations < 1)
+		errx(EX_USAGE, "invalid number of iterations: %s", argv[1]);
+
+	buf = argc > 2 ? read_file(argv[2], &len) : gen_index(&len);
+
+	if ((tmp = malloc(len + 1)) == NULL)
+		err(EX_OSERR, "malloc(): %lu", (unsigned long)len + 1);
+
+	printf("%lu bytes\n", (unsigned long)len);
+	printf("%8s %12s %10s\n", "method", "us", "MB/s");
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < iterations; i++)
+		flds = scan_strsep(buf, len, tmp);
+	gettimeofday(&end, NULL);
+
+#define REPORT(name) do { \
+	double	us = ((end.tv_sec - start.tv_sec) * 1e6 + \
+		      (end.tv_usec - start.tv_usec)) / iterations; \
+	printf("%8s %12.1f %10.1f\n", (name), us, len / us); \
+} while (0)
+
+	REPORT("strsep");
+
+	ss_start(&ss);
+
+	for (k = SS_SCALAR; k < SS_BEST; k++)
+	{
+		if (!ss_supported(k))
+			continue;
+
+		gettimeofday(&start, NULL);
+		for (i = 0; i < iterations; i++)
+			ss_scan_with(&ss, buf, len, '\n', '|', k);
+		gettimeofday(&end, NULL);
+
+		if (ss.rs_cnt + ss.fs_cnt != flds)
+			errx(EX_SOFTWARE, "%s: %lu separators, strsep: %lu",
+			     names[k], (unsigned long)(ss.rs_cnt + ss.fs_cnt),
+			     (unsigned long)flds);
+
+		REPORT(names[k]);
+	}
+
+#undef REPORT
+
+	ss_destroy(&ss);
+
+	free(tmp);
+	free(buf);
+
+	return 0;
+}
+
+static char *
+read_file(const char *path, size_t *len)
+{
+	FILE		*fp;
+	struct stat	sb;
+	char		*buf;
+
+	if ((fp = fopen(path, "r")) == NULL)
+		err(EX_NOINPUT, "fopen(): %s", path);
+
+	if (fstat(fileno(fp), &sb) == -1)
+		err(EX_IOERR, "fstat(): %s", path);
+
+	*len = (size_t)sb.st_size;
+
+	if ((buf = malloc(*len + 1)) == NULL)
+		err(EX_OSERR, "malloc(): %lu", (unsigned long)*len + 1);
+
+	if (fread(buf, 1, *len, fp) != *len)
+		err(EX_IOERR, "fread(): %s", path);
+
+	fclose(fp);
+
+	return buf;
+}
+
+static char *
+gen_index(size_t *len)
+{
+	char	*buf;
+	size_t	sz = GEN_LINES * 512;
+	int	i;
+
+	if ((buf = malloc(sz)) == NULL)
+		err(EX_OSERR, "malloc(): %lu", (unsigned long)sz);
+
+	*len = 0;
+	for (i = 0; i < GEN_LINES; i++)
+		*len += snprintf(buf + *len, sz - *len,
+				 "port%d-1.%d|/usr/ports/cat%d/port%d|/usr/local|"
+				 "A port that does something number %d|"
+				 "/usr/ports/cat%d/port%d/pkg-descr|"
+				 "maint%d@FreeBSD.org|cat%d misc||"
+				 "gmake-4.4 pkgconf-2.0|libfoo-%d.0|"
+				 "libfoo-%d.0 perl5-5.36||"
+				 "https://www.example.org/port%d/\n",
+				 i, i % 10, i % 60, i, i, i % 60, i, i % 500,
+				 i % 60, i % 77, i % 77, i);
+
+	return buf;
+}
+
+static size_t
+scan_strsep(const char *buf, size_t len, char *tmp)
+{
+	char	*lines;
+	char	*line;
+	size_t	cnt = 0;
+
+	memcpy(tmp, buf, len);
+	tmp[len] = '\0';
+
+	lines = tmp;
+	while ((line = strsep(&lines, "\n")) != NULL)
+	{
+		/* count the separator that ended the line */
+		if (lines != NULL)
+			cnt++;
+		else if (*line == '\0')
+			break;
+		else
+			/* not terminated, ss_scan() adds the end */
+			cnt++;
+
+		while (strsep(&line, "|") != NULL)
+			if (line != NULL)
+				cnt++;
+	}
+
+	return cnt;
+}
+
+/* EOF */
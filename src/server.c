@@ -0,0 +1,583 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * The client sends one byte carrying its stdout and stderr (SCM_RIGHTS)
+ * followed by lines:
+ *   arg <argv[i]>         for each element of argv
+ *   env <name>=<value>    for each environment variable to set
+ *   env <name>            for each environment variable to unset
+ *   end
+ * and the daemon replies, after the search is over:
+ *   status <exit status>
+ */
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include <err.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include "server.h"
+#include "xlibc.h"
+
+#define REQ_ARG		"arg "
+#define REQ_ARG_LEN	4
+#define REQ_ENV		"env "
+#define REQ_ENV_LEN	4
+#define REQ_END		"end\n"
+#define REQ_END_LEN	4
+
+#define REPLY_STATUS	"status "
+
+/* stdout and stderr of the client */
+#define PASSED_FDS	2
+
+/*
+ * Fill `sun' with the address of `path'
+ */
+static void set_addr(struct sockaddr_un *sun, const char *path);
+
+/*
+ * Remove the socket at `path' (address `sun') if no daemon listens on
+ * it anymore, exit if one does
+ */
+static void remove_stale(const char *path, const struct sockaddr_un *sun);
+
+/*
+ * Serve the client connected to `conn', called in the child forked by
+ * srv_handle(), does not return
+ */
+static void handle(int conn, const char *const *envs,
+		   int (*query)(int, char **, void *), void *arg);
+
+/*
+ * Return nonzero if the variable in `line' (name or name=value) is one
+ * of the NULL terminated `envs'
+ */
+static int env_allowed(const char *line, const char *const *envs);
+
+/*
+ * Read the whole request from `conn' into `*buf' (NUL terminated) and
+ * the descriptors passed with it into `fds'
+ */
+static void read_request(int conn, char **buf, int fds[PASSED_FDS]);
+
+/*
+ * Build the request text sent by srv_query(), return NULL if it can not
+ * be expressed
+ */
+static char *make_request(int argc, char **argv, const char *const *envs);
+
+/*
+ * Send `len' bytes from `buf' to `sock', attaching stdout and stderr to
+ * the first chunk
+ * Return 0 on success, -1 on failure.
+ */
+static int send_request(int sock, const char *buf, size_t len);
+
+/***/
+
+int
+srv_listen(const char *path)
+{
+	struct sockaddr_un	sun;
+	struct stat		sb;
+	int			lsock;
+	mode_t			omask;
+
+	set_addr(&sun, path);
+
+	if (lstat(path, &sb) == 0 && S_ISSOCK(sb.st_mode))
+		remove_stale(path, &sun);
+
+	if ((lsock = socket(PF_LOCAL, SOCK_STREAM, 0)) == -1)
+		err(EX_OSERR, "socket()");
+
+	/*
+	 * Clients make the daemon (possibly root) run searches and set
+	 * environment variables, do not let anybody else in. The umask keeps
+	 * the socket closed between bind(2) and chmod(2).
+	 */
+	omask = umask(0777 & ~SRV_SOCK_MODE);
+
+	if (bind(lsock, (struct sockaddr *)&sun, sizeof(sun)) == -1)
+		err(EX_CANTCREAT, "bind(): %s", path);
+
+	umask(omask);
+
+	if (chmod(path, SRV_SOCK_MODE) == -1)
+		err(EX_CANTCREAT, "chmod(): %s", path);
+
+	if (listen(lsock, SOMAXCONN) == -1)
+		err(EX_OSERR, "listen(): %s", path);
+
+	/* the per connection processes are never waited for */
+	if (signal(SIGCHLD, SIG_IGN) == SIG_ERR)
+		err(EX_OSERR, "signal()");
+
+	return lsock;
+}
+
+int
+srv_accept(int lsock)
+{
+	int	conn;
+
+	while ((conn = accept(lsock, NULL, NULL)) == -1)
+		if (errno != EINTR && errno != ECONNABORTED)
+			err(EX_OSERR, "accept()");
+
+	return conn;
+}
+
+void
+srv_handle(int lsock, int conn, const char *const *envs,
+	   int (*query)(int argc, char **argv, void *arg), void *arg)
+{
+	/* do not let the children inherit and flush our buffers */
+	fflush(NULL);
+
+	switch (fork())
+	{
+	case -1:
+		warn("fork()");
+		break;
+	case 0:
+		if (close(lsock) == -1)
+			err(EX_OSERR, "close(): %d", lsock);
+
+		handle(conn, envs, query, arg);
+
+		/* NOTREACHED */
+		break;
+	}
+
+	if (close(conn) == -1)
+		err(EX_OSERR, "close(): %d", conn);
+}
+
+int
+srv_query(const char *path, int argc, char **argv, const char *const *envs)
+{
+	struct sockaddr_un	sun;
+	int			sock;
+	char			*req;
+	char			reply[64];
+	size_t			reply_len;
+	ssize_t			rd_len;
+	int			status;
+
+	if (path[0] == '\0' || strlen(path) >= sizeof(sun.sun_path))
+		return -1;
+
+	if ((req = make_request(argc, argv, envs)) == NULL)
+		return -1;
+
+	set_addr(&sun, path);
+
+	if ((sock = socket(PF_LOCAL, SOCK_STREAM, 0)) == -1)
+	{
+		xfree(req);
+		return -1;
+	}
+
+	if (connect(sock, (struct sockaddr *)&sun, sizeof(sun)) == -1 ||
+	    send_request(sock, req, strlen(req)) == -1)
+	{
+		/* no daemon, nothing has been done yet */
+		close(sock);
+		xfree(req);
+		return -1;
+	}
+
+	xfree(req);
+
+	/* the reply comes when the search is over */
+	reply_len = 0;
+	while (reply_len < sizeof(reply) - 1)
+	{
+		rd_len = read(sock, reply + reply_len,
+			      sizeof(reply) - 1 - reply_len);
+		if (rd_len == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			err(EX_IOERR, "read(): %s", path);
+		}
+		if (rd_len == 0)
+			break;
+		reply_len += rd_len;
+	}
+	reply[reply_len] = '\0';
+
+	close(sock);
+
+	if (sscanf(reply, REPLY_STATUS "%d", &status) != 1)
+		errx(EX_UNAVAILABLE, "%s: the daemon did not reply", path);
+
+	return status;
+}
+
+static void
+set_addr(struct sockaddr_un *sun, const char *path)
+{
+	memset(sun, 0, sizeof(*sun));
+
+	sun->sun_family = AF_LOCAL;
+
+	if (strlen(path) >= sizeof(sun->sun_path))
+		errx(EX_USAGE, "%s: socket path too long", path);
+
+	strcpy(sun->sun_path, path);
+}
+
+static void
+remove_stale(const char *path, const struct sockaddr_un *sun)
+{
+	int	sock;
+
+	if ((sock = socket(PF_LOCAL, SOCK_STREAM, 0)) == -1)
+		err(EX_OSERR, "socket()");
+
+	if (connect(sock, (const struct sockaddr *)sun, sizeof(*sun)) == 0)
+		errx(EX_UNAVAILABLE, "%s: a daemon is already running", path);
+
+	/*
+	 * Refused: left behind by a daemon that did not exit cleanly.
+	 * Anything else but a socket that is already gone (e.g. EACCES)
+	 * does not tell whether a daemon is there.
+	 */
+	if (errno != ECONNREFUSED && errno != ENOENT)
+		err(EX_UNAVAILABLE, "connect(): %s", path);
+
+	close(sock);
+
+	if (unlink(path) == -1 && errno != ENOENT)
+		err(EX_CANTCREAT, "unlink(): %s", path);
+}
+
+static void
+handle(int conn, const char *const *envs,
+       int (*query)(int, char **, void *), void *arg)
+{
+	char	*buf, *line, *nl;
+	int	fds[PASSED_FDS];
+	char	**argv;
+	int	argc;
+	pid_t	pid;
+	int	status;
+
+	/* waitpid(2) below needs the default */
+	if (signal(SIGCHLD, SIG_DFL) == SIG_ERR)
+		err(EX_OSERR, "signal()");
+
+	read_request(conn, &buf, fds);
+
+	argc = 0;
+	for (line = buf; *line != '\0'; line = nl + 1)
+	{
+		nl = strchr(line, '\n');
+		if (strncmp(line, REQ_ARG, REQ_ARG_LEN) == 0)
+			argc++;
+	}
+
+	if (argc == 0)
+		errx(EX_PROTOCOL, "request without arguments");
+
+	argv = (char **)xmalloc((argc + 1) * sizeof(char *));
+
+	argc = 0;
+	for (line = buf; *line != '\0'; line = nl + 1)
+	{
+		nl = strchr(line, '\n');
+		nl[0] = '\0';
+
+		if (strncmp(line, REQ_ARG, REQ_ARG_LEN) == 0)
+			argv[argc++] = line + REQ_ARG_LEN;
+		else if (strncmp(line, REQ_ENV, REQ_ENV_LEN) == 0)
+		{
+			line += REQ_ENV_LEN;
+			if (!env_allowed(line, envs))
+				errx(EX_PROTOCOL, "request sets %s", line);
+			if (strchr(line, '=') != NULL)
+			{
+				if (putenv(line) == -1)
+					err(EX_OSERR, "putenv(): %s", line);
+			}
+			else
+				unsetenv(line);
+		}
+	}
+	argv[argc] = NULL;
+
+	switch ((pid = fork()))
+	{
+	case -1:
+		err(EX_OSERR, "fork()");
+
+		/* NOTREACHED */
+		break;
+	case 0:
+		if (dup2(fds[0], STDOUT_FILENO) == -1 ||
+		    dup2(fds[1], STDERR_FILENO) == -1)
+			err(EX_OSERR, "dup2()");
+
+		close(fds[0]);
+		close(fds[1]);
+		close(conn);
+
+		exit(query(argc, argv, arg));
+
+		/* NOTREACHED */
+		break;
+	}
+
+	close(fds[0]);
+	close(fds[1]);
+
+	while (waitpid(pid, &status, 0) == -1)
+		if (errno != EINTR)
+			err(EX_OSERR, "waitpid()");
+
+	if (WIFEXITED(status))
+		status = WEXITSTATUS(status);
+	else
+		/* the way sh(1) reports it */
+		status = 128 + WTERMSIG(status);
+
+	/* the client may be gone already, nothing to do about it */
+	signal(SIGPIPE, SIG_IGN);
+	dprintf(conn, REPLY_STATUS "%d\n", status);
+
+	_exit(0);
+}
+
+static int
+env_allowed(const char *line, const char *const *envs)
+{
+	size_t	len;
+	int	i;
+
+	len = strcspn(line, "=");
+
+	for (i = 0; envs[i] != NULL; i++)
+		if (strlen(envs[i]) == len && strncmp(line, envs[i], len) == 0)
+			return 1;
+
+	return 0;
+}
+
+static void
+read_request(int conn, char **buf, int fds[PASSED_FDS])
+{
+	struct msghdr	msg;
+	struct iovec	iov;
+	struct cmsghdr	*cmsg;
+	union {
+		struct cmsghdr	hdr;
+		char		buf[CMSG_SPACE(PASSED_FDS * sizeof(int))];
+	}		cmsgbuf;
+	size_t		len, sz;
+	ssize_t		rd_len;
+	int		got_fds;
+
+	sz = BUFSIZ;
+	*buf = (char *)xmalloc(sz);
+	len = 0;
+	got_fds = 0;
+
+	for (;;)
+	{
+		if (sz - len < BUFSIZ)
+		{
+			sz *= 2;
+			if ((*buf = realloc(*buf, sz)) == NULL)
+				err(EX_OSERR, "realloc(): %u", (unsigned)sz);
+		}
+
+		/* leave room for the terminating NUL */
+		iov.iov_base = *buf + len;
+		iov.iov_len = sz - len - 1;
+
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = cmsgbuf.buf;
+		msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+		if ((rd_len = recvmsg(conn, &msg, 0)) == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			err(EX_IOERR, "recvmsg()");
+		}
+
+		/* srv_listen() checking whether a daemon is running */
+		if (rd_len == 0 && len == 0)
+			_exit(0);
+
+		if (rd_len == 0)
+			errx(EX_PROTOCOL, "incomplete request");
+
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+		     cmsg = CMSG_NXTHDR(&msg, cmsg))
+			if (cmsg->cmsg_level == SOL_SOCKET &&
+			    cmsg->cmsg_type == SCM_RIGHTS &&
+			    cmsg->cmsg_len == CMSG_LEN(PASSED_FDS * sizeof(int)))
+			{
+				memcpy(fds, CMSG_DATA(cmsg),
+				       PASSED_FDS * sizeof(int));
+				got_fds = 1;
+			}
+
+		len += rd_len;
+
+		/* the first byte only carries the descriptors */
+		if (len > REQ_END_LEN &&
+		    strncmp(*buf + len - REQ_END_LEN, REQ_END, REQ_END_LEN) == 0 &&
+		    (len == REQ_END_LEN + 1 ||
+		     (*buf)[len - REQ_END_LEN - 1] == '\n'))
+			break;
+	}
+
+	if (!got_fds)
+		errx(EX_PROTOCOL, "request without descriptors");
+
+	/* skip the descriptors' byte, drop the end line */
+	(*buf)[len - REQ_END_LEN] = '\0';
+	memmove(*buf, *buf + 1, len - REQ_END_LEN);
+}
+
+static char *
+make_request(int argc, char **argv, const char *const *envs)
+{
+	const char *const	*e;
+	const char		*val;
+	char			*req, *p;
+	size_t			sz;
+	int			i;
+
+	/* the descriptors' byte and the end line */
+	sz = 1 + REQ_END_LEN + 1;
+
+	for (i = 0; i < argc; i++)
+	{
+		/* arguments are separated by newlines */
+		if (strchr(argv[i], '\n') != NULL)
+			return NULL;
+		sz += REQ_ARG_LEN + strlen(argv[i]) + 1;
+	}
+
+	for (e = envs; *e != NULL; e++)
+	{
+		if ((val = getenv(*e)) != NULL && strchr(val, '\n') != NULL)
+			return NULL;
+		sz += REQ_ENV_LEN + strlen(*e) + 1 +
+			(val != NULL ? strlen(val) : 0) + 1;
+	}
+
+	req = (char *)xmalloc(sz);
+
+	p = req;
+	*p++ = '.';
+
+	for (i = 0; i < argc; i++)
+		p += sprintf(p, REQ_ARG "%s\n", argv[i]);
+
+	for (e = envs; *e != NULL; e++)
+		if ((val = getenv(*e)) != NULL)
+			p += sprintf(p, REQ_ENV "%s=%s\n", *e, val);
+		else
+			p += sprintf(p, REQ_ENV "%s\n", *e);
+
+	strcpy(p, REQ_END);
+
+	return req;
+}
+
+static int
+send_request(int sock, const char *buf, size_t len)
+{
+	struct msghdr	msg;
+	struct iovec	iov;
+	struct cmsghdr	*cmsg;
+	union {
+		struct cmsghdr	hdr;
+		char		buf[CMSG_SPACE(PASSED_FDS * sizeof(int))];
+	}		cmsgbuf;
+	const int	fds[PASSED_FDS] = {STDOUT_FILENO, STDERR_FILENO};
+	ssize_t		wr_len;
+
+	/* the first byte, with the descriptors */
+	iov.iov_base = (void *)buf;
+	iov.iov_len = 1;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(PASSED_FDS * sizeof(int));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	while (sendmsg(sock, &msg, MSG_NOSIGNAL) == -1)
+		if (errno != EINTR)
+			return -1;
+
+	buf++;
+	len--;
+
+	while (len > 0)
+	{
+		if ((wr_len = send(sock, buf, len, MSG_NOSIGNAL)) == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += wr_len;
+		len -= wr_len;
+	}
+
+	return 0;
+}
+
+/* EOF */
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Serving searches over a unix domain socket. The daemon keeps the store
+ * loaded, a client passes its stdout and stderr and its command line
+ * arguments and gets back the exit status of the search.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#define SRV_SOCK_MODE	0600
+
+/*
+ * Create a unix domain socket at `path', replacing a stale one, and
+ * listen on it. Exits if another daemon is listening at `path'. Only the
+ * owner of the daemon may connect to it (mode SRV_SOCK_MODE), whatever
+ * the umask is. Also arranges for the processes started by srv_handle()
+ * to be reaped without waiting for them.
+ * Return the listening socket.
+ */
+int srv_listen(const char *path);
+
+/*
+ * Wait for a client on socket `lsock' returned by srv_listen()
+ * Return the connected socket.
+ */
+int srv_accept(int lsock);
+
+/*
+ * Serve the request of a client connected to `conn' in a child process
+ * and return immediately, `conn' is closed. `query' is called in a
+ * grandchild whose stdout and stderr are the client's, with the client's
+ * command line and `arg'. Its return value is passed to the client as
+ * exit status. Only the environment variables listed in the NULL
+ * terminated `envs' may be set or unset by the client, a request that
+ * touches others is rejected.
+ */
+void srv_handle(int lsock, int conn, const char *const *envs,
+		int (*query)(int argc, char **argv, void *arg), void *arg);
+
+/*
+ * Ask the daemon listening at `path' to run the command line `argv'.
+ * The environment variables listed in the NULL terminated `envs' are
+ * passed along (or unset in the daemon if they are not set here).
+ * Return the exit status of the search or -1 if there is no daemon or
+ * the request can not be sent, in which case the search should be done
+ * locally.
+ */
+int srv_query(const char *path, int argc, char **argv,
+	      const char *const *envs);
+
+#endif  /* SERVER_H */
+
+/* EOF */
@@ -27,6 +27,7 @@
 #ifndef STORE_H
 #define STORE_H
 
+#include <stdint.h>
 #include <stdio.h>
 
 #include "portdef.h"
@@ -36,6 +37,14 @@
 
 struct store_t;
 
+/* configuration of the ports tree the store was created from */
+struct store_meta_t {
+	char		portsdir[PATH_MAX];
+	char		indexfile[PATH_MAX];  /* full path */
+	uint64_t	mk_fprint;  /* of the files in PORTSDIR/Mk, 0 if unknown */
+	char		commit[64];  /* git HEAD of PORTSDIR, "" if unknown */
+};
+
 /*
  * *s = malloc(sizeof(struct store_t));
  */
@@ -75,10 +84,25 @@ void s_new_end(struct store_t *s);
  */
 void s_add_port(struct store_t *s, const struct port_t *port);
 
+/*
+ * Set the configuration recorded in the temporary store created by
+ * s_new_start()
+ */
+void s_new_meta(struct store_t *s, const struct store_meta_t *meta);
+
 /* store reading procedures */
 
+/*
+ * Read the configuration recorded in the current store, independent of
+ * the other procedures.
+ * Return 1 on success, 0 if the store or the configuration does not
+ * exist (stores created by older versions do not have it).
+ */
+int s_read_meta(struct store_meta_t *meta);
+
 /*
  * Initialize store for reading, independent of s_new_start()
+ * The ports get their `fprint' member set as recorded in the store
  * Either this or s_search_start must be called
  * s_load_port_by_path() and s_load_port_plist() can be used when this
  * function is called
@@ -103,12 +127,26 @@ void s_search_start(struct store_t *s);
 void s_search_end(struct store_t *s);
 
 /*
- * Get pointer to port in store that has its path member equal to `path'
+ * Load (and check) all of the store loaded by s_search_start() now
+ * rather than as searches need it, for a process that forks one child
+ * per search, so that the children inherit it instead of each repeating
+ * the work
+ */
+void s_search_preload(struct store_t *s);
+
+/*
+ * Check whether the store on disk has been replaced (e.g. by another
+ * process running s_new_end()) after s_search_start() loaded it.
+ * Return 1 if it has, 0 otherwise.
+ */
+int s_search_stale(struct store_t *s);
+
+/*
+ * Get the index in get_ports() of the port whose path is `path'
  * Store must have been s_read_start'ed
  * If port is not found, then -1 is returned
  */
-int s_load_port_by_path(struct store_t *s, const char *path,
-			struct port_t **port);
+int s_load_port_by_path(struct store_t *s, const char *path, size_t *idx);
 
 /*
  * Load port's plist
@@ -120,8 +158,9 @@ void s_load_port_plist(struct store_t *s, struct port_t *port);
 
 /*
  * Filter internal ports structure (that can be retrieved with get_ports()),
- * so that all non-NULL members get their `matched' member properly
- * initialized based on opts->search_crit
+ * so that its `matched' array is properly initialized based on
+ * opts->search_crit and its `plists' array holds the matched files if
+ * SEARCH_BY_PFILE is given
  */
 void filter_ports(struct store_t *s, const struct options_t *opts);
 
@@ -0,0 +1,681 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Store backend that keeps the index in a binary file which is mmap(2)ed
+ * when searching. The file consists of a header, the ports' ids in
+ * ascending order and a column for each field. A column is an array of
+ * struct port_str_t, one for each id, followed by a heap of the NUL
+ * terminated strings it points to. The ids and the columns are used in
+ * place as the ports of the store and a search checks only the columns
+ * it needs, so that the others are never read from disk. The file is
+ * created in the native byte order, the store directory is specific to
+ * the machine architecture anyway.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <err.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include "match.h"
+#include "portdef.h"
+#include "store.h"
+#include "store_common.h"
+#include "xlibc.h"
+
+#define BIN_MAGIC	"PSIDXBIN"
+#define BIN_MAGIC_LEN	8
+#define BIN_VERSION	4
+
+/* offsets are from the start of the file and multiples of 4 */
+struct bin_col_t {
+	uint32_t	strs_offt;  /* ports_cnt struct port_str_t */
+	uint32_t	heap_offt;
+	uint32_t	heap_sz;
+	uint32_t	fold_offt;  /* heap_sz bytes, the heap lowercased by
+				       m_fold(), heap_offt if it has no
+				       uppercase letters */
+};
+
+struct bin_hdr_t {
+	char		magic[BIN_MAGIC_LEN];
+	uint32_t	version;
+	uint32_t	hdr_sz;  /* sizeof(struct bin_hdr_t) */
+	uint32_t	ports_cnt;
+	uint32_t	ids_offt;  /* ports_cnt uint32_t */
+	struct bin_col_t	cols[PF_CNT];
+};
+
+/* the next multiple of 4 */
+#define ALIGN4(n)	(((n) + 3) & ~(size_t)3)
+
+/* position of a port in bin_new_t, sorted by sc_ids_cmp() on id */
+struct bin_ord_t {
+	uint32_t	id;  /* must be first */
+	size_t		idx;
+};
+
+/* a column of the new index */
+struct bin_new_col_t {
+	struct port_str_t	*strs;  /* indexed like bin_new_t.ids */
+	char			*heap;
+	size_t			heap_len;
+	size_t			heap_sz;  /* allocated bytes in heap */
+};
+
+/* growing in-memory image of the new index, written at s_new_end() */
+struct bin_new_t {
+	uint32_t		*ids;
+	size_t			ports_cnt;
+	size_t			ports_sz;  /* allocated elements in ids and strs */
+	struct bin_new_col_t	cols[PF_CNT];
+};
+
+struct store_t {
+	struct sc_dirs_t	d;
+
+	char		index_fn[PATH_MAX];
+	char		index_new_fn[PATH_MAX];
+	char		index_old_fn[PATH_MAX];
+
+	struct sc_new_t	new_plist;
+	struct bin_new_t	new;
+
+	/* mmap(2)ed index file */
+	void		*map;
+	size_t		map_sz;
+
+	struct ports_t	ports;  /* ids and columns inside map */
+	struct hash_t	by_path;  /* path -> element of ports.ids */
+	int		by_path_ok;  /* whether by_path has been created */
+	struct sc_stamp_t	stamp;  /* store loaded by s_search_start() */
+	struct plist_t	*plist;
+};
+
+/*
+ * Set index and plist filenames
+ */
+static void set_filenames(struct store_t *store);
+
+/*
+ * Check whether `hdr' is of the format written by this version
+ */
+static int hdr_supported(const struct bin_hdr_t *hdr);
+
+/*
+ * Append NUL terminated `str' to the heap of column `f' of the new
+ * index as the field of its last port
+ */
+static void heap_add(struct bin_new_t *new, int f, const char *str);
+
+/*
+ * Write the new index file from the image collected by s_add_port()
+ */
+static void write_index(struct store_t *s);
+
+/*
+ * mmap(2) the index file and set up `ports' over the ids inside it,
+ * no columns are loaded yet
+ */
+static void load_index(struct store_t *s);
+
+/*
+ * Set up the columns of `ports' in the PF_BIT()s `flds', that have not
+ * been loaded yet, checking their consistency. Every string of a column
+ * is checked once, when it is set up, see s_search_preload().
+ */
+static void load_cols(struct store_t *s, int flds);
+
+/*
+ * Free data allocated by load_index()
+ */
+static void free_index(struct store_t *s);
+
+/***/
+
+void
+alloc_store(struct store_t **s)
+{
+	*s = (struct store_t *)xmalloc(sizeof(struct store_t));
+}
+
+void
+free_store(struct store_t *s)
+{
+	xfree(s);
+}
+
+int
+s_exists()
+{
+	struct store_t		store;
+	struct bin_hdr_t	hdr;
+	int			fd;
+	ssize_t			rd_len;
+
+	set_filenames(&store);
+
+	if (access(store.d.plist_fn, F_OK) == -1 ||
+	    (fd = open(store.index_fn, O_RDONLY)) == -1)
+		return 0;
+
+	rd_len = read(fd, &hdr, sizeof(hdr));
+
+	close(fd);
+
+	/* an index of another format is recreated from scratch by -u */
+	if (rd_len != sizeof(hdr) || !hdr_supported(&hdr))
+		return 0;
+
+	return 1;
+}
+
+struct ports_t *
+get_ports(struct store_t *s)
+{
+	return &s->ports;
+}
+
+void
+s_new_start(struct store_t *s)
+{
+	struct bin_new_col_t	*col;
+	int			f;
+
+	set_filenames(s);
+
+	sc_mkdirs(&s->d);
+
+	sc_new_start(&s->new_plist, &s->d);
+
+	s->new.ports_sz = 1024;
+	s->new.ports_cnt = 0;
+	s->new.ids = (uint32_t *)xmalloc(s->new.ports_sz * sizeof(uint32_t));
+
+	for (f = 0; f < PF_CNT; f++)
+	{
+		col = &s->new.cols[f];
+
+		col->strs = (struct port_str_t *)xmalloc(s->new.ports_sz *
+		    sizeof(struct port_str_t));
+
+		col->heap_sz = 16384;
+		col->heap = (char *)xmalloc(col->heap_sz);
+		/* offset 0 is the empty string, shared by all empty fields */
+		col->heap[0] = '\0';
+		col->heap_len = 1;
+	}
+}
+
+void
+s_new_end(struct store_t *s)
+{
+	const char	*oldfiles[] = {s->index_old_fn, NULL};
+	int		f;
+
+	sc_new_end(&s->new_plist, &s->d);
+
+	write_index(s);
+
+	xfree(s->new.ids);
+	for (f = 0; f < PF_CNT; f++)
+	{
+		xfree(s->new.cols[f].strs);
+		xfree(s->new.cols[f].heap);
+	}
+
+	sc_replace_dir(&s->d, oldfiles);
+}
+
+void
+s_new_meta(struct store_t *s, const struct store_meta_t *meta)
+{
+	sc_new_meta(&s->new_plist, meta);
+}
+
+int
+s_read_meta(struct store_meta_t *meta)
+{
+	struct store_t	store;
+
+	set_filenames(&store);
+
+	return sc_read_meta(&store.d, meta);
+}
+
+void
+s_add_port(struct store_t *s, const struct port_t *port)
+{
+	struct bin_new_t	*new = &s->new;
+	size_t			realloc_bytes;
+	int			f;
+
+	sc_new_add_port(&s->new_plist, &s->d, port);
+
+	if (new->ports_cnt >= new->ports_sz)
+	{
+		new->ports_sz *= 2;
+
+		realloc_bytes = new->ports_sz * sizeof(uint32_t);
+		if ((new->ids = realloc(new->ids, realloc_bytes)) == NULL)
+			err(EX_OSERR, "realloc(): %u", (unsigned)realloc_bytes);
+
+		realloc_bytes = new->ports_sz * sizeof(struct port_str_t);
+		for (f = 0; f < PF_CNT; f++)
+			if ((new->cols[f].strs = realloc(new->cols[f].strs,
+							 realloc_bytes)) == NULL)
+				err(EX_OSERR, "realloc(): %u",
+				    (unsigned)realloc_bytes);
+	}
+
+	new->ids[new->ports_cnt] = port->id;
+
+	heap_add(new, PF_PKGNAME, port->pkgname);
+	heap_add(new, PF_PATH, port->path);
+	heap_add(new, PF_PREFIX, port->prefix);
+	heap_add(new, PF_COMMENT, port->comment);
+	heap_add(new, PF_PKGDESCR, port->pkgdescr);
+	heap_add(new, PF_MAINT, port->maint);
+	heap_add(new, PF_CATEGORIES, port->categories);
+	heap_add(new, PF_FDEP, port->fdep);
+	heap_add(new, PF_EDEP, port->edep);
+	heap_add(new, PF_PDEP, port->pdep);
+	heap_add(new, PF_BDEP, port->bdep);
+	heap_add(new, PF_RDEP, port->rdep);
+	heap_add(new, PF_WWW, port->www);
+
+	new->ports_cnt++;
+}
+
+static void
+heap_add(struct bin_new_t *new, int f, const char *str)
+{
+	struct bin_new_col_t	*col = &new->cols[f];
+	struct port_str_t	*fld = &col->strs[new->ports_cnt];
+	size_t			len;
+	uint32_t		offt;
+
+	if (str == NULL || str[0] == '\0')
+	{
+		fld->offt = 0;
+		fld->len = 0;
+		return;
+	}
+
+	len = strlen(str) + 1;
+
+	while (col->heap_len + len > col->heap_sz)
+	{
+		col->heap_sz *= 2;
+		if ((col->heap = realloc(col->heap, col->heap_sz)) == NULL)
+			err(EX_OSERR, "realloc(): %u", (unsigned)col->heap_sz);
+	}
+
+	offt = (uint32_t)col->heap_len;
+
+	memcpy(col->heap + offt, str, len);
+	col->heap_len += len;
+
+	fld->offt = offt;
+	fld->len = (uint32_t)(len - 1);
+}
+
+static int
+hdr_supported(const struct bin_hdr_t *hdr)
+{
+	return memcmp(hdr->magic, BIN_MAGIC, BIN_MAGIC_LEN) == 0 &&
+		hdr->version == BIN_VERSION &&
+		hdr->hdr_sz == sizeof(struct bin_hdr_t);
+}
+
+static void
+write_index(struct store_t *s)
+{
+	struct bin_new_t	*new = &s->new;
+	struct bin_hdr_t	hdr;
+	struct bin_col_t	*col;
+	struct bin_ord_t	*order;
+	char			*folds[PF_CNT];  /* NULL if equal to heap */
+	size_t			offt;
+	size_t			i;
+	int			f;
+	FILE			*fp;
+	const char		pad[4] = {0, 0, 0, 0};
+
+	/* normally ports are added ordered, but just to make sure */
+	order = (struct bin_ord_t *)xmalloc(new->ports_cnt *
+					    sizeof(struct bin_ord_t));
+	for (i = 0; i < new->ports_cnt; i++)
+	{
+		order[i].id = new->ids[i];
+		order[i].idx = i;
+	}
+	if (mergesort(order, new->ports_cnt, sizeof(struct bin_ord_t),
+		      sc_ids_cmp) == -1)
+		err(EX_OSERR, "mergesort()");
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, BIN_MAGIC, BIN_MAGIC_LEN);
+	hdr.version = BIN_VERSION;
+	hdr.hdr_sz = sizeof(struct bin_hdr_t);
+	hdr.ports_cnt = (uint32_t)new->ports_cnt;
+
+	offt = sizeof(struct bin_hdr_t);
+	hdr.ids_offt = (uint32_t)offt;
+	offt += new->ports_cnt * sizeof(uint32_t);
+
+	for (f = 0; f < PF_CNT; f++)
+	{
+		col = &hdr.cols[f];
+
+		col->strs_offt = (uint32_t)offt;
+		offt += new->ports_cnt * sizeof(struct port_str_t);
+
+		col->heap_offt = (uint32_t)offt;
+		col->heap_sz = (uint32_t)new->cols[f].heap_len;
+		offt += ALIGN4(new->cols[f].heap_len);
+
+		/* for case insensitive searches without REG_ICASE */
+		folds[f] = (char *)xmalloc(new->cols[f].heap_len);
+		m_fold(folds[f], new->cols[f].heap, new->cols[f].heap_len);
+
+		if (memcmp(folds[f], new->cols[f].heap,
+			   new->cols[f].heap_len) == 0)
+		{
+			xfree(folds[f]);
+			folds[f] = NULL;
+			col->fold_offt = col->heap_offt;
+		}
+		else
+		{
+			col->fold_offt = (uint32_t)offt;
+			offt += ALIGN4(new->cols[f].heap_len);
+		}
+
+		if (offt > UINT32_MAX)
+			errx(EX_SOFTWARE, "index file exceeds 4GB");
+	}
+
+	if ((fp = fopen(s->index_new_fn, "w")) == NULL)
+		err(EX_CANTCREAT, "fopen(): %s", s->index_new_fn);
+
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1)
+		err(EX_IOERR, "fwrite(): %s", s->index_new_fn);
+
+	for (i = 0; i < new->ports_cnt; i++)
+		if (fwrite(&order[i].id, sizeof(uint32_t), 1, fp) != 1)
+			err(EX_IOERR, "fwrite(): %s", s->index_new_fn);
+
+	for (f = 0; f < PF_CNT; f++)
+	{
+		for (i = 0; i < new->ports_cnt; i++)
+			if (fwrite(&new->cols[f].strs[order[i].idx],
+				   sizeof(struct port_str_t), 1, fp) != 1)
+				err(EX_IOERR, "fwrite(): %s", s->index_new_fn);
+
+		for (i = 0; i < 2; i++)
+		{
+			if (i == 1 && folds[f] == NULL)
+				break;
+
+			if (fwrite(i == 0 ? new->cols[f].heap : folds[f], 1,
+				   new->cols[f].heap_len, fp) !=
+			    new->cols[f].heap_len ||
+			    fwrite(pad, 1, ALIGN4(new->cols[f].heap_len) -
+				   new->cols[f].heap_len, fp) !=
+			    ALIGN4(new->cols[f].heap_len) -
+			    new->cols[f].heap_len)
+				err(EX_IOERR, "fwrite(): %s",
+				    s->index_new_fn);
+		}
+
+		xfree(folds[f]);
+	}
+
+	xfclose(fp, s->index_new_fn);
+
+	xfree(order);
+}
+
+/***/
+
+void
+s_read_start(struct store_t *s)
+{
+	set_filenames(s);
+
+	load_index(s);
+	/* mkdb compares the versions of the ports found by path */
+	load_cols(s, PF_BIT(PF_PATH) | PF_BIT(PF_PKGNAME));
+	sc_load_plist(&s->d, &s->plist);
+	sc_load_fprints(s->plist, &s->ports);
+
+	/* every port from INDEX is looked up by path while updating */
+	sc_index_paths(&s->ports, &s->by_path);
+	s->by_path_ok = 1;
+}
+
+void
+s_read_end(struct store_t *s)
+{
+	h_destroy(&s->by_path);
+	s->by_path_ok = 0;
+
+	sc_free_plist(s->plist);
+	free_index(s);
+}
+
+void
+s_search_start(struct store_t *s)
+{
+	set_filenames(s);
+
+	/* before loading, so that a replacement during it is noticed */
+	sc_get_stamp(&s->d, &s->stamp);
+
+	load_index(s);
+
+	/* created by filter_ports() only if needed */
+	s->by_path_ok = 0;
+}
+
+void
+s_search_end(struct store_t *s)
+{
+	if (s->by_path_ok)
+	{
+		h_destroy(&s->by_path);
+		s->by_path_ok = 0;
+	}
+
+	free_index(s);
+}
+
+void
+s_search_preload(struct store_t *s)
+{
+	load_cols(s, PF_ALL);
+}
+
+int
+s_search_stale(struct store_t *s)
+{
+	return sc_stamp_changed(&s->d, &s->stamp);
+}
+
+void
+filter_ports(struct store_t *s, const struct options_t *opts)
+{
+	load_cols(s, sc_crit_flds(opts) | sc_disp_flds(opts));
+
+	if ((opts->search_crit & SEARCH_BY_ORIGIN) && !s->by_path_ok)
+	{
+		sc_index_paths(&s->ports, &s->by_path);
+		s->by_path_ok = 1;
+	}
+
+	sc_filter_ports(&s->ports, &s->by_path, &s->d, opts);
+}
+
+int
+s_load_port_by_path(struct store_t *s, const char *path, size_t *idx)
+{
+	return sc_load_port_by_path(&s->ports, &s->by_path, path, idx);
+}
+
+void
+s_load_port_plist(struct store_t *s, struct port_t *port)
+{
+	sc_load_port_plist(s->plist, port);
+}
+
+/***/
+
+static void
+set_filenames(struct store_t *s)
+{
+	sc_set_dirs(&s->d);
+
+	snprintf(s->index_fn, sizeof(s->index_fn), "%s/index.bin", s->d.dir);
+	snprintf(s->index_new_fn, sizeof(s->index_new_fn), "%s/index.bin",
+		 s->d.newdir);
+	snprintf(s->index_old_fn, sizeof(s->index_old_fn), "%s/index.bin",
+		 s->d.olddir);
+}
+
+static void
+load_index(struct store_t *s)
+{
+	int			fd;
+	struct stat		sb;
+	const struct bin_hdr_t	*hdr;
+
+	if ((fd = open(s->index_fn, O_RDONLY)) == -1)
+		err(EX_NOINPUT, "open(): %s", s->index_fn);
+
+	if (fstat(fd, &sb) == -1)
+		err(EX_OSERR, "fstat(): %s", s->index_fn);
+
+	s->map_sz = sb.st_size;
+
+	if (s->map_sz < sizeof(struct bin_hdr_t))
+		errx(EX_DATAERR, "corrupted database: %s: file too short",
+		     s->index_fn);
+
+	if ((s->map = mmap(NULL, s->map_sz, PROT_READ, MAP_SHARED, fd, 0))
+	    == MAP_FAILED)
+		err(EX_OSERR, "mmap(): %s", s->index_fn);
+
+	close(fd);
+
+	hdr = (const struct bin_hdr_t *)s->map;
+
+	if (!hdr_supported(hdr))
+		errx(EX_DATAERR, "%s: unsupported database format, please "
+		     "recreate it using the -u option", s->index_fn);
+
+	if (hdr->ids_offt % 4 != 0 ||
+	    hdr->ids_offt + (size_t)hdr->ports_cnt * sizeof(uint32_t) >
+	    s->map_sz)
+		errx(EX_DATAERR, "corrupted database: %s: inconsistent sizes",
+		     s->index_fn);
+
+	sc_ports_start(&s->ports,
+		       (const uint32_t *)((const char *)s->map + hdr->ids_offt),
+		       hdr->ports_cnt);
+}
+
+static void
+load_cols(struct store_t *s, int flds)
+{
+	const struct bin_hdr_t	*hdr;
+	const struct bin_col_t	*col;
+	const struct port_str_t	*strs;
+	const char		*heap;
+	const char		*fold;
+	size_t			i;
+	int			f;
+
+	hdr = (const struct bin_hdr_t *)s->map;
+
+	for (f = 0; f < PF_CNT; f++)
+	{
+		if ((flds & PF_BIT(f)) == 0 || s->ports.cols[f].strs != NULL)
+			continue;
+
+		col = &hdr->cols[f];
+
+		if (col->strs_offt % 4 != 0 ||
+		    col->strs_offt + (size_t)hdr->ports_cnt *
+		    sizeof(struct port_str_t) > s->map_sz ||
+		    col->heap_sz == 0 ||
+		    (size_t)col->heap_offt + col->heap_sz > s->map_sz ||
+		    (size_t)col->fold_offt + col->heap_sz > s->map_sz)
+			errx(EX_DATAERR, "corrupted database: %s: "
+			     "inconsistent sizes", s->index_fn);
+
+		strs = (const struct port_str_t *)((const char *)s->map +
+						   col->strs_offt);
+		heap = (const char *)s->map + col->heap_offt;
+		fold = (const char *)s->map + col->fold_offt;
+
+		/* every string must be inside the heap and NUL terminated */
+		for (i = 0; i < hdr->ports_cnt; i++)
+			if (strs[i].offt >= col->heap_sz ||
+			    strs[i].len >= col->heap_sz - strs[i].offt ||
+			    heap[strs[i].offt + strs[i].len] != '\0' ||
+			    fold[strs[i].offt + strs[i].len] != '\0')
+				errx(EX_DATAERR, "corrupted database: %s: "
+				     "bad string for port id %u",
+				     s->index_fn, (unsigned)s->ports.ids[i]);
+
+		s->ports.cols[f].strs = strs;
+		s->ports.cols[f].heap = heap;
+		s->ports.cols[f].fold = fold;
+	}
+}
+
+static void
+free_index(struct store_t *s)
+{
+	sc_ports_end(&s->ports);
+
+	if (munmap(s->map, s->map_sz) == -1)
+		err(EX_OSERR, "munmap(): %s", s->index_fn);
+}
+
+/* EOF */
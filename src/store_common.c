@@ -0,0 +1,2088 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+
+#include <ctype.h>
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <regex.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include "display.h"
+#include "lineiter.h"
+#include "match.h"
+#include "parallel.h"
+#include "portdef.h"
+#include "sepscan.h"
+#include "store.h"
+#include "store_common.h"
+#include "trigram.h"
+#include "vector.h"
+#include "xlibc.h"
+
+/* lines of the meta file, "name=value" */
+#define META_PORTSDIR		"portsdir="
+#define META_PORTSDIR_LEN	9
+#define META_INDEXFILE		"indexfile="
+#define META_INDEXFILE_LEN	10
+#define META_MK			"mk="
+#define META_MK_LEN		3
+#define META_COMMIT		"commit="
+#define META_COMMIT_LEN		7
+
+/*
+ * The port id at the start of a plist file line is PLIST_ID_LEN bytes,
+ * 7 bits in each, most significant first, with the high bit set, so that
+ * it is never taken for a separator. Older stores have it in decimal.
+ */
+#define PLIST_ID_LEN	4
+#define PLIST_ID_MAX	((1U << (7 * PLIST_ID_LEN)) - 1)
+
+/* gather_pfiles argument */
+struct garg_t {
+	struct match_t	re;
+	struct ports_t	*ports;
+	const char	*map;  /* the mmap(2)ed plist file */
+	const char	*fmap;  /* its lowercased copy, NULL if not searched */
+	const char	*plist_fn;
+	int		should_have_matched;
+	unsigned	line_num;  /* of the last line seen, for diagnostics */
+	char		*buf;  /* copy of the current line, see gather_line() */
+	size_t		buf_sz;
+	size_t		lines_examined;  /* for --explain */
+};
+
+/* a matching plist line found by scan_chunk() */
+struct scan_match_t {
+	unsigned	portid;
+	size_t		pfile_offt;  /* in the plist file */
+	size_t		pfile_len;
+};
+
+/* a part of the plist file scanned by one thread */
+struct scan_chunk_t {
+	const char		*start;
+	const char		*end;  /* just after the last record separator */
+	struct scan_match_t	*matches;
+	size_t			matches_cnt;
+	size_t			matches_sz;  /* allocated elements in matches */
+	const char		*bad_line;  /* first corrupted line, if any */
+	size_t			lines_cnt;  /* lines examined */
+};
+
+/* scan_chunk() argument */
+struct scan_arg_t {
+	const char		*map;  /* the mmap(2)ed plist file */
+	struct scan_chunk_t	*chunks;
+	const char		*search_file;
+	int			regcomp_flags;
+};
+
+/* do not bother starting a thread for less than this many bytes */
+#define SCAN_CHUNK_MIN	(256 * 1024)
+
+/* a search criterion on the index fields */
+struct crit_def_t {
+	int		crit;  /* SEARCH_BY_* */
+	const char	*name;
+	int		flds;  /* PF_BIT()s of the fields it looks at */
+};
+
+static const struct crit_def_t	crit_defs[] = {
+	{SEARCH_BY_NAME, "name", PF_BIT(PF_PKGNAME)},
+	{SEARCH_BY_KEY, "key", PF_BIT(PF_PKGNAME) | PF_BIT(PF_COMMENT) |
+		PF_BIT(PF_FDEP) | PF_BIT(PF_EDEP) | PF_BIT(PF_PDEP) |
+		PF_BIT(PF_BDEP) | PF_BIT(PF_RDEP)},
+	{SEARCH_BY_PATH, "path", PF_BIT(PF_PATH)},
+	{SEARCH_BY_INFO, "info", PF_BIT(PF_COMMENT)},
+	{SEARCH_BY_MAINT, "maint", PF_BIT(PF_MAINT)},
+	{SEARCH_BY_CAT, "cat", PF_BIT(PF_CATEGORIES)},
+	{SEARCH_BY_FDEP, "fdep", PF_BIT(PF_FDEP)},
+	{SEARCH_BY_EDEP, "edep", PF_BIT(PF_EDEP)},
+	{SEARCH_BY_PDEP, "pdep", PF_BIT(PF_PDEP)},
+	{SEARCH_BY_BDEP, "bdep", PF_BIT(PF_BDEP)},
+	{SEARCH_BY_RDEP, "rdep", PF_BIT(PF_RDEP)},
+	{SEARCH_BY_DEP, "dep", PF_BIT(PF_BDEP) | PF_BIT(PF_RDEP)},
+	{SEARCH_BY_WWW, "www", PF_BIT(PF_WWW)}
+};
+
+#define CRITS_CNT	(sizeof(crit_defs) / sizeof(crit_defs[0]))
+
+/* the field shown by each DISP_* output field, up to DISP_WWW */
+static const int	disp_flds[] = {
+	0,  /* DISP_NONE */
+	PF_BIT(PF_PKGNAME),
+	PF_BIT(PF_PATH),
+	PF_BIT(PF_COMMENT),
+	PF_BIT(PF_MAINT),
+	PF_BIT(PF_CATEGORIES),
+	PF_BIT(PF_FDEP),
+	PF_BIT(PF_EDEP),
+	PF_BIT(PF_PDEP),
+	PF_BIT(PF_BDEP),
+	PF_BIT(PF_RDEP),
+	PF_BIT(PF_WWW)
+};
+
+/* a step of the plan, see make_plan() */
+struct step_t {
+	size_t		def;  /* index in crit_defs */
+	double		sel;  /* estimated fraction of ports that pass */
+	double		cost;  /* estimated cost of examining a port */
+	size_t		examined;  /* ports examined */
+	size_t		passed;  /* ports that passed */
+};
+
+/*
+ * Planner estimates, see make_plan() and estimate_sel().  These are
+ * rough guesses about the INDEX rather than statistics gathered from it,
+ * they only need to put the cheap and selective criteria first.
+ *
+ * An exact value (^foo$) names about one port, maintainer or category
+ * of the ~30000 in the tree, so it passes well under 0.1% of the ports;
+ * SEL_MIN is also the floor for the other estimates, otherwise long
+ * literals would all rank the same.
+ *
+ * Each literal character of an anchored pattern (^foo, foo$, (^|/)foo$)
+ * roughly halves the ports that pass.  An unanchored substring may occur
+ * at any of the positions of a field, so a character narrows it less.
+ *
+ * Nothing is known about what a regular expression passes.  regexec(3)
+ * takes 3 to 10 times as long as the literal matcher for a field (more
+ * with REG_ICASE), timed with glibc for short INDEX fields.
+ */
+#define SEL_MIN			0.001
+#define SEL_EXACT		SEL_MIN
+#define SEL_CHAR_ANCHORED	0.5
+#define SEL_CHAR_SUBSTR		0.7
+#define SEL_REGEX		0.5
+#define COST_REGEX		10
+
+/* the criteria in the order they are evaluated */
+struct plan_t {
+	struct step_t	steps[CRITS_CNT];
+	size_t		steps_cnt;
+};
+
+/* compiled patterns for the index fields, indexed like crit_defs */
+struct fre_t {
+	struct match_t	re[CRITS_CNT];
+	int		folded[CRITS_CNT];  /* re is for the lowercased fields */
+};
+
+/* filter_slice() argument */
+struct farg_t {
+	const struct options_t	*opts;
+	struct ports_t		*ports;
+	size_t			origin_idx;  /* of the port given by -O */
+	int			origin_found;
+	const struct plan_t	*plan;
+	size_t			slices_cnt;
+	struct fre_t		*fres;  /* slices_cnt elements */
+	/* per slice counters, slices_cnt * CRITS_CNT elements */
+	size_t			*examined;
+	size_t			*passed;
+};
+
+/* do not bother starting a thread for less than this many ports */
+#define FILTER_SLICE_MIN	2048
+
+/*
+ * Get the pattern given in `opts' for crit_defs[def]
+ */
+static const char *crit_pattern(const struct options_t *opts, size_t def);
+
+/*
+ * Check whether the port at index `i' in `ports' matches `re' for
+ * crit_defs[def], in the lowercased fields if `folded' is nonzero
+ */
+static int crit_match(const struct match_t *re, int folded, size_t def,
+		      const struct ports_t *ports, size_t i);
+
+/*
+ * Return the number of fields in the PF_BIT()s `flds'
+ */
+static unsigned flds_cnt(int flds);
+
+/*
+ * Compile the patterns for the index fields given in `opts'. If `cflags'
+ * contains REG_ICASE and the fields of a criterion have lowercased copies
+ * in `ports', then its pattern is lowercased instead.
+ */
+static void fre_comp(struct fre_t *fre, const struct options_t *opts,
+		     int cflags, const struct ports_t *ports);
+
+/*
+ * Free data allocated by fre_comp()
+ */
+static void fre_free(struct fre_t *fre, const struct options_t *opts);
+
+/*
+ * Order the criteria given in `opts' so that the ones that are cheap and
+ * fail for most ports are evaluated first, `fre' holds their patterns
+ */
+static void make_plan(struct plan_t *plan, const struct fre_t *fre,
+		      const struct options_t *opts);
+
+/*
+ * Estimate which fraction of the ports' fields match `re'
+ */
+static double estimate_sel(const struct match_t *re);
+
+/*
+ * Compare 2 steps according to their rank, cheap and selective first
+ */
+static int steps_cmp(const void *s1v, const void *s2v);
+
+/*
+ * Match slice number `slice' of the ports in `arg_void', a struct farg_t,
+ * against the index field criteria in the order given by the plan,
+ * giving up on a port at its first failed criterion. Runs in its own
+ * thread and only touches the ports and the counters of its slice.
+ */
+static void filter_slice(size_t slice, void *arg_void);
+
+/*
+ * Add SEARCH_BY_PFILE to `matched' member of all ports that have
+ * `search_file' in their plist. If `should_have_matched' is nonzero than
+ * skip all ports that have `matched' member equal to zero.
+ */
+static void filter_ports_by_pfile(struct ports_t *ports,
+				  const struct sc_dirs_t *d,
+				  int should_have_matched,
+				  const char *search_file, int regcomp_flags,
+				  int explain);
+
+/*
+ * Count the plist lines of the ports that have `matched' member equal
+ * to `should_have_matched' and whose summaries may contain all trigram
+ * `keys', the number of ports ruled out by their summaries is stored in
+ * `ruled_out'
+ */
+static size_t matched_lines(const struct ports_t *ports,
+			    const struct px_t *px, int should_have_matched,
+			    const uint32_t *keys, size_t keys_cnt,
+			    size_t *ruled_out);
+
+/*
+ * Call gather_pfiles() for the lines of the ports that have `matched'
+ * member equal to `garg->should_have_matched' only, skipping those whose
+ * summaries lack some of the trigram `keys', `map' is the mmap(2)ed
+ * plist file
+ */
+static void gather_ports(const char *map, const struct px_t *px,
+			 const uint32_t *keys, size_t keys_cnt,
+			 struct garg_t *garg);
+
+/*
+ * Call gather_pfiles() for the given `lines' of the plist file only,
+ * `map' is the mmap(2)ed plist file
+ * (Here and below `map' may also be the lowercased copy of the plist
+ * file, garg->fmap, the offsets are the same.)
+ */
+static void gather_lines(const char *map, const struct tri_t *tri,
+			 const uint32_t *lines, size_t lines_cnt,
+			 struct garg_t *garg);
+
+/*
+ * Call gather_pfiles() for a copy of line number `line_num' (counting
+ * from 0) which starts at `line' and is `len' bytes long
+ */
+static void gather_line(const char *line, size_t len, uint32_t line_num,
+			struct garg_t *garg);
+
+/*
+ * Call gather_pfiles() for all lines of the plist file, `map' is the
+ * mmap(2)ed plist file which is `map_sz' bytes long. The file is split
+ * into chunks that are searched in parallel, the matches are then added
+ * to the ports in file order.
+ */
+static void scan_plist(const char *map, size_t map_sz,
+		       const char *search_file, int regcomp_flags,
+		       struct garg_t *garg);
+
+/*
+ * Search chunk `i' of `arg_void', a struct scan_arg_t, runs in its own
+ * thread and only touches its own chunk
+ */
+static void scan_chunk(size_t i, void *arg_void);
+
+/*
+ * Add `pfile' to the plist of port `portid', if it is wanted
+ */
+static void add_pfile(struct garg_t *arg, unsigned portid, const char *pfile);
+
+/*
+ * Place plist file from `line', which is `len' bytes long, in the
+ * appropriate `plist' member of the `arg->ports' structure if it matches
+ * `arg->re'. `line' is a writable copy of `orig' from the plist file or
+ * of the same line lowercased.
+ */
+static void gather_pfiles(char *line, size_t len, const char *orig,
+			  struct garg_t *arg);
+
+/*
+ * mmap(2) the lowercased copy of the plist file if it exists and has the
+ * same size `sz' as the plist file, store it in `fmap'
+ * Return 0 on success and -1 otherwise
+ */
+static int map_fold(const struct sc_dirs_t *d, size_t sz, char **fmap);
+
+/*
+ * Store the port id of plist file line `line', which is `len' bytes
+ * long, in `portid', either binary or decimal
+ * Return a pointer to the field separator after the id, NULL if the line
+ * is corrupted
+ */
+static const char *split_pline(const char *line, size_t len,
+			       unsigned *portid);
+
+/*
+ * Retrieve the index of a port by its id, exit if port is not found
+ */
+static size_t get_port_by_id(const struct ports_t *ports, unsigned portid);
+
+/*
+ * Compare 2 plist lines, according to their portids
+ */
+static int plines_cmp(const void *l1v, const void *l2v);
+
+/*
+ * Remove old database directory
+ */
+static void rm_olddir(const struct sc_dirs_t *d, const char *const *oldfiles);
+
+/***/
+
+void
+sc_set_dirs(struct sc_dirs_t *d)
+{
+	struct utsname	un;
+	/* number of characters to pick from the start of un.release */
+	int		release_chars;
+
+	if (uname(&un) == -1)
+		err(EX_OSERR, "uname()");
+
+	/* un.release is something like "10.1-BETA3", pick up "10" from it. */
+	release_chars = 0;
+	while (isdigit(un.release[release_chars])) {
+		release_chars++;
+	}
+
+	/* If un.release contains something unexpected, then pick it all. */
+	if (release_chars == 0) {
+		release_chars = strlen(un.release);
+	}
+
+	snprintf(d->dir, sizeof(d->dir), "%s/%.*s-%s",
+		 DBDIR, release_chars, un.release, un.machine);
+
+	snprintf(d->newdir, sizeof(d->newdir), "%s.new", d->dir);
+	snprintf(d->olddir, sizeof(d->olddir), "%s.old", d->dir);
+
+	snprintf(d->plist_fn, sizeof(d->plist_fn), "%s/plist", d->dir);
+	snprintf(d->plist_new_fn, sizeof(d->plist_new_fn), "%s/plist", d->newdir);
+	snprintf(d->plist_old_fn, sizeof(d->plist_old_fn), "%s/plist", d->olddir);
+
+	snprintf(d->fold_fn, sizeof(d->fold_fn), "%s/plist.fold", d->dir);
+	snprintf(d->fold_new_fn, sizeof(d->fold_new_fn), "%s/plist.fold",
+		 d->newdir);
+	snprintf(d->fold_old_fn, sizeof(d->fold_old_fn), "%s/plist.fold",
+		 d->olddir);
+
+	snprintf(d->tri_fn, sizeof(d->tri_fn), "%s/plist.tri", d->dir);
+	snprintf(d->tri_new_fn, sizeof(d->tri_new_fn), "%s/plist.tri", d->newdir);
+	snprintf(d->tri_old_fn, sizeof(d->tri_old_fn), "%s/plist.tri", d->olddir);
+
+	snprintf(d->px_fn, sizeof(d->px_fn), "%s/plist.idx", d->dir);
+	snprintf(d->px_new_fn, sizeof(d->px_new_fn), "%s/plist.idx", d->newdir);
+	snprintf(d->px_old_fn, sizeof(d->px_old_fn), "%s/plist.idx", d->olddir);
+
+	snprintf(d->meta_fn, sizeof(d->meta_fn), "%s/meta", d->dir);
+	snprintf(d->meta_new_fn, sizeof(d->meta_new_fn), "%s/meta", d->newdir);
+	snprintf(d->meta_old_fn, sizeof(d->meta_old_fn), "%s/meta", d->olddir);
+}
+
+void
+sc_mkdirs(const struct sc_dirs_t *d)
+{
+	const char	*mkdirs[] = {DBDIR, d->newdir};
+	int		i;
+
+	for (i = 0; i < sizeof(mkdirs) / sizeof(const char *); i++)
+		if (mkdir(mkdirs[i], 0755) == -1)
+			if (errno != EEXIST)
+				err(EX_CANTCREAT, "mkdir(): %s", mkdirs[i]);
+}
+
+void
+sc_replace_dir(const struct sc_dirs_t *d, const char *const *oldfiles)
+{
+	rm_olddir(d, oldfiles);
+
+	/* move current db out of the way */
+	if (rename(d->dir, d->olddir) == -1)
+		if (errno != ENOENT)
+			err(EX_CANTCREAT, "rename(): %s to %s", d->dir, d->olddir);
+
+	/* make new db current */
+	if (rename(d->newdir, d->dir) == -1)
+		err(EX_CANTCREAT, "rename(): %s to %s", d->newdir, d->dir);
+
+	rm_olddir(d, oldfiles);
+}
+
+static void
+rm_olddir(const struct sc_dirs_t *d, const char *const *oldfiles)
+{
+	const char		*common[] = {d->plist_old_fn, d->fold_old_fn,
+		d->tri_old_fn, d->px_old_fn, d->meta_old_fn, NULL};
+	const char *const	*lists[] = {common, oldfiles};
+	const char *const	*ent;
+	int			i;
+
+	for (i = 0; i < sizeof(lists) / sizeof(lists[0]); i++)
+		for (ent = lists[i]; *ent != NULL; ent++)
+			if (unlink(*ent) == -1)
+				if (errno != ENOENT)
+					err(EX_UNAVAILABLE, "unlink(): %s", *ent);
+
+	if (rmdir(d->olddir) == -1)
+		if (errno != ENOENT)
+			err(EX_UNAVAILABLE, "rmdir(): %s", d->olddir);
+}
+
+void
+sc_get_stamp(const struct sc_dirs_t *d, struct sc_stamp_t *st)
+{
+	struct stat	sb;
+
+	if (stat(d->dir, &sb) == -1)
+	{
+		/* between the two renames in sc_replace_dir() */
+		st->dev = 0;
+		st->ino = 0;
+		return;
+	}
+
+	st->dev = sb.st_dev;
+	st->ino = sb.st_ino;
+}
+
+int
+sc_stamp_changed(const struct sc_dirs_t *d, const struct sc_stamp_t *st)
+{
+	struct sc_stamp_t	cur;
+
+	sc_get_stamp(d, &cur);
+
+	return cur.dev != st->dev || cur.ino != st->ino;
+}
+
+size_t
+sc_load_file(const char *filename, char **raw)
+{
+	int		fd;
+	struct stat	sb;
+	size_t		sz;
+	size_t		offt;
+	ssize_t		rd_len;
+
+	if ((fd = open(filename, O_RDONLY)) == -1)
+		err(EX_NOINPUT, "open(): %s", filename);
+
+	if (fstat(fd, &sb) == -1)
+		err(EX_OSERR, "fstat(): %s", filename);
+
+	sz = sb.st_size;
+
+	*raw = (char *)xmalloc(sz + 1);
+
+	offt = 0;
+
+	while ((rd_len = read(fd, *raw, sz - offt)) <= sz - offt)
+	{
+		if (rd_len == -1)
+			err(EX_IOERR, "read(): %s", filename);
+
+		if (rd_len == 0)
+			break;
+
+		offt += rd_len;
+	}
+
+	if (sz != offt)
+		errx(EX_PROTOCOL, "while reading %s: fstat returned %u bytes "
+		     "for file size but we got %u from it",
+		     filename, (unsigned)sz, (unsigned)offt);
+
+	(*raw)[sz] = '\0';
+
+	close(fd);
+
+	return sz;
+}
+
+void
+sc_free_file(char *raw)
+{
+	xfree(raw);
+}
+
+int
+sc_ids_cmp(const void *id1v, const void *id2v)
+{
+	uint32_t	id1 = *(const uint32_t *)id1v;
+	uint32_t	id2 = *(const uint32_t *)id2v;
+
+	if (id1 < id2)
+		return -1;
+	if (id1 > id2)
+		return 1;
+	return 0;
+}
+
+void
+sc_ports_start(struct ports_t *ports, const uint32_t *ids, size_t sz)
+{
+	int	f;
+
+	ports->ids = ids;
+	ports->sz = sz;
+
+	for (f = 0; f < PF_CNT; f++)
+	{
+		ports->cols[f].strs = NULL;
+		ports->cols[f].heap = NULL;
+		ports->cols[f].fold = NULL;
+	}
+
+	ports->matched = (int *)xmalloc(sz * sizeof(int));
+	memset(ports->matched, 0, sz * sizeof(int));
+
+	ports->fprints = NULL;
+	ports->fdeps = NULL;
+	ports->plists = NULL;
+}
+
+void
+sc_ports_end(struct ports_t *ports)
+{
+	size_t	i;
+
+	if (ports->plists != NULL)
+	{
+		for (i = 0; i < ports->sz; i++)
+			if (ports->matched[i] & SEARCH_BY_PFILE)
+				v_destroy(&ports->plists[i]);
+		xfree(ports->plists);
+	}
+
+	if (ports->fprints != NULL)
+	{
+		xfree(ports->fprints);
+		xfree(ports->fdeps);
+	}
+
+	xfree(ports->matched);
+}
+
+int
+sc_crit_flds(const struct options_t *opts)
+{
+	int	flds;
+	size_t	def;
+
+	flds = 0;
+
+	if (opts->search_crit & SEARCH_BY_ORIGIN)
+		flds |= PF_BIT(PF_PATH);
+
+	for (def = 0; def < CRITS_CNT; def++)
+		if (opts->search_crit & crit_defs[def].crit)
+			flds |= crit_defs[def].flds;
+
+	return flds;
+}
+
+int
+sc_disp_flds(const struct options_t *opts)
+{
+	int	flds;
+	int	i;
+
+	flds = 0;
+
+	for (i = 0; i < DISP_FLDS_CNT; i++)
+		if (opts->outflds_parsed[i] > DISP_NONE &&
+		    opts->outflds_parsed[i] <= DISP_WWW)
+			flds |= disp_flds[opts->outflds_parsed[i]];
+		/* the files may be prefixed with the port's path */
+		else if (opts->outflds_parsed[i] == DISP_RAWFILES)
+			flds |= PF_BIT(PF_PATH);
+
+	return flds;
+}
+
+void
+sc_new_start(struct sc_new_t *n, const struct sc_dirs_t *d)
+{
+	if ((n->plist_fp = fopen(d->plist_new_fn, "w")) == NULL)
+		err(EX_CANTCREAT, "fopen(): %s", d->plist_new_fn);
+
+	if ((n->fold_fp = fopen(d->fold_new_fn, "w")) == NULL)
+		err(EX_CANTCREAT, "fopen(): %s", d->fold_new_fn);
+
+	n->fold_buf_sz = BUFSIZ;
+	n->fold_buf = (char *)xmalloc(n->fold_buf_sz);
+
+	n->keys_sz = BUFSIZ;
+	n->keys = (uint32_t *)xmalloc(n->keys_sz * sizeof(uint32_t));
+
+	n->plist_offt = 0;
+	n->plist_lines = 0;
+	n->ports_cnt = 0;
+
+	tri_new_start(&n->tri);
+	px_new_start(&n->px);
+
+	n->meta_ok = 0;
+}
+
+void
+sc_new_add_port(struct sc_new_t *n, const struct sc_dirs_t *d,
+		const struct port_t *port)
+{
+	struct vector_iterator_t	vi;
+	struct px_block_t		b;
+	char				*file;
+	char				id[PLIST_ID_LEN];
+	int				len;
+	int				i;
+	size_t				file_len;
+	size_t				keys_cnt;
+
+	/* the readers find a port by its id at index id - 1 */
+	if (port->id != n->ports_cnt + 1 || port->id > PLIST_ID_MAX)
+		errx(EX_SOFTWARE, "port %s has id %u, expected %u",
+		     port->path, port->id, (unsigned)n->ports_cnt + 1);
+
+	n->ports_cnt++;
+
+	for (i = 0; i < PLIST_ID_LEN; i++)
+		id[i] = (char)(0x80 |
+			       (port->id >> (7 * (PLIST_ID_LEN - 1 - i)) & 0x7f));
+
+	b.offt = n->plist_offt;
+	b.first_line = (uint32_t)n->plist_lines;
+
+	keys_cnt = 0;
+
+	vi_reset(&vi, &port->plist);
+
+	while (vi_next(&vi, (void **)&file))
+	{
+		tri_new_add(n->tri, file, n->plist_offt);
+
+		if (fwrite(id, 1, PLIST_ID_LEN, n->plist_fp) != PLIST_ID_LEN ||
+		    (len = fprintf(n->plist_fp,
+				   "%c""%s%c",
+				   FSp,
+				   file, RSp)) == -1)
+			err(EX_IOERR, "fprintf(): %s", d->plist_new_fn);
+
+		/* the same line lowercased, at the same offset */
+		file_len = strlen(file);
+		if (file_len > n->fold_buf_sz)
+		{
+			n->fold_buf_sz = file_len;
+			xfree(n->fold_buf);
+			n->fold_buf = (char *)xmalloc(n->fold_buf_sz);
+		}
+
+		m_fold(n->fold_buf, file, file_len);
+
+		/* the summary of the port, see px_new_bloom() */
+		if (keys_cnt + file_len > n->keys_sz)
+		{
+			while (keys_cnt + file_len > n->keys_sz)
+				n->keys_sz *= 2;
+			if ((n->keys = realloc(n->keys, n->keys_sz *
+					       sizeof(uint32_t))) == NULL)
+				err(EX_OSERR, "realloc(): %u",
+				    (unsigned)(n->keys_sz * sizeof(uint32_t)));
+		}
+
+		keys_cnt += tri_str_keys(n->fold_buf, file_len,
+					 n->keys + keys_cnt);
+
+		if (fwrite(id, 1, PLIST_ID_LEN, n->fold_fp) != PLIST_ID_LEN ||
+		    putc(FSp, n->fold_fp) == EOF ||
+		    fwrite(n->fold_buf, 1, file_len, n->fold_fp) != file_len ||
+		    putc(RSp, n->fold_fp) == EOF)
+			err(EX_IOERR, "fwrite(): %s", d->fold_new_fn);
+
+		n->plist_offt += PLIST_ID_LEN + len;
+		n->plist_lines++;
+	}
+
+	b.len = n->plist_offt - b.offt;
+	b.lines_cnt = (uint32_t)(n->plist_lines - b.first_line);
+
+	if (b.lines_cnt > 0)
+	{
+		px_new_add(n->px, port->id, &b);
+		px_new_bloom(n->px, port->id, n->keys, keys_cnt);
+	}
+
+	if (port->fprint != 0)
+		px_new_fprint(n->px, port->id, port->fprint);
+
+	if (port->fdeps != NULL)
+		px_new_fdeps(n->px, port->id, port->fdeps);
+}
+
+void
+sc_new_meta(struct sc_new_t *n, const struct store_meta_t *meta)
+{
+	n->meta = *meta;
+	n->meta_ok = 1;
+}
+
+void
+sc_new_end(struct sc_new_t *n, const struct sc_dirs_t *d)
+{
+	FILE	*fp;
+
+	xfclose(n->plist_fp, d->plist_new_fn);
+	xfclose(n->fold_fp, d->fold_new_fn);
+
+	xfree(n->fold_buf);
+	xfree(n->keys);
+
+	tri_new_end(n->tri, n->plist_offt, d->tri_new_fn);
+	px_new_end(n->px, n->plist_offt, d->px_new_fn);
+
+	if (!n->meta_ok)
+		return;
+
+	fp = xfopen(d->meta_new_fn, "w");
+
+	if (fprintf(fp, META_PORTSDIR "%s\n" META_INDEXFILE "%s\n"
+		    META_MK "%llx\n" META_COMMIT "%s\n",
+		    n->meta.portsdir, n->meta.indexfile,
+		    (unsigned long long)n->meta.mk_fprint,
+		    n->meta.commit) == -1)
+		err(EX_IOERR, "fprintf(): %s", d->meta_new_fn);
+
+	xfclose(fp, d->meta_new_fn);
+}
+
+int
+sc_read_meta(const struct sc_dirs_t *d, struct store_meta_t *meta)
+{
+	FILE	*fp;
+	char	line[PATH_MAX + 32];
+	char	*nl;
+	int	found;
+
+	if ((fp = fopen(d->meta_fn, "r")) == NULL)
+	{
+		if (errno == ENOENT)
+			return 0;
+		err(EX_NOINPUT, "fopen(): %s", d->meta_fn);
+	}
+
+	found = 0;
+	meta->mk_fprint = 0;
+	meta->commit[0] = '\0';
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		if ((nl = strchr(line, '\n')) != NULL)
+			*nl = '\0';
+
+		if (strncmp(line, META_PORTSDIR, META_PORTSDIR_LEN) == 0)
+		{
+			snprintf(meta->portsdir, sizeof(meta->portsdir), "%s",
+				 line + META_PORTSDIR_LEN);
+			found |= 1;
+		}
+		else if (strncmp(line, META_INDEXFILE, META_INDEXFILE_LEN) == 0)
+		{
+			snprintf(meta->indexfile, sizeof(meta->indexfile), "%s",
+				 line + META_INDEXFILE_LEN);
+			found |= 2;
+		}
+		else if (strncmp(line, META_MK, META_MK_LEN) == 0)
+			meta->mk_fprint = strtoull(line + META_MK_LEN, NULL, 16);
+		else if (strncmp(line, META_COMMIT, META_COMMIT_LEN) == 0)
+			snprintf(meta->commit, sizeof(meta->commit), "%s",
+				 line + META_COMMIT_LEN);
+		/* ignore what newer versions may have added */
+	}
+
+	xfclose(fp, d->meta_fn);
+
+	return found == 3;
+}
+
+/***/
+
+void
+sc_filter_ports(struct ports_t *ports, const struct hash_t *by_path,
+		const struct sc_dirs_t *d, const struct options_t *opts)
+{
+	struct farg_t	fa;
+	struct plan_t	plan;
+	struct step_t	*step;
+	int		regcomp_flags_fields;
+	int		regcomp_flags_pfiles;
+	size_t		i, k;
+
+	regcomp_flags_fields = REG_EXTENDED | REG_NOSUB;
+	regcomp_flags_pfiles = REG_EXTENDED | REG_NOSUB;
+
+	if (opts->icase_fields)
+		regcomp_flags_fields |= REG_ICASE;
+	if (opts->icase_pfiles)
+		regcomp_flags_pfiles |= REG_ICASE;
+
+	fa.opts = opts;
+	fa.ports = ports;
+	fa.plan = &plan;
+
+	fa.origin_found = 0;
+	if (opts->search_crit & SEARCH_BY_ORIGIN)
+		fa.origin_found = sc_load_port_by_path(ports, by_path,
+						       opts->search_origin,
+						       &fa.origin_idx) == 0;
+
+	fa.slices_cnt = par_ncpus();
+	if (fa.slices_cnt > ports->sz / FILTER_SLICE_MIN)
+		fa.slices_cnt = ports->sz / FILTER_SLICE_MIN;
+	if (fa.slices_cnt == 0)
+		fa.slices_cnt = 1;
+
+	/*
+	 * Compile the patterns here rather than in the threads, so that an
+	 * invalid one is reported once
+	 */
+	fa.fres = (struct fre_t *)xmalloc(fa.slices_cnt * sizeof(struct fre_t));
+	for (i = 0; i < fa.slices_cnt; i++)
+		fre_comp(&fa.fres[i], opts, regcomp_flags_fields, ports);
+
+	make_plan(&plan, &fa.fres[0], opts);
+
+	fa.examined = (size_t *)xmalloc(fa.slices_cnt * CRITS_CNT *
+					sizeof(size_t));
+	fa.passed = (size_t *)xmalloc(fa.slices_cnt * CRITS_CNT *
+				      sizeof(size_t));
+	memset(fa.examined, 0, fa.slices_cnt * CRITS_CNT * sizeof(size_t));
+	memset(fa.passed, 0, fa.slices_cnt * CRITS_CNT * sizeof(size_t));
+
+	par_run(fa.slices_cnt, filter_slice, &fa);
+
+	for (k = 0; k < plan.steps_cnt; k++)
+		for (i = 0; i < fa.slices_cnt; i++)
+		{
+			plan.steps[k].examined += fa.examined[i * CRITS_CNT + k];
+			plan.steps[k].passed += fa.passed[i * CRITS_CNT + k];
+		}
+
+	if (opts->explain)
+	{
+		fprintf(stderr, "plan: %lu ports, %lu thread(s)\n",
+			(unsigned long)ports->sz, (unsigned long)fa.slices_cnt);
+
+		if (opts->search_crit & SEARCH_BY_ORIGIN)
+			fprintf(stderr, "  origin  hash lookup: %s\n",
+				fa.origin_found ? "found" : "not found");
+
+		for (k = 0; k < plan.steps_cnt; k++)
+		{
+			step = &plan.steps[k];
+			fprintf(stderr, "  %-6s  %s, %u field(s), "
+				"estimated selectivity %.3f, cost %.0f: "
+				"examined %lu, passed %lu\n",
+				crit_defs[step->def].name,
+				m_kind_name(&fa.fres[0].re[step->def]),
+				flds_cnt(crit_defs[step->def].flds),
+				step->sel, step->cost,
+				(unsigned long)step->examined,
+				(unsigned long)step->passed);
+		}
+	}
+
+	for (i = 0; i < fa.slices_cnt; i++)
+		fre_free(&fa.fres[i], opts);
+	xfree(fa.fres);
+	xfree(fa.examined);
+	xfree(fa.passed);
+
+	/*
+	 * Optimization:
+	 * Call filter_ports_by_pfile() after other filtering because it
+	 * loads plists only for ports that have been matched by other
+	 * search criteria (if any). Thus we avoid loading plists for all
+	 * ports in the case of ``-p ports-mgmt/portseach -f .*'' for example.
+	 */
+	if (opts->search_crit & SEARCH_BY_PFILE)
+		filter_ports_by_pfile(ports, d,
+				      opts->search_crit & ~SEARCH_BY_PFILE,
+				      opts->search_file, regcomp_flags_pfiles,
+				      opts->explain);
+}
+
+static const char *
+crit_pattern(const struct options_t *opts, size_t def)
+{
+	switch (crit_defs[def].crit)
+	{
+	case SEARCH_BY_NAME:
+		return opts->search_name;
+	case SEARCH_BY_KEY:
+		return opts->search_key;
+	case SEARCH_BY_PATH:
+		return opts->search_path;
+	case SEARCH_BY_INFO:
+		return opts->search_info;
+	case SEARCH_BY_MAINT:
+		return opts->search_maint;
+	case SEARCH_BY_CAT:
+		return opts->search_cat;
+	case SEARCH_BY_FDEP:
+		return opts->search_fdep;
+	case SEARCH_BY_EDEP:
+		return opts->search_edep;
+	case SEARCH_BY_PDEP:
+		return opts->search_pdep;
+	case SEARCH_BY_BDEP:
+		return opts->search_bdep;
+	case SEARCH_BY_RDEP:
+		return opts->search_rdep;
+	case SEARCH_BY_DEP:
+		return opts->search_dep;
+	case SEARCH_BY_WWW:
+		return opts->search_www;
+	}
+
+	return NULL;
+}
+
+#define MATCH_FLD(f)	\
+	m_match(re, folded ? PORT_FLD_FOLD(ports, i, f) :	\
+		PORT_FLD(ports, i, f), PORT_FLD_LEN(ports, i, f))
+
+static int
+crit_match(const struct match_t *re, int folded, size_t def,
+	   const struct ports_t *ports, size_t i)
+{
+	switch (crit_defs[def].crit)
+	{
+	case SEARCH_BY_NAME:
+		return MATCH_FLD(PF_PKGNAME);
+	case SEARCH_BY_KEY:
+		return MATCH_FLD(PF_PKGNAME) || MATCH_FLD(PF_COMMENT) ||
+			MATCH_FLD(PF_FDEP) || MATCH_FLD(PF_EDEP) ||
+			MATCH_FLD(PF_PDEP) || MATCH_FLD(PF_BDEP) ||
+			MATCH_FLD(PF_RDEP);
+	case SEARCH_BY_PATH:
+		return MATCH_FLD(PF_PATH);
+	case SEARCH_BY_INFO:
+		return MATCH_FLD(PF_COMMENT);
+	case SEARCH_BY_MAINT:
+		return MATCH_FLD(PF_MAINT);
+	case SEARCH_BY_CAT:
+		return MATCH_FLD(PF_CATEGORIES);
+	case SEARCH_BY_FDEP:
+		return MATCH_FLD(PF_FDEP);
+	case SEARCH_BY_EDEP:
+		return MATCH_FLD(PF_EDEP);
+	case SEARCH_BY_PDEP:
+		return MATCH_FLD(PF_PDEP);
+	case SEARCH_BY_BDEP:
+		return MATCH_FLD(PF_BDEP);
+	case SEARCH_BY_RDEP:
+		return MATCH_FLD(PF_RDEP);
+	case SEARCH_BY_DEP:
+		return MATCH_FLD(PF_BDEP) || MATCH_FLD(PF_RDEP);
+	case SEARCH_BY_WWW:
+		return MATCH_FLD(PF_WWW);
+	}
+
+	return 0;
+}
+
+#undef MATCH_FLD
+
+static unsigned
+flds_cnt(int flds)
+{
+	unsigned	cnt;
+	int		f;
+
+	cnt = 0;
+	for (f = 0; f < PF_CNT; f++)
+		if (flds & PF_BIT(f))
+			cnt++;
+
+	return cnt;
+}
+
+static void
+fre_comp(struct fre_t *fre, const struct options_t *opts, int cflags,
+	 const struct ports_t *ports)
+{
+	char	*folded;
+	size_t	def;
+	int	f;
+
+	for (def = 0; def < CRITS_CNT; def++)
+	{
+		if ((opts->search_crit & crit_defs[def].crit) == 0)
+			continue;
+
+		folded = NULL;
+		if (cflags & REG_ICASE)
+		{
+			for (f = 0; f < PF_CNT; f++)
+				if ((crit_defs[def].flds & PF_BIT(f)) &&
+				    ports->cols[f].fold == NULL)
+					break;
+
+			if (f == PF_CNT)
+				folded = m_fold_pattern(crit_pattern(opts,
+								     def));
+		}
+
+		/*
+		 * Optimization:
+		 * A lowercased pattern on the lowercased fields needs no
+		 * REG_ICASE, which is slow in the regex engine.
+		 */
+		if (folded != NULL)
+		{
+			m_comp(&fre->re[def], folded, cflags & ~REG_ICASE);
+			xfree(folded);
+			fre->folded[def] = 1;
+		}
+		else
+		{
+			m_comp(&fre->re[def], crit_pattern(opts, def), cflags);
+			fre->folded[def] = 0;
+		}
+	}
+}
+
+static void
+fre_free(struct fre_t *fre, const struct options_t *opts)
+{
+	size_t	def;
+
+	for (def = 0; def < CRITS_CNT; def++)
+		if (opts->search_crit & crit_defs[def].crit)
+			m_free(&fre->re[def]);
+}
+
+static void
+make_plan(struct plan_t *plan, const struct fre_t *fre,
+	  const struct options_t *opts)
+{
+	struct step_t	*step;
+	size_t		def;
+
+	plan->steps_cnt = 0;
+
+	for (def = 0; def < CRITS_CNT; def++)
+	{
+		if ((opts->search_crit & crit_defs[def].crit) == 0)
+			continue;
+
+		step = &plan->steps[plan->steps_cnt++];
+
+		step->def = def;
+		step->sel = estimate_sel(&fre->re[def]);
+		step->cost = flds_cnt(crit_defs[def].flds) *
+			(fre->re[def].kind == M_REGEX ? COST_REGEX : 1);
+		step->examined = 0;
+		step->passed = 0;
+	}
+
+	/* keep the order of crit_defs for equal ranks */
+	if (mergesort(plan->steps, plan->steps_cnt, sizeof(struct step_t),
+		      steps_cmp) == -1)
+		err(EX_OSERR, "mergesort()");
+}
+
+static double
+estimate_sel(const struct match_t *re)
+{
+	double	sel, per_char;
+	size_t	i;
+
+	switch (re->kind)
+	{
+	case M_EXACT:
+		return SEL_EXACT;
+	case M_PREFIX:
+	case M_SUFFIX:
+	case M_BASENAME:
+		per_char = SEL_CHAR_ANCHORED;
+		break;
+	case M_SUBSTR:
+		/* a substring may occur anywhere in the field */
+		per_char = SEL_CHAR_SUBSTR;
+		break;
+	default:
+		/* nothing is known about a regular expression */
+		return SEL_REGEX;
+	}
+
+	sel = 1;
+	for (i = 0; i < re->lit_len && sel > SEL_MIN; i++)
+		if (!re->any[i])
+			sel *= per_char;
+
+	return sel > SEL_MIN ? sel : SEL_MIN;
+}
+
+static int
+steps_cmp(const void *s1v, const void *s2v)
+{
+	const struct step_t	*s1 = (const struct step_t *)s1v;
+	const struct step_t	*s2 = (const struct step_t *)s2v;
+	double			r1, r2;
+
+	/*
+	 * Expected cost of a step per port that it removes, steps that
+	 * remove nothing go last
+	 */
+	r1 = s1->sel < 1 ? s1->cost / (1 - s1->sel) : HUGE_VAL;
+	r2 = s2->sel < 1 ? s2->cost / (1 - s2->sel) : HUGE_VAL;
+
+	if (r1 < r2)
+		return -1;
+	if (r1 > r2)
+		return 1;
+	return 0;
+}
+
+static void
+filter_slice(size_t slice, void *arg_void)
+{
+	struct farg_t		*fa = (struct farg_t *)arg_void;
+	const struct plan_t	*plan = fa->plan;
+	struct fre_t		*fre = &fa->fres[slice];
+	size_t			*examined = &fa->examined[slice * CRITS_CNT];
+	size_t			*passed = &fa->passed[slice * CRITS_CNT];
+	int			*matched = fa->ports->matched;
+	size_t			def;
+	size_t			i, k, start, end;
+
+	start = fa->ports->sz / fa->slices_cnt * slice;
+	if (slice == fa->slices_cnt - 1)
+		end = fa->ports->sz;
+	else
+		end = fa->ports->sz / fa->slices_cnt * (slice + 1);
+
+	for (i = start; i < end; i++)
+	{
+		/* at most one port has the given origin */
+		if (fa->opts->search_crit & SEARCH_BY_ORIGIN)
+		{
+			if (!fa->origin_found || i != fa->origin_idx)
+				continue;
+			matched[i] |= SEARCH_BY_ORIGIN;
+		}
+
+		/* criteria are ANDed, stop at the first failed one */
+		for (k = 0; k < plan->steps_cnt; k++)
+		{
+			def = plan->steps[k].def;
+
+			examined[k]++;
+
+			if (!crit_match(&fre->re[def], fre->folded[def], def,
+					fa->ports, i))
+				break;
+
+			passed[k]++;
+
+			matched[i] |= crit_defs[def].crit;
+		}
+	}
+}
+
+static void
+filter_ports_by_pfile(struct ports_t *ports, const struct sc_dirs_t *d,
+		      int should_have_matched,
+		      const char *search_file, int regcomp_flags,
+		      int explain)
+{
+	int		fd;
+	struct garg_t	garg;
+	struct stat	sb;
+	struct tri_t	*tri;
+	struct px_t	*px;
+	int		have_tri, have_px, have_lines;
+	uint32_t	*lines;
+	size_t		lines_cnt;
+	uint32_t	*pkeys;
+	size_t		pkeys_cnt;
+	size_t		ports_lines;
+	size_t		ruled_out;
+	size_t		i, cnt;
+	char		*map;
+	char		*fmap;
+	char		*folded;
+	const char	*smap;  /* the one that is searched */
+	const char	*how;
+	char		how_buf[64];
+
+	garg.ports = ports;
+	garg.plist_fn = d->plist_fn;
+	garg.should_have_matched = should_have_matched;
+	garg.line_num = 0;
+	garg.lines_examined = 0;
+
+	/* an element is started by add_pfile() when its port matches */
+	ports->plists =
+	    (struct vector_t *)xmalloc(ports->sz * sizeof(struct vector_t));
+
+	/*
+	 * Optimization:
+	 * If other criteria have been given and no port passed all of them,
+	 * then there is no need to look at the plist file at all.
+	 */
+	if (should_have_matched)
+	{
+		for (i = 0, cnt = 0; i < ports->sz; i++)
+			if (ports->matched[i] == should_have_matched)
+				cnt++;
+
+		if (cnt == 0)
+		{
+			if (explain)
+				fprintf(stderr, "  pfile   skipped, no ports "
+					"left\n");
+			return;
+		}
+	}
+
+	m_comp(&garg.re, search_file, regcomp_flags);
+
+	if ((fd = open(d->plist_fn, O_RDONLY)) == -1)
+		err(EX_NOINPUT, "open(): %s", d->plist_fn);
+
+	if (fstat(fd, &sb) == -1)
+		err(EX_OSERR, "fstat(): %s", d->plist_fn);
+
+	/* nothing to search for in an empty file (which can not be mmap(2)ed) */
+	if (sb.st_size == 0)
+	{
+		close(fd);
+		m_free(&garg.re);
+		return;
+	}
+
+	/*
+	 * Optimization:
+	 * REG_ICASE is slow, a case insensitive search runs the lowercased
+	 * pattern over the lowercased copy of the plist file instead.
+	 */
+	garg.fmap = NULL;
+	fmap = NULL;
+	folded = NULL;
+	if ((regcomp_flags & REG_ICASE) &&
+	    (folded = m_fold_pattern(search_file)) != NULL &&
+	    map_fold(d, sb.st_size, &fmap) == 0)
+	{
+		garg.fmap = fmap;
+
+		search_file = folded;
+		regcomp_flags &= ~REG_ICASE;
+
+		m_free(&garg.re);
+		m_comp(&garg.re, search_file, regcomp_flags);
+	}
+
+	/*
+	 * Optimization:
+	 * If the pattern contains a literal of at least 3 characters, then
+	 * the trigram index gives the lines that may contain it. If other
+	 * criteria have already selected some ports, then the per port index
+	 * gives their lines. Run the regular expression only on whichever
+	 * set of lines is smaller.
+	 */
+	have_tri = tri_open(&tri, d->tri_fn, sb.st_size) == 0;
+	have_px = should_have_matched &&
+		px_open(&px, d->px_fn, sb.st_size) == 0;
+
+	have_lines = have_tri &&
+		tri_candidates(tri, search_file, &lines, &lines_cnt) == 0;
+
+	/*
+	 * Optimization:
+	 * The summaries of the ports tell which of them surely do not
+	 * contain the trigrams of the pattern, their lines are not looked at.
+	 */
+	pkeys = NULL;
+	pkeys_cnt = 0;
+	if (have_px)
+	{
+		if (tri_pattern_keys(search_file, &pkeys, &pkeys_cnt) == -1)
+		{
+			pkeys = NULL;
+			pkeys_cnt = 0;
+		}
+
+		ports_lines = matched_lines(ports, px, should_have_matched,
+					    pkeys, pkeys_cnt, &ruled_out);
+	}
+
+	if ((map = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0))
+	    == MAP_FAILED)
+		err(EX_OSERR, "mmap(): %s", d->plist_fn);
+
+	close(fd);
+
+	garg.map = map;
+	smap = garg.fmap != NULL ? garg.fmap : map;
+
+	garg.buf_sz = BUFSIZ;
+	garg.buf = (char *)xmalloc(garg.buf_sz);
+
+	if (have_px && (!have_lines || ports_lines <= lines_cnt))
+	{
+		how = "per port index";
+		if (ruled_out > 0)
+		{
+			snprintf(how_buf, sizeof(how_buf), "per port index, "
+				 "%lu port(s) ruled out by summaries",
+				 (unsigned long)ruled_out);
+			how = how_buf;
+		}
+		gather_ports(smap, px, pkeys, pkeys_cnt, &garg);
+	}
+	else if (have_lines)
+	{
+		how = "trigram index";
+		gather_lines(smap, tri, lines, lines_cnt, &garg);
+	}
+	else
+	{
+		how = "whole plist file";
+
+		/* the other ways only look at scattered lines */
+		if (madvise((void *)smap, sb.st_size, MADV_SEQUENTIAL) == -1)
+			err(EX_OSERR, "madvise(): %s", d->plist_fn);
+
+		scan_plist(smap, sb.st_size, search_file, regcomp_flags,
+			   &garg);
+	}
+
+	if (explain)
+	{
+		for (i = 0, cnt = 0; i < ports->sz; i++)
+			if (ISSET(SEARCH_BY_PFILE, ports->matched[i]) &&
+			    (ports->matched[i] & ~SEARCH_BY_PFILE) ==
+			    should_have_matched)
+				cnt++;
+
+		fprintf(stderr, "  pfile   %s, %s%s: examined %lu lines, "
+			"passed %lu ports\n", m_kind_name(&garg.re), how,
+			garg.fmap != NULL ? " (lowercased)" : "",
+			(unsigned long)garg.lines_examined,
+			(unsigned long)cnt);
+	}
+
+	xfree(garg.buf);
+
+	if (munmap(map, sb.st_size) == -1)
+		err(EX_OSERR, "munmap(): %s", d->plist_fn);
+
+	if (garg.fmap != NULL && munmap(fmap, sb.st_size) == -1)
+		err(EX_OSERR, "munmap(): %s", d->fold_fn);
+
+	xfree(folded);
+
+	if (have_lines)
+		xfree(lines);
+	if (pkeys != NULL)
+		xfree(pkeys);
+	if (have_tri)
+		tri_close(tri);
+	if (have_px)
+		px_close(px);
+
+	m_free(&garg.re);
+}
+
+static int
+map_fold(const struct sc_dirs_t *d, size_t sz, char **fmap)
+{
+	int		fd;
+	struct stat	sb;
+
+	/* a store created before the lowercased copy */
+	if ((fd = open(d->fold_fn, O_RDONLY)) == -1)
+		return -1;
+
+	if (fstat(fd, &sb) == -1)
+		err(EX_OSERR, "fstat(): %s", d->fold_fn);
+
+	if ((size_t)sb.st_size != sz)
+	{
+		close(fd);
+		return -1;
+	}
+
+	if ((*fmap = mmap(NULL, sz, PROT_READ, MAP_SHARED, fd, 0))
+	    == MAP_FAILED)
+		err(EX_OSERR, "mmap(): %s", d->fold_fn);
+
+	close(fd);
+
+	return 0;
+}
+
+static size_t
+matched_lines(const struct ports_t *ports, const struct px_t *px,
+	      int should_have_matched, const uint32_t *keys, size_t keys_cnt,
+	      size_t *ruled_out)
+{
+	struct px_block_t	b;
+	size_t			cnt;
+	size_t			i;
+
+	cnt = 0;
+	*ruled_out = 0;
+	for (i = 0; i < ports->sz; i++)
+	{
+		if (ports->matched[i] != should_have_matched ||
+		    px_port(px, ports->ids[i], &b) == -1)
+			continue;
+
+		if (px_bloom(px, ports->ids[i], keys, keys_cnt))
+			cnt += b.lines_cnt;
+		else
+			(*ruled_out)++;
+	}
+
+	return cnt;
+}
+
+static void
+gather_ports(const char *map, const struct px_t *px, const uint32_t *keys,
+	     size_t keys_cnt, struct garg_t *garg)
+{
+	const struct ports_t	*ports = garg->ports;
+	struct px_block_t	b;
+	struct lineiter_t	li;
+	const char		*line;
+	size_t			len;
+	uint32_t		line_num;
+	size_t			i;
+
+	for (i = 0; i < ports->sz; i++)
+	{
+		if (ports->matched[i] != garg->should_have_matched ||
+		    px_port(px, ports->ids[i], &b) == -1 ||
+		    !px_bloom(px, ports->ids[i], keys, keys_cnt))
+			continue;
+
+		line_num = b.first_line;
+
+		li_start(&li, map + b.offt, b.len);
+
+		while (li_next(&li, &line, &len))
+		{
+			gather_line(line, len, line_num, garg);
+
+			line_num++;
+		}
+
+		li_close(&li);
+	}
+}
+
+static void
+gather_lines(const char *map, const struct tri_t *tri,
+	     const uint32_t *lines, size_t lines_cnt, struct garg_t *garg)
+{
+	size_t	offt, len;
+	size_t	i;
+
+	for (i = 0; i < lines_cnt; i++)
+	{
+		tri_line(tri, lines[i], &offt, &len);
+
+		gather_line(map + offt, len, lines[i], garg);
+	}
+}
+
+static void
+gather_line(const char *line, size_t len, uint32_t line_num,
+	    struct garg_t *garg)
+{
+	if (len + 1 > garg->buf_sz)
+	{
+		garg->buf_sz = len + 1;
+		xfree(garg->buf);
+		garg->buf = (char *)xmalloc(garg->buf_sz);
+	}
+
+	/* gather_pfiles() needs a writable, NUL terminated line */
+	memcpy(garg->buf, line, len);
+	garg->buf[len] = '\0';
+
+	/* gather_pfiles() counts from 1 */
+	garg->line_num = line_num;
+
+	garg->lines_examined++;
+
+	gather_pfiles(garg->buf, len, garg->fmap == NULL ? line :
+		      garg->map + (line - garg->fmap), garg);
+}
+
+static void
+scan_plist(const char *map, size_t map_sz, const char *search_file,
+	   int regcomp_flags, struct garg_t *garg)
+{
+	struct scan_arg_t	arg;
+	struct scan_chunk_t	*c;
+	struct scan_match_t	*sm;
+	const char		*p, *end;
+	size_t			chunks_cnt;
+	size_t			i, j;
+
+	chunks_cnt = par_ncpus();
+	if (chunks_cnt > map_sz / SCAN_CHUNK_MIN)
+		chunks_cnt = map_sz / SCAN_CHUNK_MIN;
+	if (chunks_cnt == 0)
+		chunks_cnt = 1;
+
+	arg.map = map;
+	arg.search_file = search_file;
+	arg.regcomp_flags = regcomp_flags;
+	arg.chunks = (struct scan_chunk_t *)xmalloc(chunks_cnt *
+						    sizeof(struct scan_chunk_t));
+
+	/* split at the record separators after equally spaced points */
+	p = map;
+	end = map + map_sz;
+	for (i = 0; i < chunks_cnt; i++)
+	{
+		c = &arg.chunks[i];
+
+		c->start = p;
+
+		if (i == chunks_cnt - 1)
+			p = end;
+		else
+		{
+			p = map + map_sz / chunks_cnt * (i + 1);
+			if (p < c->start)
+				p = c->start;
+			if ((p = memchr(p, RSp, end - p)) == NULL)
+				p = end;
+			else
+				p++;
+		}
+
+		c->end = p;
+	}
+
+	par_run(chunks_cnt, scan_chunk, &arg);
+
+	/* merge in file order, the same order gather_pfiles() would use */
+	for (i = 0; i < chunks_cnt; i++)
+	{
+		c = &arg.chunks[i];
+
+		for (j = 0; j < c->matches_cnt; j++)
+		{
+			sm = &c->matches[j];
+
+			if (sm->pfile_len + 1 > garg->buf_sz)
+			{
+				garg->buf_sz = sm->pfile_len + 1;
+				xfree(garg->buf);
+				garg->buf = (char *)xmalloc(garg->buf_sz);
+			}
+
+			memcpy(garg->buf, garg->map + sm->pfile_offt,
+			       sm->pfile_len);
+			garg->buf[sm->pfile_len] = '\0';
+
+			add_pfile(garg, sm->portid, garg->buf);
+		}
+
+		xfree(c->matches);
+
+		garg->lines_examined += c->lines_cnt;
+
+		if (c->bad_line != NULL)
+		{
+			/* count the lines only to report the error */
+			garg->line_num = 1;
+			for (p = map; p < c->bad_line; p++)
+				if (*p == RSp)
+					garg->line_num++;
+
+			errx(EX_DATAERR, "corrupted datafile: %s: "
+			     "``%c'' not found on line %u",
+			     garg->plist_fn, FSp, garg->line_num);
+		}
+	}
+
+	xfree(arg.chunks);
+}
+
+static void
+scan_chunk(size_t i, void *arg_void)
+{
+	struct scan_arg_t	*arg = (struct scan_arg_t *)arg_void;
+	struct scan_chunk_t	*c = &arg->chunks[i];
+	struct scan_match_t	*sm;
+	struct match_t		re;
+	struct lineiter_t	li;
+	const char		*line, *fs, *rs;
+	char			*buf;
+	size_t			buf_sz;
+	size_t			line_len;
+	size_t			len;
+	unsigned		portid;
+
+	c->matches_sz = 64;
+	c->matches_cnt = 0;
+	c->matches = (struct scan_match_t *)xmalloc(c->matches_sz *
+						    sizeof(struct scan_match_t));
+	c->bad_line = NULL;
+	c->lines_cnt = 0;
+
+	/* compiled patterns are not shared between threads */
+	m_comp(&re, arg->search_file, arg->regcomp_flags);
+
+	buf_sz = BUFSIZ;
+	buf = (char *)xmalloc(buf_sz);
+
+	li_start(&li, c->start, c->end - c->start);
+
+	while (li_next(&li, &line, &line_len))
+	{
+		if (line_len == 0)
+			continue;
+
+		rs = line + line_len;
+
+		if ((fs = split_pline(line, line_len, &portid)) == NULL)
+		{
+			c->bad_line = line;
+			break;
+		}
+
+		len = rs - fs - 1;
+
+		c->lines_cnt++;
+
+		/* m_match() needs a NUL terminated string */
+		if (len + 1 > buf_sz)
+		{
+			buf_sz = len + 1;
+			xfree(buf);
+			buf = (char *)xmalloc(buf_sz);
+		}
+
+		memcpy(buf, fs + 1, len);
+		buf[len] = '\0';
+
+		if (!m_match(&re, buf, len))
+			continue;
+
+		if (c->matches_cnt == c->matches_sz)
+		{
+			c->matches_sz *= 2;
+			if ((c->matches = realloc(c->matches, c->matches_sz *
+						  sizeof(struct scan_match_t)))
+			    == NULL)
+				err(EX_OSERR, "realloc(): %u",
+				    (unsigned)(c->matches_sz *
+					       sizeof(struct scan_match_t)));
+		}
+
+		sm = &c->matches[c->matches_cnt++];
+		sm->portid = portid;
+		sm->pfile_offt = fs + 1 - arg->map;
+		sm->pfile_len = len;
+	}
+
+	li_close(&li);
+
+	xfree(buf);
+
+	m_free(&re);
+}
+
+static void
+gather_pfiles(char *line, size_t len, const char *orig, struct garg_t *arg)
+{
+	const char	*FSp_pos;
+	unsigned	portid;
+
+	arg->line_num++;
+
+	if ((FSp_pos = split_pline(line, len, &portid)) == NULL)
+		errx(EX_DATAERR, "corrupted datafile: %s: "
+		     "``%c'' not found on line %u",
+		     arg->plist_fn, FSp, arg->line_num);
+
+	if (!m_match(&arg->re, FSp_pos + 1, line + len - FSp_pos - 1))
+		return;
+
+	/* match, show the file as it is in the plist */
+
+	if (arg->fmap != NULL)
+		memcpy(line, orig, len);
+
+	add_pfile(arg, portid, FSp_pos + 1);
+}
+
+static const char *
+split_pline(const char *line, size_t len, unsigned *portid)
+{
+	const unsigned char	*u = (const unsigned char *)line;
+
+	if (len > PLIST_ID_LEN && line[PLIST_ID_LEN] == FSp &&
+	    (u[0] & u[1] & u[2] & u[3] & 0x80) != 0)
+	{
+		*portid = (u[0] & 0x7f) << 21 | (u[1] & 0x7f) << 14 |
+			(u[2] & 0x7f) << 7 | (u[3] & 0x7f);
+		return line + PLIST_ID_LEN;
+	}
+
+	/* a store created before the binary ids */
+	*portid = (unsigned)strtoul(line, NULL, 10);
+
+	return (const char *)memchr(line, FSp, len);
+}
+
+static void
+add_pfile(struct garg_t *arg, unsigned portid, const char *pfile)
+{
+	struct ports_t	*ports = arg->ports;
+	size_t		i;
+
+	i = get_port_by_id(ports, portid);
+
+	/* only ports that passed all other criteria are interesting */
+	if (arg->should_have_matched &&
+	    (ports->matched[i] & ~SEARCH_BY_PFILE) != arg->should_have_matched)
+		return;
+
+	if ((ports->matched[i] & SEARCH_BY_PFILE) == 0)
+		v_start(&ports->plists[i], 2);
+
+	ports->matched[i] |= SEARCH_BY_PFILE;
+
+	v_add(&ports->plists[i], pfile, strlen(pfile) + 1);
+}
+
+static size_t
+get_port_by_id(const struct ports_t *ports, unsigned portid)
+{
+	uint32_t	key;
+	const uint32_t	*res;
+
+	/* mkdb numbers the ports from 1 and the store keeps all of them */
+	if (portid >= 1 && portid <= ports->sz &&
+	    ports->ids[portid - 1] == portid)
+		return portid - 1;
+
+	/* not a dense store, look for it */
+	key = portid;
+
+	res = (const uint32_t *)bsearch(&key, ports->ids, ports->sz,
+					sizeof(uint32_t), sc_ids_cmp);
+
+	if (res == NULL)
+		errx(EX_DATAERR, "corrupted database: port with id %u exists in "
+		     "plist file but not found in index file", portid);
+
+	return res - ports->ids;
+}
+
+/***/
+
+void
+sc_index_paths(const struct ports_t *ports, struct hash_t *by_path)
+{
+	size_t	i;
+
+	h_start(by_path, ports->sz);
+
+	for (i = 0; i < ports->sz; i++)
+		h_add(by_path, PORT_FLD(ports, i, PF_PATH),
+		      (void *)&ports->ids[i]);
+}
+
+int
+sc_load_port_by_path(const struct ports_t *ports,
+		     const struct hash_t *by_path, const char *path,
+		     size_t *idx)
+{
+	const uint32_t	*found;
+
+	if ((found = (const uint32_t *)h_find(by_path, path)) == NULL)
+		return -1;
+
+	*idx = found - ports->ids;
+
+	return 0;
+}
+
+void
+sc_load_port_plist(const struct plist_t *plist, struct port_t *port)
+{
+	struct pline_t		search_pline;
+	struct pline_t		*found_pline;
+	struct pline_t		*p;
+	struct px_block_t	b;
+	const char		*line, *end, *fs, *rs;
+	char			*file;
+	size_t			file_sz;
+	unsigned		portid;
+
+	if (plist->px != NULL)
+	{
+		if (px_port(plist->px, port->id, &b) == -1)
+			return;
+
+		file_sz = BUFSIZ;
+		file = (char *)xmalloc(file_sz);
+
+		end = plist->raw + b.offt + b.len;
+
+		/* the block holds "id|file\n" lines of this port only */
+		for (line = plist->raw + b.offt; line < end; line = rs + 1)
+		{
+			if ((rs = memchr(line, RSp, end - line)) == NULL ||
+			    (fs = split_pline(line, rs - line, &portid)) == NULL)
+				errx(EX_DATAERR, "corrupted datafile: "
+				     "bad line in the plist of port %u",
+				     port->id);
+
+			if ((size_t)(rs - fs) > file_sz)
+			{
+				file_sz = rs - fs;
+				xfree(file);
+				file = (char *)xmalloc(file_sz);
+			}
+
+			memcpy(file, fs + 1, rs - fs - 1);
+			file[rs - fs - 1] = '\0';
+
+			v_add(&port->plist, file, rs - fs);
+		}
+
+		xfree(file);
+
+		return;
+	}
+
+	search_pline.portid = port->id;
+
+	found_pline = (struct pline_t *)bsearch(&search_pline,
+						plist->plines,
+						plist->plines_cnt,
+						sizeof(struct pline_t),
+						plines_cmp);
+
+	if (found_pline != NULL)
+	{
+		/* bsearch() may return any of the port's lines */
+		for (p = found_pline;
+		     p > plist->plines && p[-1].portid == port->id; p--)
+			;
+
+		for (; p < plist->plines + plist->plines_cnt &&
+		     p->portid == port->id; p++)
+			v_add(&port->plist, p->pfile, strlen(p->pfile) + 1);
+	}
+}
+
+void
+sc_load_plist(const struct sc_dirs_t *d, struct plist_t **plist_p)
+{
+	struct sepscan_t	ss;
+	const char	*fs;
+	unsigned	portid;
+	size_t		start;
+	size_t		i;
+	struct plist_t	*plist;
+	int		fd;
+	struct stat	sb;
+
+	plist = (struct plist_t *)xmalloc(sizeof(struct plist_t));
+
+	plist->px = NULL;
+	plist->plines_cnt = 0;
+	plist->plines = NULL;
+
+	if ((fd = open(d->plist_fn, O_RDONLY)) == -1)
+		err(EX_NOINPUT, "open(): %s", d->plist_fn);
+
+	if (fstat(fd, &sb) == -1)
+		err(EX_OSERR, "fstat(): %s", d->plist_fn);
+
+	/*
+	 * Optimization:
+	 * With the per port index ports' plists are read directly from the
+	 * mmap(2)ed file, there is no need to parse and sort all of it.
+	 */
+	if (sb.st_size > 0 && px_open(&plist->px, d->px_fn, sb.st_size) == 0)
+	{
+		plist->raw_sz = sb.st_size;
+
+		if ((plist->raw = mmap(NULL, plist->raw_sz, PROT_READ,
+				       MAP_SHARED, fd, 0)) == MAP_FAILED)
+			err(EX_OSERR, "mmap(): %s", d->plist_fn);
+
+		close(fd);
+
+		*plist_p = plist;
+
+		return;
+	}
+
+	close(fd);
+
+	plist->raw_sz = sc_load_file(d->plist_fn, &plist->raw);
+
+	ss_start(&ss);
+	ss_scan(&ss, plist->raw, plist->raw_sz, RSp, RSp);
+
+	plist->plines = (struct pline_t *)xmalloc(ss.rs_cnt *
+						  sizeof(struct pline_t));
+
+	for (i = 0, start = 0; i < ss.rs_cnt; start = ss.rs[i++] + 1)
+	{
+		if (ss.rs[i] == start)
+			continue;
+
+		if ((fs = split_pline(plist->raw + start, ss.rs[i] - start,
+				      &portid)) == NULL)
+			errx(EX_DATAERR, "corrupted database: %s: no id in "
+			     "line %lu", d->plist_fn, (unsigned long)i + 1);
+
+		plist->raw[ss.rs[i]] = '\0';
+
+		plist->plines[plist->plines_cnt].portid = portid;
+		plist->plines[plist->plines_cnt].pfile = (char *)fs + 1;
+		plist->plines_cnt++;
+	}
+
+	ss_destroy(&ss);
+
+	/* normally plist is loaded ordered, but just to make sure */
+	if (mergesort(plist->plines,
+		      plist->plines_cnt,
+		      sizeof(struct pline_t),
+		      plines_cmp) == -1)
+		err(EX_OSERR, "mergesort()");
+
+	*plist_p = plist;
+}
+
+void
+sc_load_fprints(const struct plist_t *plist, struct ports_t *ports)
+{
+	size_t	i;
+
+	ports->fprints = (uint64_t *)xmalloc(ports->sz * sizeof(uint64_t));
+	ports->fdeps = (const char **)xmalloc(ports->sz * sizeof(char *));
+
+	for (i = 0; i < ports->sz; i++)
+	{
+		ports->fprints[i] = plist->px != NULL ?
+			px_fprint(plist->px, ports->ids[i]) : 0;
+		ports->fdeps[i] = plist->px != NULL ?
+			px_fdeps(plist->px, ports->ids[i]) : NULL;
+	}
+}
+
+void
+sc_free_plist(struct plist_t *plist)
+{
+	if (plist->px != NULL)
+	{
+		px_close(plist->px);
+
+		if (munmap(plist->raw, plist->raw_sz) == -1)
+			err(EX_OSERR, "munmap()");
+	}
+	else
+	{
+		xfree(plist->plines);
+
+		sc_free_file(plist->raw);
+	}
+
+	xfree(plist);
+}
+
+static int
+plines_cmp(const void *l1v, const void *l2v)
+{
+	struct pline_t	*l1;
+	struct pline_t	*l2;
+
+	l1 = (struct pline_t *)l1v;
+	l2 = (struct pline_t *)l2v;
+
+	if (l1->portid < l2->portid)
+		return -1;
+	if (l1->portid > l2->portid)
+		return 1;
+	return 0;
+}
+
+/* EOF */
@@ -0,0 +1,257 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Routines shared by the store backends (store_txt.c, store_bin.c).
+ * The backends differ only in how they keep the index file, the plist
+ * file and the directory layout are common to all of them.
+ */
+
+#ifndef STORE_COMMON_H
+#define STORE_COMMON_H
+
+#include <sys/types.h>
+#include <sys/param.h>  /* for PATH_MAX */
+
+#include <stdio.h>
+
+#include "hash.h"
+#include "plistidx.h"
+#include "portdef.h"
+#include "portsearch.h"
+#include "store.h"
+#include "trigram.h"
+
+/* RSp must be '\n' because we use fgets */
+#define RSp	'\n'  /* record separator for plist file */
+#define FSp	'|'  /* field separator for plist file */
+
+struct pline_t {
+	unsigned	portid;
+	char		*pfile;
+};
+
+/*
+ * Ports' plists from the plist file, either looked up through the per
+ * port index (px != NULL, raw is the mmap(2)ed file) or, for a store
+ * without the index, parsed and sorted into plines
+ */
+struct plist_t {
+	char		*raw;
+	size_t		raw_sz;
+	struct px_t	*px;
+	size_t		plines_cnt;
+	struct pline_t	*plines;
+};
+
+/* store directories and the names of the files common to all backends */
+struct sc_dirs_t {
+	char		dir[PATH_MAX];
+	char		newdir[PATH_MAX];
+	char		olddir[PATH_MAX];
+
+	char		plist_fn[PATH_MAX];
+	char		plist_new_fn[PATH_MAX];
+	char		plist_old_fn[PATH_MAX];
+
+	char		fold_fn[PATH_MAX];
+	char		fold_new_fn[PATH_MAX];
+	char		fold_old_fn[PATH_MAX];
+
+	char		tri_fn[PATH_MAX];
+	char		tri_new_fn[PATH_MAX];
+	char		tri_old_fn[PATH_MAX];
+
+	char		px_fn[PATH_MAX];
+	char		px_new_fn[PATH_MAX];
+	char		px_old_fn[PATH_MAX];
+
+	char		meta_fn[PATH_MAX];
+	char		meta_new_fn[PATH_MAX];
+	char		meta_old_fn[PATH_MAX];
+};
+
+/* identity of the store directory, it changes when the store is replaced */
+struct sc_stamp_t {
+	dev_t	dev;
+	ino_t	ino;
+};
+
+/* the plist file being created and the indexes built along with it */
+struct sc_new_t {
+	FILE			*plist_fp;
+	FILE			*fold_fp;  /* plist_fp lowercased, see m_fold() */
+	char			*fold_buf;  /* a lowercased file */
+	size_t			fold_buf_sz;
+	uint32_t		*keys;  /* trigram keys of a port's files */
+	size_t			keys_sz;
+	size_t			plist_offt;  /* bytes written to plist_fp */
+	size_t			plist_lines;  /* lines written to plist_fp */
+	uint32_t		ports_cnt;  /* ports added, see sc_new_add_port() */
+	struct tri_new_t	*tri;
+	struct px_new_t		*px;
+	struct store_meta_t	meta;
+	int			meta_ok;  /* whether meta has been set */
+};
+
+/*
+ * Set store directories and plist filenames
+ */
+void sc_set_dirs(struct sc_dirs_t *d);
+
+/*
+ * Create DBDIR and the directory for the temporary new store
+ */
+void sc_mkdirs(const struct sc_dirs_t *d);
+
+/*
+ * Replace the current store with the temporary new one, `oldfiles' is
+ * a NULL terminated list of backend's files in the old directory that
+ * have to be removed in addition to the common ones
+ */
+void sc_replace_dir(const struct sc_dirs_t *d, const char *const *oldfiles);
+
+/*
+ * Record the identity of the current store directory in `st'
+ */
+void sc_get_stamp(const struct sc_dirs_t *d, struct sc_stamp_t *st);
+
+/*
+ * Check whether the current store directory is not the one recorded in
+ * `st' by sc_get_stamp(), return 1 if it is not, 0 otherwise
+ */
+int sc_stamp_changed(const struct sc_dirs_t *d, const struct sc_stamp_t *st);
+
+/*
+ * Load file from disk, ``raw'' will be exact image of the file's content,
+ * followed by a NUL. Returns the size of the file.
+ */
+size_t sc_load_file(const char *filename, char **raw);
+
+/*
+ * Free data allocated by sc_load_file()
+ */
+void sc_free_file(char *raw);
+
+/*
+ * Compare 2 uint32_t port IDs
+ */
+int sc_ids_cmp(const void *id1v, const void *id2v);
+
+/*
+ * Set up `ports' over `sz' sorted `ids', with no columns loaded, and
+ * allocate the side arrays
+ */
+void sc_ports_start(struct ports_t *ports, const uint32_t *ids, size_t sz);
+
+/*
+ * Free the side arrays of `ports', the ids and the columns belong to
+ * the backend
+ */
+void sc_ports_end(struct ports_t *ports);
+
+/*
+ * Return the PF_BIT()s of the columns sc_filter_ports() looks at for
+ * `opts', for all ports
+ */
+int sc_crit_flds(const struct options_t *opts);
+
+/*
+ * Return the PF_BIT()s of the columns display_ports() looks at for
+ * `opts', for the matched ports only
+ */
+int sc_disp_flds(const struct options_t *opts);
+
+/*
+ * Create the new plist file
+ */
+void sc_new_start(struct sc_new_t *n, const struct sc_dirs_t *d);
+
+/*
+ * Write port's plist to the new plist file
+ */
+void sc_new_add_port(struct sc_new_t *n, const struct sc_dirs_t *d,
+		     const struct port_t *port);
+
+/*
+ * Set the configuration written to the new store by sc_new_end()
+ */
+void sc_new_meta(struct sc_new_t *n, const struct store_meta_t *meta);
+
+/*
+ * Close the new plist file and write the indexes over it
+ */
+void sc_new_end(struct sc_new_t *n, const struct sc_dirs_t *d);
+
+/*
+ * Read the configuration of the store in `d', see s_read_meta()
+ */
+int sc_read_meta(const struct sc_dirs_t *d, struct store_meta_t *meta);
+
+/*
+ * Prepare the plist file of the store in `d' for sc_load_port_plist()
+ */
+void sc_load_plist(const struct sc_dirs_t *d, struct plist_t **plist);
+
+/*
+ * Set the `fprints' and `fdeps' arrays of `ports' as recorded in `plist'
+ */
+void sc_load_fprints(const struct plist_t *plist, struct ports_t *ports);
+
+/*
+ * Free data allocated by sc_load_plist()
+ */
+void sc_free_plist(struct plist_t *plist);
+
+/*
+ * Add to port->plist all files recorded in `plist' for port->id
+ */
+void sc_load_port_plist(const struct plist_t *plist, struct port_t *port);
+
+/*
+ * Create hash table `by_path' that maps ports' paths to the elements of
+ * `ports', free it with h_destroy(), the PF_PATH column must be loaded
+ */
+void sc_index_paths(const struct ports_t *ports, struct hash_t *by_path);
+
+/*
+ * Find port with the given path in a table created by sc_index_paths(),
+ * see s_load_port_by_path()
+ */
+int sc_load_port_by_path(const struct ports_t *ports,
+			 const struct hash_t *by_path, const char *path,
+			 size_t *idx);
+
+/*
+ * Implementation of filter_ports() over `ports', pfiles are read from
+ * the store in `d', `by_path' is used for SEARCH_BY_ORIGIN
+ */
+void sc_filter_ports(struct ports_t *ports, const struct hash_t *by_path,
+		     const struct sc_dirs_t *d, const struct options_t *opts);
+
+#endif  /* STORE_COMMON_H */
+
+/* EOF */
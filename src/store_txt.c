@@ -27,163 +27,136 @@
 #include <sys/cdefs.h>
 #include <sys/types.h>
 #include <sys/param.h>
-#include <sys/stat.h>
-#include <sys/uio.h>
-#include <sys/utsname.h>
 
-#include <assert.h>
-#include <ctype.h>
 #include <err.h>
-#include <errno.h>
-#include <fcntl.h>
-#include <limits.h>
-#include <regex.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sysexits.h>
 #include <unistd.h>
 
-#include "display.h"
-#include "exhaust_fp.h"
-#include "parse_indexln.h"
+#include "match.h"
 #include "portdef.h"
+#include "sepscan.h"
 #include "store.h"
-#include "vector.h"
+#include "store_common.h"
 #include "xlibc.h"
 
 #define RSi	'\n'  /* record separator for index file */
 #define FSi	'|'  /* field separator for index file */
 
-/* RSp must be '\n' because we use fgets */
-#define RSp	'\n'  /* record separator for plist file */
-#define FSp	'|'  /* field separator for plist file */
+/* fields of an index record after the id, in the order they appear */
+static const enum port_fld	txt_flds[] = {
+	PF_PKGNAME,
+	PF_PATH,
+	PF_PREFIX,
+	PF_COMMENT,
+	PF_PKGDESCR,
+	PF_MAINT,
+	PF_CATEGORIES,
+	PF_BDEP,
+	PF_RDEP,
+	PF_WWW,
+	PF_EDEP,
+	PF_PDEP,
+	PF_FDEP
+};
+
+#define TXT_FLDS_CNT	(sizeof(txt_flds) / sizeof(txt_flds[0]))
+
+/* a line of the index file, the port's fields are copied on demand */
+struct txt_line_t {
+	uint32_t	id;  /* must be first, see sc_ids_cmp() */
+	uint32_t	offt;  /* in ports_raw */
+	uint32_t	len;  /* without the record separator */
+	uint32_t	fs_first;  /* index in scan.fs of its first FSi */
+	uint32_t	fs_cnt;
+};
 
-struct pline_t {
-	unsigned	portid;
-	char		*pfile;
+/* how much of a column has been copied out of the lines */
+enum txt_col_state {
+	TC_NONE,
+	TC_MATCHED,  /* only for the ports shown by display_ports() */
+	TC_ALL
 };
 
-struct plist_t {
-	char		*raw;
-	size_t		plines_cnt;
-	struct pline_t	*plines;
+/* a column of struct ports_t, filled by load_cols() */
+struct txt_col_t {
+	enum txt_col_state	state;
+	struct port_str_t	*strs;
+	char			*heap;
+	size_t			heap_len;
+	size_t			heap_sz;  /* allocated bytes in heap */
+	char			*fold;  /* heap lowercased, see fold_cols() */
 };
 
 struct store_t {
-	char		dir[PATH_MAX];
-	char		newdir[PATH_MAX];
-	char		olddir[PATH_MAX];
+	struct sc_dirs_t	d;
 
 	char		index_fn[PATH_MAX];
-	char		plist_fn[PATH_MAX];
 	char		index_new_fn[PATH_MAX];
-	char		plist_new_fn[PATH_MAX];
 	char		index_old_fn[PATH_MAX];
-	char		plist_old_fn[PATH_MAX];
 
-	FILE		*index_fp;
-	FILE		*plist_fp;
 	FILE		*index_new_fp;
-	FILE		*plist_new_fp;
+	struct sc_new_t	new_plist;
 
-	struct ports_t	ports;
+	struct ports_t	ports;  /* ids and columns below */
+	struct hash_t	by_path;  /* path -> element of ports.ids */
+	int		by_path_ok;  /* whether by_path has been created */
+	struct sc_stamp_t	stamp;  /* store loaded by s_search_start() */
 	char		*ports_raw;
+	struct sepscan_t	scan;  /* separators in ports_raw */
+	struct txt_line_t	*lines;  /* indexed like ids */
+	uint32_t	*ids;
+	struct txt_col_t	cols[PF_CNT];
 	struct plist_t	*plist;
 };
 
-/* gather_pfiles argument */
-struct garg_t {
-	regex_t		re;
-	struct store_t	*store;
-	int		should_have_matched;
-};
-
 /*
  * Set index and plist filenames
  */
 static void set_filenames(struct store_t *store);
 
-/*
- * Load file from disk, ``raw'' will be exact image of the file's content
- */
-static void load_file(const char *filename, char **raw);
-
-/*
- * Free data allocated by load_file()
- */
-static void free_file(char *raw);
-
-/*
- * Add port's plist to store
- */
-static void add_port_plist(struct store_t *s, const struct port_t *port);
-
 /*
  * Add port's basic data to store
  */
 static void add_port_index(struct store_t *s, const struct port_t *port);
 
 /*
- * Add SEARCH_BY_PFILE to `matched' member of all ports that have
- * `search_file' in their plist. If `should_have_matched' is nonzero than
- * skip all ports that have `matched' member equal to zero.
+ * Load whole index file (all ports) from disk, only the separators and
+ * the ids are located
  */
-static void filter_ports_by_pfile(struct store_t *s, int should_have_matched,
-				  const char *search_file, int regcomp_flags);
-
-/*
- * Place plist files that match `arg->re' in the appropriate `plist'
- * members of the `arg->ports' structure
- */
-static void gather_pfiles(char *line, void *arg);
-
-/*
- * Retrieve port by its id, exit if port is not found
- */
-static void get_port_by_id(struct ports_t *ports, const char *portid,
-			   struct port_t **port);
+static void load_index(struct store_t *s);
 
 /*
- * Calculate number of occurences of `sep' in `raw'
+ * Copy the fields in the PF_BIT()s `flds' out of the lines into the
+ * columns of `ports', for all ports if `opts' is NULL or else for the
+ * ports that matched opts->search_crit only
  */
-static size_t records_cnt(const char *raw, char sep);
+static void load_cols(struct store_t *s, int flds,
+		      const struct options_t *opts);
 
 /*
- * Compare 2 ports accoring to their IDs
+ * Make the lowercased copies of the columns in the PF_BIT()s `flds',
+ * which must have been loaded for all ports
  */
-static int ports_cmp(const void *p1v, const void *p2v);
+static void fold_cols(struct store_t *s, int flds);
 
 /*
- * Load whole index file (all ports) from disk
+ * Locate field number `pos' (counting from 0 after the id) in `line',
+ * set `len' to its length and return its start, NULL if the line has
+ * fewer fields
  */
-static void load_index(struct store_t *s);
+static const char *find_fld(const struct store_t *s,
+			    const struct txt_line_t *line, size_t pos,
+			    size_t *len);
 
 /*
  * Free data allocated by load_index()
  */
 static void free_index(struct store_t *s);
 
-/*
- * Load whole plist file from disk
- */
-static void load_plist(struct store_t *s);
-
-/*
- * Free data allocated by load_plist()
- */
-static void free_plist(struct store_t *s);
-
-/*
- * Compare 2 plist lines, according to their portids
- */
-static int plines_cmp(const void *l1v, const void *l2v);
-
-/*
- * Remove old database directory
- */
-static void rm_olddir(const struct store_t *s);
-
 /***/
 
 void
@@ -206,7 +179,7 @@ s_exists()
 	set_filenames(&store);
 
 	if (access(store.index_fn, F_OK) == -1 ||
-	    access(store.plist_fn, F_OK) == -1)
+	    access(store.d.plist_fn, F_OK) == -1)
 		return 0;
 
 	return 1;
@@ -221,66 +194,50 @@ get_ports(struct store_t *s)
 void
 s_new_start(struct store_t *s)
 {
-	const char	*mkdirs[] = {DBDIR, s->newdir};
-	int		i;
-
 	set_filenames(s);
 
-	for (i = 0; i < sizeof(mkdirs) / sizeof(const char *); i++)
-		if (mkdir(mkdirs[i], 0755) == -1)
-			if (errno != EEXIST)
-				err(EX_CANTCREAT, "mkdir(): %s", mkdirs[i]);
+	sc_mkdirs(&s->d);
 
 	if ((s->index_new_fp = fopen(s->index_new_fn, "w")) == NULL)
 		err(EX_CANTCREAT, "fopen(): %s", s->index_new_fn);
 
-	if ((s->plist_new_fp = fopen(s->plist_new_fn, "w")) == NULL)
-		err(EX_CANTCREAT, "fopen(): %s", s->plist_new_fn);
+	sc_new_start(&s->new_plist, &s->d);
 }
 
 void
 s_new_end(struct store_t *s)
 {
+	const char	*oldfiles[] = {s->index_old_fn, NULL};
+
 	/* close newly created db files */
 	xfclose(s->index_new_fp, s->index_new_fn);
 
-	xfclose(s->plist_new_fp, s->plist_new_fn);
-
-	rm_olddir(s);
-
-	/* move current db out of the way */
-	if (rename(s->dir, s->olddir) == -1)
-		if (errno != ENOENT)
-			err(EX_CANTCREAT, "rename(): %s to %s", s->dir, s->olddir);
+	sc_new_end(&s->new_plist, &s->d);
 
-	/* make new db current */
-	if (rename(s->newdir, s->dir) == -1)
-		err(EX_CANTCREAT, "rename(): %s to %s", s->newdir, s->dir);
-
-	rm_olddir(s);
+	sc_replace_dir(&s->d, oldfiles);
 }
 
 void
-s_add_port(struct store_t *s, const struct port_t *port)
+s_new_meta(struct store_t *s, const struct store_meta_t *meta)
 {
-	add_port_plist(s, port);
-	add_port_index(s, port);
+	sc_new_meta(&s->new_plist, meta);
 }
 
-static void
-add_port_plist(struct store_t *s, const struct port_t *port)
+int
+s_read_meta(struct store_meta_t *meta)
 {
-	struct vector_iterator_t	vi;
-	char				*file;
+	struct store_t	store;
 
-	vi_reset(&vi, &port->plist);
+	set_filenames(&store);
 
-	while (vi_next(&vi, (void **)&file))
-		if (fprintf(s->plist_new_fp,
-			    "%u%c""%s%c",
-			    port->id, FSp,
-			    file, RSp) == -1)
-			err(EX_IOERR, "fprintf(): %s", s->plist_new_fn);
+	return sc_read_meta(&store.d, meta);
+}
+
+void
+s_add_port(struct store_t *s, const struct port_t *port)
+{
+	sc_new_add_port(&s->new_plist, &s->d, port);
+	add_port_index(s, port);
 }
 
 static void
@@ -310,13 +267,23 @@ s_read_start(struct store_t *s)
 	set_filenames(s);
 
 	load_index(s);
-	load_plist(s);
+	/* mkdb compares the versions of the ports found by path */
+	load_cols(s, PF_BIT(PF_PATH) | PF_BIT(PF_PKGNAME), NULL);
+	sc_load_plist(&s->d, &s->plist);
+	sc_load_fprints(s->plist, &s->ports);
+
+	/* every port from INDEX is looked up by path while updating */
+	sc_index_paths(&s->ports, &s->by_path);
+	s->by_path_ok = 1;
 }
 
 void
 s_read_end(struct store_t *s)
 {
-	free_plist(s);
+	h_destroy(&s->by_path);
+	s->by_path_ok = 0;
+
+	sc_free_plist(s->plist);
 	free_index(s);
 }
 
@@ -325,192 +292,70 @@ s_search_start(struct store_t *s)
 {
 	set_filenames(s);
 
+	/* before loading, so that a replacement during it is noticed */
+	sc_get_stamp(&s->d, &s->stamp);
+
 	load_index(s);
+
+	/* created by filter_ports() only if needed */
+	s->by_path_ok = 0;
 }
 
 void
 s_search_end(struct store_t *s)
 {
+	if (s->by_path_ok)
+	{
+		h_destroy(&s->by_path);
+		s->by_path_ok = 0;
+	}
+
 	free_index(s);
 }
 
 void
-filter_ports(struct store_t *s, const struct options_t *opts)
+s_search_preload(struct store_t *s)
 {
-	struct port_t	*cur_port;
-	regex_t		name_re;
-	regex_t		key_re;
-	regex_t		path_re;
-	regex_t		info_re;
-	regex_t		maint_re;
-	regex_t		cat_re;
-	regex_t		fdep_re;
-	regex_t		edep_re;
-	regex_t		pdep_re;
-	regex_t		bdep_re;
-	regex_t		rdep_re;
-	regex_t		dep_re;
-	regex_t		www_re;
-	int		regcomp_flags_fields;
-	int		regcomp_flags_pfiles;
-	size_t		i;
-
-	regcomp_flags_fields = REG_EXTENDED | REG_NOSUB;
-	regcomp_flags_pfiles = REG_EXTENDED | REG_NOSUB;
-
-	if (opts->icase_fields)
-		regcomp_flags_fields |= REG_ICASE;
-	if (opts->icase_pfiles)
-		regcomp_flags_pfiles |= REG_ICASE;
-
-	if (opts->search_crit & SEARCH_BY_NAME)
-		xregcomp(&name_re, opts->search_name, regcomp_flags_fields);
-	if (opts->search_crit & SEARCH_BY_KEY)
-		xregcomp(&key_re, opts->search_key, regcomp_flags_fields);
-	if (opts->search_crit & SEARCH_BY_PATH)
-		xregcomp(&path_re, opts->search_path, regcomp_flags_fields);
-	if (opts->search_crit & SEARCH_BY_INFO)
-		xregcomp(&info_re, opts->search_info, regcomp_flags_fields);
-	if (opts->search_crit & SEARCH_BY_MAINT)
-		xregcomp(&maint_re, opts->search_maint, regcomp_flags_fields);
-	if (opts->search_crit & SEARCH_BY_CAT)
-		xregcomp(&cat_re, opts->search_cat, regcomp_flags_fields);
-	if (opts->search_crit & SEARCH_BY_FDEP)
-		xregcomp(&fdep_re, opts->search_fdep, regcomp_flags_fields);
-	if (opts->search_crit & SEARCH_BY_EDEP)
-		xregcomp(&edep_re, opts->search_edep, regcomp_flags_fields);
-	if (opts->search_crit & SEARCH_BY_PDEP)
-		xregcomp(&pdep_re, opts->search_pdep, regcomp_flags_fields);
-	if (opts->search_crit & SEARCH_BY_BDEP)
-		xregcomp(&bdep_re, opts->search_bdep, regcomp_flags_fields);
-	if (opts->search_crit & SEARCH_BY_RDEP)
-		xregcomp(&rdep_re, opts->search_rdep, regcomp_flags_fields);
-	if (opts->search_crit & SEARCH_BY_WWW)
-		xregcomp(&www_re, opts->search_www, regcomp_flags_fields);
-	if (opts->search_crit & SEARCH_BY_DEP)
-		xregcomp(&dep_re, opts->search_dep, regcomp_flags_fields);
-
-	for (i = 0; i < s->ports.sz; i++)
-		if (s->ports.arr[i] != NULL)
-		{
-			cur_port = s->ports.arr[i];
-
-			if (opts->search_crit & SEARCH_BY_NAME)
-				if (regexec(&name_re, cur_port->pkgname, 0, NULL, 0) == 0)
-					cur_port->matched |= SEARCH_BY_NAME;
-
-			if (opts->search_crit & SEARCH_BY_KEY)
-				if (regexec(&key_re, cur_port->pkgname, 0, NULL, 0) == 0 ||
-				    regexec(&key_re, cur_port->comment, 0, NULL, 0) == 0 ||
-				    regexec(&key_re, cur_port->fdep, 0, NULL, 0) == 0 ||
-				    regexec(&key_re, cur_port->edep, 0, NULL, 0) == 0 ||
-				    regexec(&key_re, cur_port->pdep, 0, NULL, 0) == 0 ||
-				    regexec(&key_re, cur_port->bdep, 0, NULL, 0) == 0 ||
-				    regexec(&key_re, cur_port->rdep, 0, NULL, 0) == 0)
-					cur_port->matched |= SEARCH_BY_KEY;
-
-			if (opts->search_crit & SEARCH_BY_PATH)
-				if (regexec(&path_re, cur_port->path, 0, NULL, 0) == 0)
-					cur_port->matched |= SEARCH_BY_PATH;
-
-			if (opts->search_crit & SEARCH_BY_INFO)
-				if (regexec(&info_re, cur_port->comment, 0, NULL, 0) == 0)
-					cur_port->matched |= SEARCH_BY_INFO;
-
-			if (opts->search_crit & SEARCH_BY_MAINT)
-				if (regexec(&maint_re, cur_port->maint, 0, NULL, 0) == 0)
-					cur_port->matched |= SEARCH_BY_MAINT;
-
-			if (opts->search_crit & SEARCH_BY_CAT)
-				if (regexec(&cat_re, cur_port->categories, 0, NULL, 0) == 0)
-					cur_port->matched |= SEARCH_BY_CAT;
-
-			if (opts->search_crit & SEARCH_BY_FDEP)
-				if (regexec(&fdep_re, cur_port->fdep, 0, NULL, 0) == 0)
-					cur_port->matched |= SEARCH_BY_FDEP;
-
-			if (opts->search_crit & SEARCH_BY_EDEP)
-				if (regexec(&edep_re, cur_port->edep, 0, NULL, 0) == 0)
-					cur_port->matched |= SEARCH_BY_EDEP;
-
-			if (opts->search_crit & SEARCH_BY_PDEP)
-				if (regexec(&pdep_re, cur_port->pdep, 0, NULL, 0) == 0)
-					cur_port->matched |= SEARCH_BY_PDEP;
-
-			if (opts->search_crit & SEARCH_BY_BDEP)
-				if (regexec(&bdep_re, cur_port->bdep, 0, NULL, 0) == 0)
-					cur_port->matched |= SEARCH_BY_BDEP;
-
-			if (opts->search_crit & SEARCH_BY_RDEP)
-				if (regexec(&rdep_re, cur_port->rdep, 0, NULL, 0) == 0)
-					cur_port->matched |= SEARCH_BY_RDEP;
-
-			if (opts->search_crit & SEARCH_BY_DEP)
-				if (regexec(&dep_re, cur_port->bdep, 0, NULL, 0) == 0 ||
-				    regexec(&dep_re, cur_port->rdep, 0, NULL, 0) == 0)
-					cur_port->matched |= SEARCH_BY_DEP;
-
-			if (opts->search_crit & SEARCH_BY_WWW)
-				if (regexec(&www_re, cur_port->www, 0, NULL, 0) == 0)
-					cur_port->matched |= SEARCH_BY_WWW;
-		}
+	load_cols(s, PF_ALL, NULL);
+	fold_cols(s, PF_ALL);
+}
 
-	/*
-	 * Optimization:
-	 * Call filter_ports_by_pfile() after other filtering because it
-	 * loads plists only for ports that have been matched by other
-	 * search criteria (if any). Thus we avoid loading plists for all
-	 * ports in the case of ``-p ports-mgmt/portseach -f .*'' for example.
-	 */
-	if (opts->search_crit & SEARCH_BY_PFILE)
-		filter_ports_by_pfile(s, opts->search_crit & ~SEARCH_BY_PFILE,
-				      opts->search_file, regcomp_flags_pfiles);
-
-	if (opts->search_crit & SEARCH_BY_NAME)
-		xregfree(&name_re);
-	if (opts->search_crit & SEARCH_BY_KEY)
-		xregfree(&key_re);
-	if (opts->search_crit & SEARCH_BY_PATH)
-		xregfree(&path_re);
-	if (opts->search_crit & SEARCH_BY_INFO)
-		xregfree(&info_re);
-	if (opts->search_crit & SEARCH_BY_MAINT)
-		xregfree(&maint_re);
-	if (opts->search_crit & SEARCH_BY_CAT)
-		xregfree(&cat_re);
-	if (opts->search_crit & SEARCH_BY_FDEP)
-		xregfree(&fdep_re);
-	if (opts->search_crit & SEARCH_BY_EDEP)
-		xregfree(&edep_re);
-	if (opts->search_crit & SEARCH_BY_PDEP)
-		xregfree(&pdep_re);
-	if (opts->search_crit & SEARCH_BY_BDEP)
-		xregfree(&bdep_re);
-	if (opts->search_crit & SEARCH_BY_RDEP)
-		xregfree(&rdep_re);
-	if (opts->search_crit & SEARCH_BY_WWW)
-		xregfree(&www_re);
+int
+s_search_stale(struct store_t *s)
+{
+	return sc_stamp_changed(&s->d, &s->stamp);
 }
 
-static void
-filter_ports_by_pfile(struct store_t *s, int should_have_matched,
-		      const char *search_file, int regcomp_flags)
+void
+filter_ports(struct store_t *s, const struct options_t *opts)
 {
-	FILE		*plist_fp;
-	struct garg_t	garg;
+	load_cols(s, sc_crit_flds(opts), NULL);
 
-	garg.store = s;
-	garg.should_have_matched = should_have_matched;
+	/* only case insensitive searches look at the lowercased copies */
+	if (opts->icase_fields)
+		fold_cols(s, sc_crit_flds(opts));
 
-	xregcomp(&garg.re, search_file, regcomp_flags);
+	if ((opts->search_crit & SEARCH_BY_ORIGIN) && !s->by_path_ok)
+	{
+		sc_index_paths(&s->ports, &s->by_path);
+		s->by_path_ok = 1;
+	}
 
-	plist_fp = xfopen(s->plist_fn, "r");
+	sc_filter_ports(&s->ports, &s->by_path, &s->d, opts);
 
-	exhaust_fp(plist_fp, gather_pfiles, &garg);
+	load_cols(s, sc_disp_flds(opts), opts);
+}
 
-	xfclose(plist_fp, s->plist_fn);
+int
+s_load_port_by_path(struct store_t *s, const char *path, size_t *idx)
+{
+	return sc_load_port_by_path(&s->ports, &s->by_path, path, idx);
+}
 
-	xregfree(&garg.re);
+void
+s_load_port_plist(struct store_t *s, struct port_t *port)
+{
+	sc_load_port_plist(s->plist, port);
 }
 
 /***/
@@ -518,373 +363,203 @@ filter_ports_by_pfile(struct store_t *s, int should_have_matched,
 static void
 set_filenames(struct store_t *s)
 {
-	struct utsname	un;
-	/* number of characters to pick from the start of un.release */
-	int		release_chars;
-
-	if (uname(&un) == -1)
-		err(EX_OSERR, "uname()");
-
-	/* un.release is something like "10.1-BETA3", pick up "10" from it. */
-	release_chars = 0;
-	while (isdigit(un.release[release_chars])) {
-		release_chars++;
-	}
-
-	/* If un.release contains something unexpected, then pick it all. */
-	if (release_chars == 0) {
-		release_chars = strlen(un.release);
-	}
-
-	snprintf(s->dir, sizeof(s->dir), "%s/%.*s-%s",
-		 DBDIR, release_chars, un.release, un.machine);
-
-	snprintf(s->newdir, sizeof(s->newdir), "%s.new", s->dir);
-	snprintf(s->olddir, sizeof(s->olddir), "%s.old", s->dir);
-
-	snprintf(s->index_fn, sizeof(s->index_fn), "%s/index", s->dir);
-	snprintf(s->plist_fn, sizeof(s->plist_fn), "%s/plist", s->dir);
-
-	snprintf(s->index_new_fn, sizeof(s->index_new_fn), "%s/index", s->newdir);
-	snprintf(s->plist_new_fn, sizeof(s->plist_new_fn), "%s/plist", s->newdir);
+	sc_set_dirs(&s->d);
 
-	snprintf(s->index_old_fn, sizeof(s->index_old_fn), "%s/index", s->olddir);
-	snprintf(s->plist_old_fn, sizeof(s->plist_old_fn), "%s/plist", s->olddir);
+	snprintf(s->index_fn, sizeof(s->index_fn), "%s/index", s->d.dir);
+	snprintf(s->index_new_fn, sizeof(s->index_new_fn), "%s/index", s->d.newdir);
+	snprintf(s->index_old_fn, sizeof(s->index_old_fn), "%s/index", s->d.olddir);
 }
 
 static void
 load_index(struct store_t *s)
 {
-	char		rs[2] = {RSi, '\0'};
-	char		*raw_p;
-	char		*rec;
-	size_t		rec_idx;
-	size_t		i;
-	struct port_t	*cur_port;
+	struct sepscan_t	*ss = &s->scan;
+	struct txt_line_t	*line;
+	size_t			raw_sz;
+	size_t			lines_cnt;
+	size_t			start;
+	size_t			i, k;
+	int			f;
 
-	load_file(s->index_fn, &s->ports_raw);
+	raw_sz = sc_load_file(s->index_fn, &s->ports_raw);
 
-	s->ports.sz = records_cnt(s->ports_raw, RSi);
+	ss_start(ss);
+	ss_scan(ss, s->ports_raw, raw_sz, RSi, FSi);
 
-	s->ports.arr =
-	    (struct port_t **)xmalloc(s->ports.sz * sizeof(struct port_t *));
+	s->lines = (struct txt_line_t *)xmalloc(ss->rs_cnt *
+						sizeof(struct txt_line_t));
 
-	for (i = 0; i < s->ports.sz; i++)
-		s->ports.arr[i] =
-		    (struct port_t *)xmalloc(sizeof(struct port_t));
-
-	raw_p = s->ports_raw;
-
-	for (rec_idx = 0; (rec = strsep(&raw_p, rs)) != NULL; rec_idx++)
+	for (i = 0, k = 0, lines_cnt = 0, start = 0; i < ss->rs_cnt;
+	     start = ss->rs[i++] + 1)
 	{
-		if (rec[0] == '\0')
+		if (ss->rs[i] == start)
 			continue;
 
-		cur_port = s->ports.arr[rec_idx];
+		line = &s->lines[lines_cnt++];
 
-		cur_port->matched = 0;
+		line->id = (uint32_t)strtoul(s->ports_raw + start, NULL, 10);
+		line->offt = (uint32_t)start;
+		line->len = (uint32_t)(ss->rs[i] - start);
 
-		cur_port->indexln_raw = xstrchr(rec, FSi);
-		cur_port->indexln_raw[0] = '\0';
-		cur_port->indexln_raw++;
-		parse_indexln(cur_port);
-		cur_port->id = (unsigned)strtoul(rec, NULL, 10);
+		line->fs_first = (uint32_t)k;
+		while (k < ss->fs_cnt && ss->fs[k] < ss->rs[i])
+			k++;
+		line->fs_cnt = (uint32_t)(k - line->fs_first);
 	}
 
 	/* normally ports are loaded ordered, but just to make sure */
-	if (mergesort(s->ports.arr,
-		      s->ports.sz,
-		      sizeof(struct port_t **),
-		      ports_cmp) == -1)
+	if (mergesort(s->lines, lines_cnt, sizeof(struct txt_line_t),
+		      sc_ids_cmp) == -1)
 		err(EX_OSERR, "mergesort()");
-}
 
-static void
-free_index(struct store_t *s)
-{
-	size_t	i;
+	s->ids = (uint32_t *)xmalloc(lines_cnt * sizeof(uint32_t));
+	for (i = 0; i < lines_cnt; i++)
+		s->ids[i] = s->lines[i].id;
 
-	for (i = 0; i < s->ports.sz; i++)
-		if (s->ports.arr[i] != NULL)
-			xfree(s->ports.arr[i]);
+	sc_ports_start(&s->ports, s->ids, lines_cnt);
 
-	xfree(s->ports.arr);
-
-	free_file(s->ports_raw);
+	for (f = 0; f < PF_CNT; f++)
+		s->cols[f].state = TC_NONE;
 }
 
 static void
-load_file(const char *filename, char **raw)
+load_cols(struct store_t *s, int flds, const struct options_t *opts)
 {
-	int		fd;
-	struct stat	sb;
-	size_t		sz;
-	size_t		offt;
-	ssize_t		rd_len;
-
-	if ((fd = open(filename, O_RDONLY)) == -1)
-		err(EX_NOINPUT, "open(): %s", filename);
-
-	if (fstat(fd, &sb) == -1)
-		err(EX_OSERR, "fstat(): %s", filename);
-
-	sz = sb.st_size;
-
-	*raw = (char *)xmalloc(sz + 1);
-
-	offt = 0;
-
-	while ((rd_len = read(fd, *raw, sz - offt)) <= sz - offt)
+	struct txt_col_t	*col;
+	const struct txt_line_t	*line;
+	const char		*fld;
+	size_t			len;
+	size_t			pos;
+	size_t			i;
+	int			f;
+
+	for (f = 0; f < PF_CNT; f++)
 	{
-		if (rd_len == -1)
-			err(EX_IOERR, "read(): %s", filename);
-
-		if (rd_len == 0)
-			break;
-
-		offt += rd_len;
-	}
-
-	if (sz != offt)
-		errx(EX_PROTOCOL, "while reading %s: fstat returned %u bytes "
-		     "for file size but we got %u from it",
-		     filename, (unsigned)sz, (unsigned)offt);
-
-	(*raw)[sz] = '\0';
-
-	close(fd);
-}
-
-static void
-free_file(char *raw)
-{
-	xfree(raw);
-}
-
-static void
-gather_pfiles(char *line, void *arg_void)
-{
-	struct garg_t	*arg = (struct garg_t *)arg_void;
-
-	static unsigned	line_num = 0;
-
-	char		*portid;
-	struct port_t	*port;
-	char		*FSp_pos;
-	char		*filename;
-
-	line_num++;
-
-	if ((FSp_pos = strchr(line, FSp)) == NULL)
-		errx(EX_DATAERR, "corrupted datafile: %s: "
-		     "``%c'' not found on line %u",
-		     arg->store->plist_fn, FSp, line_num);
-
-	if (regexec(&arg->re, FSp_pos + 1, 0, NULL, 0) != 0)
-		return;
-
-	/* match */
-
-	/* split line into portid and filename */
-	filename = FSp_pos + 1;
-	FSp_pos[0] = '\0';
-	portid = line;
-
-	get_port_by_id(&arg->store->ports, portid, &port);
-
-	if (arg->should_have_matched && !port->matched)
-		return;
-
-	if ((port->matched & SEARCH_BY_PFILE) == 0)
-		v_start(&port->plist, 2);
-
-	port->matched |= SEARCH_BY_PFILE;
-
-	v_add(&port->plist, filename, strlen(filename) + 1);
-}
-
-static void
-get_port_by_id(struct ports_t *ports, const char *portid, struct port_t **port)
-{
-	struct port_t	key;
-	struct port_t	*key_p;
-	struct port_t	**res;
-
-	key_p = &key;
+		col = &s->cols[f];
 
-	key.id = (unsigned)strtoul(portid, NULL, 10);
-
-	res = (struct port_t **)bsearch(&key_p, ports->arr, ports->sz,
-					sizeof(struct port_t **), ports_cmp);
+		if ((flds & PF_BIT(f)) == 0 || col->state == TC_ALL ||
+		    (opts != NULL && col->state == TC_MATCHED))
+			continue;
 
-	if (res == NULL)
-		errx(EX_DATAERR, "corrupted database: port with id %u exists in "
-		     "plist file but not found in index file", key.id);
+		for (pos = 0; txt_flds[pos] != (enum port_fld)f; pos++)
+			;
 
-	*port = *res;
-}
+		if (col->state == TC_NONE)
+		{
+			col->strs = (struct port_str_t *)xmalloc(
+			    s->ports.sz * sizeof(struct port_str_t));
+			col->heap_sz = 65536;
+			col->heap = (char *)xmalloc(col->heap_sz);
+			col->fold = NULL;
+		}
 
-static size_t
-records_cnt(const char *content, char sep)
-{
-	const char	*ch;
-	size_t		cnt;
+		/* offset 0 is the empty string, shared by all empty fields */
+		col->heap[0] = '\0';
+		col->heap_len = 1;
 
-	for (cnt = 0, ch = content; *ch != '\0'; ch++)
-		if (*ch == sep)
-			cnt++;
+		for (i = 0; i < s->ports.sz; i++)
+		{
+			if (opts != NULL &&
+			    s->ports.matched[i] != opts->search_crit)
+				continue;
 
-	return cnt;
-}
+			line = &s->lines[i];
 
-static int
-ports_cmp(const void *p1v, const void *p2v)
-{
-	struct port_t	*p1;
-	struct port_t	*p2;
+			fld = find_fld(s, line, pos, &len);
 
-	p1 = *(struct port_t **)p1v;
-	p2 = *(struct port_t **)p2v;
+			if (fld == NULL || len == 0)
+			{
+				col->strs[i].offt = 0;
+				col->strs[i].len = 0;
+				continue;
+			}
 
-	if (p1 == NULL && p2 == NULL)
-		return 0;
-	if (p1 == NULL)
-		return -1;
-	if (p2 == NULL)
-		return 1;
-
-	if (p1->id < p2->id)
-		return -1;
-	if (p1->id > p2->id)
-		return 1;
-	return 0;
-}
+			while (col->heap_len + len + 1 > col->heap_sz)
+			{
+				col->heap_sz *= 2;
+				if ((col->heap = realloc(col->heap, col->heap_sz))
+				    == NULL)
+					err(EX_OSERR, "realloc(): %u",
+					    (unsigned)col->heap_sz);
+			}
 
-int
-s_load_port_by_path(struct store_t *s, const char *path, struct port_t **port)
-{
-	size_t	i;
+			memcpy(col->heap + col->heap_len, fld, len);
+			col->heap[col->heap_len + len] = '\0';
 
-	for (i = 0; i < s->ports.sz; i++)
-	{
-		if (s->ports.arr[i] == NULL)
-			continue;
+			col->strs[i].offt = (uint32_t)col->heap_len;
+			col->strs[i].len = (uint32_t)len;
 
-		if (strcmp(s->ports.arr[i]->path, path) == 0)
-		{
-			*port = s->ports.arr[i];
-			return 0;
+			col->heap_len += len + 1;
 		}
-	}
-
-	return -1;
-}
-
-void
-s_load_port_plist(struct store_t *s, struct port_t *port)
-{
-	struct pline_t	search_pline;
-	struct pline_t	*found_pline;
-	struct pline_t	*p;
-
-	search_pline.portid = port->id;
-
-	found_pline = (struct pline_t *)bsearch(&search_pline,
-						s->plist->plines,
-						s->plist->plines_cnt,
-						sizeof(struct pline_t),
-						plines_cmp);
 
-	if (found_pline != NULL)
-	{
-		for (p = found_pline - 1; p->portid == port->id; p--)
-			v_add(&port->plist, p->pfile, strlen(p->pfile) + 1);
+		col->state = opts != NULL ? TC_MATCHED : TC_ALL;
 
-		for (p = found_pline; p->portid == port->id; p++)
-			v_add(&port->plist, p->pfile, strlen(p->pfile) + 1);
+		/* the heap may have moved */
+		s->ports.cols[f].strs = col->strs;
+		s->ports.cols[f].heap = col->heap;
+		s->ports.cols[f].fold = col->fold;
 	}
 }
 
 static void
-load_plist(struct store_t *s)
+fold_cols(struct store_t *s, int flds)
 {
-	char	rs[2] = {RSp, '\0'};
-	char	fs[2] = {FSp, '\0'};
-	char	*raw_p, *rec, *portid;
-	size_t	rec_idx;
-
-	s->plist = (struct plist_t *)xmalloc(sizeof(struct plist_t));
-
-	load_file(s->plist_fn, &s->plist->raw);
+	struct txt_col_t	*col;
+	int			f;
 
-	s->plist->plines_cnt = records_cnt(s->plist->raw, RSp);
-
-	s->plist->plines = (struct pline_t *)xmalloc(s->plist->plines_cnt *
-						     sizeof(struct pline_t));
-
-	raw_p = s->plist->raw;
-
-	for (rec_idx = 0; (rec = strsep(&raw_p, rs)) != NULL; rec_idx++)
+	for (f = 0; f < PF_CNT; f++)
 	{
-		if (rec[0] == '\0')
-			continue;
+		col = &s->cols[f];
 
-		portid = strsep(&rec, fs);
+		if ((flds & PF_BIT(f)) == 0 || col->state != TC_ALL ||
+		    col->fold != NULL)
+			continue;
 
-		s->plist->plines[rec_idx].portid =
-			(unsigned)strtoull(portid, NULL, 10);
+		col->fold = (char *)xmalloc(col->heap_len);
+		m_fold(col->fold, col->heap, col->heap_len);
 
-		s->plist->plines[rec_idx].pfile = rec;
+		s->ports.cols[f].fold = col->fold;
 	}
-
-	/* normally plist is loaded ordered, but just to make sure */
-	if (mergesort(s->plist->plines,
-		      s->plist->plines_cnt,
-		      sizeof(struct pline_t),
-		      plines_cmp) == -1)
-		err(EX_OSERR, "mergesort()");
 }
 
-static void
-free_plist(struct store_t *s)
+static const char *
+find_fld(const struct store_t *s, const struct txt_line_t *line, size_t pos,
+	 size_t *len)
 {
-	xfree(s->plist->plines);
+	const uint32_t	*fs = &s->scan.fs[line->fs_first];
+	size_t		end;
 
-	free_file(s->plist->raw);
+	/* the field follows separator number `pos', the first ends the id */
+	if (pos >= line->fs_cnt)
+		return NULL;
 
-	xfree(s->plist);
-}
-
-static int
-plines_cmp(const void *l1v, const void *l2v)
-{
-	struct pline_t	*l1;
-	struct pline_t	*l2;
+	end = pos + 1 < line->fs_cnt ? fs[pos + 1] : line->offt + line->len;
 
-	l1 = (struct pline_t *)l1v;
-	l2 = (struct pline_t *)l2v;
+	*len = end - fs[pos] - 1;
 
-	if (l1->portid < l2->portid)
-		return -1;
-	if (l1->portid > l2->portid)
-		return 1;
-	return 0;
+	return s->ports_raw + fs[pos] + 1;
 }
 
 static void
-rm_olddir(const struct store_t *s)
+free_index(struct store_t *s)
 {
-	const char	*ents[] = {s->index_old_fn, s->plist_old_fn};
-	int		i;
+	int	f;
+
+	sc_ports_end(&s->ports);
+
+	for (f = 0; f < PF_CNT; f++)
+		if (s->cols[f].state != TC_NONE)
+		{
+			xfree(s->cols[f].strs);
+			xfree(s->cols[f].heap);
+			xfree(s->cols[f].fold);
+		}
 
-	for (i = 0; i < sizeof(ents) / sizeof(const char *); i++)
-		if (unlink(ents[i]) == -1)
-			if (errno != ENOENT)
-				err(EX_UNAVAILABLE, "unlink(): %s", ents[i]);
+	xfree(s->ids);
+	xfree(s->lines);
+	ss_destroy(&s->scan);
 
-	if (rmdir(s->olddir) == -1)
-		if (errno != ENOENT)
-			err(EX_UNAVAILABLE, "rmdir(): %s", s->olddir);
+	sc_free_file(s->ports_raw);
 }
 
 /* EOF */
@@ -0,0 +1,883 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <ctype.h>
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include "trigram.h"
+#include "xlibc.h"
+
+#define TRI_MAGIC	"PSTRIGRM"
+#define TRI_MAGIC_LEN	8
+#define TRI_VERSION	1
+
+/* lowercase ASCII letters, the index is case insensitive */
+#define TRI_FOLD(c)	((c) >= 'A' && (c) <= 'Z' ? (c) - 'A' + 'a' : (c))
+
+#define TRI_KEY(p)	\
+	((uint32_t)TRI_FOLD((unsigned char)(p)[0]) << 16 | \
+	 (uint32_t)TRI_FOLD((unsigned char)(p)[1]) << 8 | \
+	 (uint32_t)TRI_FOLD((unsigned char)(p)[2]))
+
+/* keys are 24 bit, so this never collides with a real one */
+#define TRI_EMPTY	UINT32_MAX
+
+/*
+ * On-disk layout: header, line offsets (lines_cnt + 1 entries, the last
+ * one being the plist size), directory of trigrams sorted by key and
+ * the posting lists. A posting list is a sequence of line numbers, each
+ * stored as a varint delta from the previous one plus one.
+ */
+struct tri_hdr_t {
+	char		magic[TRI_MAGIC_LEN];
+	uint32_t	version;
+	uint32_t	hdr_sz;  /* sizeof(struct tri_hdr_t) */
+	uint32_t	plist_sz;
+	uint32_t	lines_cnt;
+	uint32_t	ents_cnt;
+	uint32_t	lines_offt;
+	uint32_t	ents_offt;
+	uint32_t	post_offt;
+	uint32_t	post_sz;
+};
+
+struct tri_ent_t {
+	uint32_t	key;
+	uint32_t	cnt;  /* number of lines in the posting list */
+	uint32_t	offt;  /* from the start of the posting lists */
+};
+
+/* hash table bucket used while building the index */
+struct tri_bucket_t {
+	uint32_t	key;
+	uint32_t	last;  /* last line added to post, plus one */
+	uint32_t	cnt;
+	uint8_t		*post;
+	size_t		post_len;
+	size_t		post_sz;
+};
+
+struct tri_new_t {
+	struct tri_bucket_t	*tab;
+	unsigned		tab_bits;
+	size_t			used;
+
+	uint32_t		*lines;
+	size_t			lines_cnt;
+	size_t			lines_sz;
+};
+
+struct tri_t {
+	void			*map;
+	size_t			map_sz;
+	const struct tri_hdr_t	*hdr;
+	const uint32_t		*lines;
+	const struct tri_ent_t	*ents;
+	const uint8_t		*post;
+};
+
+/*
+ * Return the bucket for `key', creating it if necessary
+ */
+static struct tri_bucket_t *tab_get(struct tri_new_t *t, uint32_t key);
+
+/*
+ * Double the size of the hash table
+ */
+static void tab_grow(struct tri_new_t *t);
+
+/*
+ * Append `val' to the posting list of `b' in varint encoding
+ */
+static void post_add(struct tri_bucket_t *b, uint32_t val);
+
+/*
+ * Decode a varint at `*p', not going past `end'
+ */
+static uint32_t post_get(const uint8_t **p, const uint8_t *end);
+
+/*
+ * Compare 2 buckets/entries/keys according to their keys/sizes
+ */
+static int buckets_cmp(const void *b1v, const void *b2v);
+static int ents_key_cmp(const void *keyv, const void *entv);
+static int ents_cnt_cmp(const void *e1v, const void *e2v);
+static int keys_cmp(const void *k1v, const void *k2v);
+
+/*
+ * Return nonzero if `pattern' has an alternation outside of any
+ * parenthesized subexpression
+ */
+static int has_top_alternation(const char *pattern);
+
+/*
+ * Skip a bracket expression or a parenthesized subexpression starting at
+ * `p', return pointer to the first character after it
+ */
+static const char *skip_bracket(const char *p);
+static const char *skip_group(const char *p);
+
+/*
+ * Add the trigrams of `run' to `keys'
+ */
+static void run_trigrams(const char *run, size_t run_len,
+			 uint32_t *keys, size_t *keys_cnt);
+
+/***/
+
+void
+tri_new_start(struct tri_new_t **tp)
+{
+	struct tri_new_t	*t;
+	size_t			i;
+
+	t = (struct tri_new_t *)xmalloc(sizeof(struct tri_new_t));
+
+	t->tab_bits = 16;
+	t->tab = (struct tri_bucket_t *)xmalloc(
+	    ((size_t)1 << t->tab_bits) * sizeof(struct tri_bucket_t));
+	for (i = 0; i < (size_t)1 << t->tab_bits; i++)
+		t->tab[i].key = TRI_EMPTY;
+	t->used = 0;
+
+	t->lines_sz = 65536;
+	t->lines = (uint32_t *)xmalloc(t->lines_sz * sizeof(uint32_t));
+	t->lines_cnt = 0;
+
+	*tp = t;
+}
+
+void
+tri_new_add(struct tri_new_t *t, const char *pfile, size_t offt)
+{
+	struct tri_bucket_t	*b;
+	uint32_t		line;
+	size_t			realloc_bytes;
+	const char		*p;
+
+	if (t->lines_cnt >= t->lines_sz)
+	{
+		t->lines_sz *= 2;
+		realloc_bytes = t->lines_sz * sizeof(uint32_t);
+		if ((t->lines = realloc(t->lines, realloc_bytes)) == NULL)
+			err(EX_OSERR, "realloc(): %u", (unsigned)realloc_bytes);
+	}
+
+	line = (uint32_t)t->lines_cnt;
+	t->lines[t->lines_cnt++] = (uint32_t)offt;
+
+	if (pfile[0] == '\0' || pfile[1] == '\0')
+		return;
+
+	for (p = pfile; p[2] != '\0'; p++)
+	{
+		b = tab_get(t, TRI_KEY(p));
+
+		/* already recorded for this line */
+		if (b->last == line + 1)
+			continue;
+
+		post_add(b, line + 1 - b->last);
+		b->last = line + 1;
+		b->cnt++;
+	}
+}
+
+void
+tri_new_end(struct tri_new_t *t, size_t plist_sz, const char *fn)
+{
+	struct tri_hdr_t	hdr;
+	struct tri_ent_t	ent;
+	struct tri_bucket_t	*b;
+	FILE			*fp;
+	size_t			tab_sz;
+	size_t			i, n;
+	size_t			post_sz;
+	uint32_t		sentinel;
+
+	tab_sz = (size_t)1 << t->tab_bits;
+
+	/* move used buckets to the front and sort them */
+	for (i = 0, n = 0; i < tab_sz; i++)
+		if (t->tab[i].key != TRI_EMPTY)
+			t->tab[n++] = t->tab[i];
+
+	qsort(t->tab, n, sizeof(struct tri_bucket_t), buckets_cmp);
+
+	post_sz = 0;
+	for (i = 0; i < n; i++)
+		post_sz += t->tab[i].post_len;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, TRI_MAGIC, TRI_MAGIC_LEN);
+	hdr.version = TRI_VERSION;
+	hdr.hdr_sz = sizeof(struct tri_hdr_t);
+	hdr.plist_sz = (uint32_t)plist_sz;
+	hdr.lines_cnt = (uint32_t)t->lines_cnt;
+	hdr.ents_cnt = (uint32_t)n;
+	hdr.lines_offt = sizeof(struct tri_hdr_t);
+	hdr.ents_offt = hdr.lines_offt + (t->lines_cnt + 1) * sizeof(uint32_t);
+	hdr.post_offt = hdr.ents_offt + n * sizeof(struct tri_ent_t);
+	hdr.post_sz = (uint32_t)post_sz;
+
+	/*
+	 * Offsets are 32 bit, do not create an index for a plist file that
+	 * does not fit, searching will go through all lines then.
+	 */
+	if (plist_sz <= UINT32_MAX &&
+	    (uint64_t)hdr.post_offt + post_sz <= UINT32_MAX)
+	{
+		if ((fp = fopen(fn, "w")) == NULL)
+			err(EX_CANTCREAT, "fopen(): %s", fn);
+
+		sentinel = (uint32_t)plist_sz;
+
+		if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+		    fwrite(t->lines, sizeof(uint32_t), t->lines_cnt, fp)
+		    != t->lines_cnt ||
+		    fwrite(&sentinel, sizeof(sentinel), 1, fp) != 1)
+			err(EX_IOERR, "fwrite(): %s", fn);
+
+		for (i = 0, post_sz = 0; i < n; i++)
+		{
+			ent.key = t->tab[i].key;
+			ent.cnt = t->tab[i].cnt;
+			ent.offt = (uint32_t)post_sz;
+			if (fwrite(&ent, sizeof(ent), 1, fp) != 1)
+				err(EX_IOERR, "fwrite(): %s", fn);
+			post_sz += t->tab[i].post_len;
+		}
+
+		for (i = 0; i < n; i++)
+		{
+			b = &t->tab[i];
+			if (fwrite(b->post, 1, b->post_len, fp) != b->post_len)
+				err(EX_IOERR, "fwrite(): %s", fn);
+		}
+
+		xfclose(fp, fn);
+	}
+
+	for (i = 0; i < n; i++)
+		xfree(t->tab[i].post);
+	xfree(t->tab);
+	xfree(t->lines);
+	xfree(t);
+}
+
+static struct tri_bucket_t *
+tab_get(struct tri_new_t *t, uint32_t key)
+{
+	struct tri_bucket_t	*b;
+	size_t			mask;
+	size_t			i;
+
+	mask = ((size_t)1 << t->tab_bits) - 1;
+
+	for (i = (key * 0x9E3779B1u) >> (32 - t->tab_bits);
+	     ; i = (i + 1) & mask)
+	{
+		b = &t->tab[i];
+
+		if (b->key == key)
+			return b;
+
+		if (b->key == TRI_EMPTY)
+			break;
+	}
+
+	/* keep the load factor below 1/2 */
+	if ((t->used + 1) * 2 > mask + 1)
+	{
+		tab_grow(t);
+		return tab_get(t, key);
+	}
+
+	b->key = key;
+	b->last = 0;
+	b->cnt = 0;
+	b->post_sz = 8;
+	b->post = (uint8_t *)xmalloc(b->post_sz);
+	b->post_len = 0;
+
+	t->used++;
+
+	return b;
+}
+
+static void
+tab_grow(struct tri_new_t *t)
+{
+	struct tri_bucket_t	*old;
+	size_t			old_sz;
+	size_t			mask;
+	size_t			i, ii;
+
+	old = t->tab;
+	old_sz = (size_t)1 << t->tab_bits;
+
+	t->tab_bits++;
+	mask = ((size_t)1 << t->tab_bits) - 1;
+
+	t->tab = (struct tri_bucket_t *)xmalloc(
+	    (mask + 1) * sizeof(struct tri_bucket_t));
+	for (i = 0; i <= mask; i++)
+		t->tab[i].key = TRI_EMPTY;
+
+	for (i = 0; i < old_sz; i++)
+	{
+		if (old[i].key == TRI_EMPTY)
+			continue;
+
+		for (ii = (old[i].key * 0x9E3779B1u) >> (32 - t->tab_bits);
+		     t->tab[ii].key != TRI_EMPTY;
+		     ii = (ii + 1) & mask)
+			;
+
+		t->tab[ii] = old[i];
+	}
+
+	xfree(old);
+}
+
+static void
+post_add(struct tri_bucket_t *b, uint32_t val)
+{
+	/* a varint of a 32 bit value takes at most 5 bytes */
+	if (b->post_len + 5 > b->post_sz)
+	{
+		b->post_sz *= 2;
+		if ((b->post = realloc(b->post, b->post_sz)) == NULL)
+			err(EX_OSERR, "realloc(): %u", (unsigned)b->post_sz);
+	}
+
+	while (val >= 0x80)
+	{
+		b->post[b->post_len++] = (uint8_t)(val | 0x80);
+		val >>= 7;
+	}
+	b->post[b->post_len++] = (uint8_t)val;
+}
+
+static uint32_t
+post_get(const uint8_t **p, const uint8_t *end)
+{
+	uint32_t	val;
+	unsigned	shift;
+
+	val = 0;
+	for (shift = 0; *p < end && shift < 35; shift += 7)
+	{
+		val |= (uint32_t)(**p & 0x7f) << shift;
+		if ((*(*p)++ & 0x80) == 0)
+			break;
+	}
+
+	return val;
+}
+
+static int
+buckets_cmp(const void *b1v, const void *b2v)
+{
+	const struct tri_bucket_t	*b1 = (const struct tri_bucket_t *)b1v;
+	const struct tri_bucket_t	*b2 = (const struct tri_bucket_t *)b2v;
+
+	if (b1->key < b2->key)
+		return -1;
+	if (b1->key > b2->key)
+		return 1;
+	return 0;
+}
+
+/***/
+
+int
+tri_open(struct tri_t **tp, const char *fn, size_t plist_sz)
+{
+	struct tri_t		*t;
+	const struct tri_hdr_t	*hdr;
+	int			fd;
+	struct stat		sb;
+	void			*map;
+
+	if ((fd = open(fn, O_RDONLY)) == -1)
+	{
+		if (errno == ENOENT)
+			return -1;
+		err(EX_NOINPUT, "open(): %s", fn);
+	}
+
+	if (fstat(fd, &sb) == -1)
+		err(EX_OSERR, "fstat(): %s", fn);
+
+	if ((size_t)sb.st_size < sizeof(struct tri_hdr_t))
+	{
+		close(fd);
+		return -1;
+	}
+
+	if ((map = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0))
+	    == MAP_FAILED)
+		err(EX_OSERR, "mmap(): %s", fn);
+
+	close(fd);
+
+	hdr = (const struct tri_hdr_t *)map;
+
+	/* an index from another version or for another plist is useless */
+	if (memcmp(hdr->magic, TRI_MAGIC, TRI_MAGIC_LEN) != 0 ||
+	    hdr->version != TRI_VERSION ||
+	    hdr->hdr_sz != sizeof(struct tri_hdr_t) ||
+	    hdr->plist_sz != plist_sz ||
+	    hdr->lines_offt != sizeof(struct tri_hdr_t) ||
+	    hdr->ents_offt != hdr->lines_offt +
+	    ((size_t)hdr->lines_cnt + 1) * sizeof(uint32_t) ||
+	    hdr->post_offt != hdr->ents_offt +
+	    (size_t)hdr->ents_cnt * sizeof(struct tri_ent_t) ||
+	    (size_t)hdr->post_offt + hdr->post_sz != (size_t)sb.st_size)
+	{
+		munmap(map, sb.st_size);
+		return -1;
+	}
+
+	t = (struct tri_t *)xmalloc(sizeof(struct tri_t));
+
+	t->map = map;
+	t->map_sz = sb.st_size;
+	t->hdr = hdr;
+	t->lines = (const uint32_t *)((const char *)map + hdr->lines_offt);
+	t->ents = (const struct tri_ent_t *)((const char *)map + hdr->ents_offt);
+	t->post = (const uint8_t *)map + hdr->post_offt;
+
+	*tp = t;
+
+	return 0;
+}
+
+void
+tri_close(struct tri_t *t)
+{
+	if (munmap(t->map, t->map_sz) == -1)
+		err(EX_OSERR, "munmap()");
+
+	xfree(t);
+}
+
+void
+tri_line(const struct tri_t *t, uint32_t line, size_t *offt, size_t *len)
+{
+	*offt = t->lines[line];
+	*len = t->lines[line + 1] - t->lines[line] - 1;
+}
+
+int
+tri_candidates(const struct tri_t *t, const char *pattern,
+	       uint32_t **lines_p, size_t *cnt_p)
+{
+	uint32_t		*keys;
+	size_t			keys_cnt;
+	const struct tri_ent_t	**ents;
+	const struct tri_ent_t	*ent;
+	const uint8_t		*p, *end;
+	uint32_t		*lines;
+	uint32_t		cur;
+	size_t			cnt, n, i, ii, k;
+
+	if (tri_pattern_keys(pattern, &keys, &keys_cnt) == -1)
+		return -1;
+
+	ents = (const struct tri_ent_t **)xmalloc(keys_cnt *
+						  sizeof(struct tri_ent_t *));
+
+	for (k = 0; k < keys_cnt; k++)
+	{
+		ents[k] = (const struct tri_ent_t *)bsearch(&keys[k], t->ents,
+		    t->hdr->ents_cnt, sizeof(struct tri_ent_t), ents_key_cmp);
+
+		/* a required trigram does not occur anywhere */
+		if (ents[k] == NULL || ents[k]->offt > t->hdr->post_sz)
+		{
+			xfree(ents);
+			xfree(keys);
+			*lines_p = (uint32_t *)xmalloc(sizeof(uint32_t));
+			*cnt_p = 0;
+			return 0;
+		}
+	}
+
+	/* start with the shortest list, so that the result is small early */
+	qsort(ents, keys_cnt, sizeof(struct tri_ent_t *), ents_cnt_cmp);
+
+	ent = ents[0];
+	lines = (uint32_t *)xmalloc((ent->cnt + 1) * sizeof(uint32_t));
+	p = t->post + ent->offt;
+	end = t->post + t->hdr->post_sz;
+	for (cnt = 0, cur = 0; cnt < ent->cnt && p < end; cnt++)
+	{
+		cur += post_get(&p, end);
+		lines[cnt] = cur - 1;
+	}
+
+	/* intersect with the rest */
+	for (k = 1; k < keys_cnt && cnt > 0; k++)
+	{
+		ent = ents[k];
+		p = t->post + ent->offt;
+		cur = 0;  /* last decoded line plus one */
+		ii = 0;  /* number of decoded lines */
+		n = 0;  /* number of lines kept */
+
+		for (i = 0; i < cnt; i++)
+		{
+			while (cur < lines[i] + 1 && ii < ent->cnt && p < end)
+			{
+				cur += post_get(&p, end);
+				ii++;
+			}
+
+			if (cur == lines[i] + 1)
+				lines[n++] = lines[i];
+			else if (cur < lines[i] + 1)
+				break;  /* this list is exhausted */
+		}
+
+		cnt = n;
+	}
+
+	xfree(ents);
+	xfree(keys);
+
+	*lines_p = lines;
+	*cnt_p = cnt;
+
+	return 0;
+}
+
+static int
+ents_key_cmp(const void *keyv, const void *entv)
+{
+	uint32_t		key = *(const uint32_t *)keyv;
+	const struct tri_ent_t	*ent = (const struct tri_ent_t *)entv;
+
+	if (key < ent->key)
+		return -1;
+	if (key > ent->key)
+		return 1;
+	return 0;
+}
+
+static int
+ents_cnt_cmp(const void *e1v, const void *e2v)
+{
+	const struct tri_ent_t	*e1 = *(const struct tri_ent_t **)e1v;
+	const struct tri_ent_t	*e2 = *(const struct tri_ent_t **)e2v;
+
+	if (e1->cnt < e2->cnt)
+		return -1;
+	if (e1->cnt > e2->cnt)
+		return 1;
+	return 0;
+}
+
+static int
+keys_cmp(const void *k1v, const void *k2v)
+{
+	uint32_t	k1 = *(const uint32_t *)k1v;
+	uint32_t	k2 = *(const uint32_t *)k2v;
+
+	if (k1 < k2)
+		return -1;
+	if (k1 > k2)
+		return 1;
+	return 0;
+}
+
+/***/
+
+int
+tri_pattern_keys(const char *pattern, uint32_t **keys_p, size_t *keys_cnt_p)
+{
+	char		*run;
+	size_t		run_len;
+	uint32_t	*keys;
+	size_t		keys_cnt;
+	size_t		i, n;
+	const char	*p, *q;
+	/* the last character in `run' is the last atom seen */
+	int		last_lit;
+	char		c;
+
+	if (has_top_alternation(pattern))
+		return -1;
+
+	run = (char *)xmalloc(strlen(pattern) + 1);
+	run_len = 0;
+	last_lit = 0;
+
+	/* there cannot be more trigrams than characters */
+	keys = (uint32_t *)xmalloc((strlen(pattern) + 1) * sizeof(uint32_t));
+	keys_cnt = 0;
+
+#define FLUSH_RUN()	do { \
+		run_trigrams(run, run_len, keys, &keys_cnt); \
+		run_len = 0; \
+		last_lit = 0; \
+	} while (0)
+
+	for (p = pattern; *p != '\0'; )
+		switch (*p)
+		{
+		case '\\':
+			if (p[1] != '\0' && !isalnum((unsigned char)p[1]) &&
+			    strchr("<>`'", p[1]) == NULL)
+			{
+				run[run_len++] = p[1];
+				last_lit = 1;
+				p += 2;
+				break;
+			}
+			/* things like \<, \` or \w are not literals */
+			FLUSH_RUN();
+			p += p[1] != '\0' ? 2 : 1;
+			break;
+		case '*':
+		case '+':
+		case '?':
+		case '{':
+			/* a sequence of repetition operators */
+			for (q = p; *q == '*' || *q == '+' || *q == '?' ||
+			     *q == '{'; )
+				if (*q == '{')
+				{
+					if ((q = strchr(q, '}')) == NULL)
+						q = p + strlen(p);
+					else
+						q++;
+				}
+				else
+					q++;
+
+			if (q == p + 1 && *p == '+' && last_lit)
+			{
+				/*
+				 * The atom is there at least once, but
+				 * what follows it is not necessarily
+				 * adjacent to what precedes it.
+				 */
+				c = run[run_len - 1];
+				FLUSH_RUN();
+				run[run_len++] = c;
+				last_lit = 1;
+			}
+			else if (q == p + 1 && *p == '+')
+				FLUSH_RUN();
+			else
+			{
+				/* the atom is optional */
+				if (last_lit)
+					run_len--;
+				FLUSH_RUN();
+			}
+
+			p = q;
+			break;
+		case '[':
+			FLUSH_RUN();
+			p = skip_bracket(p);
+			break;
+		case '(':
+			FLUSH_RUN();
+			p = skip_group(p);
+			break;
+		case ')':
+		case '.':
+		case '^':
+		case '$':
+			FLUSH_RUN();
+			p++;
+			break;
+		default:
+			run[run_len++] = *p++;
+			last_lit = 1;
+		}
+
+	FLUSH_RUN();
+
+#undef FLUSH_RUN
+
+	xfree(run);
+
+	if (keys_cnt == 0)
+	{
+		xfree(keys);
+		return -1;
+	}
+
+	/* remove duplicates */
+	qsort(keys, keys_cnt, sizeof(uint32_t), keys_cmp);
+	for (i = 1, n = 1; i < keys_cnt; i++)
+		if (keys[i] != keys[n - 1])
+			keys[n++] = keys[i];
+
+	*keys_p = keys;
+	*keys_cnt_p = n;
+
+	return 0;
+}
+
+size_t
+tri_str_keys(const char *str, size_t len, uint32_t *keys)
+{
+	size_t	i;
+
+	for (i = 0; i + 3 <= len; i++)
+		keys[i] = TRI_KEY(str + i);
+
+	return i;
+}
+
+static int
+has_top_alternation(const char *pattern)
+{
+	const char	*p;
+	int		depth;
+
+	for (p = pattern, depth = 0; *p != '\0'; )
+		switch (*p)
+		{
+		case '\\':
+			p += p[1] != '\0' ? 2 : 1;
+			break;
+		case '[':
+			p = skip_bracket(p);
+			break;
+		case '(':
+			depth++;
+			p++;
+			break;
+		case ')':
+			if (depth > 0)
+				depth--;
+			p++;
+			break;
+		case '|':
+			if (depth == 0)
+				return 1;
+			p++;
+			break;
+		default:
+			p++;
+		}
+
+	return 0;
+}
+
+static const char *
+skip_bracket(const char *p)
+{
+	const char	*q;
+	char		end[3];
+
+	q = p + 1;
+
+	if (*q == '^')
+		q++;
+	/* a leading ] is a literal */
+	if (*q == ']')
+		q++;
+
+	while (*q != '\0' && *q != ']')
+		if (*q == '[' && (q[1] == ':' || q[1] == '=' || q[1] == '.'))
+		{
+			/* [:class:], [=equiv=] or [.coll.] */
+			end[0] = q[1];
+			end[1] = ']';
+			end[2] = '\0';
+			if ((q = strstr(q + 2, end)) == NULL)
+				return p + strlen(p);
+			q += 2;
+		}
+		else
+			q++;
+
+	return *q == ']' ? q + 1 : q;
+}
+
+static const char *
+skip_group(const char *p)
+{
+	const char	*q;
+	int		depth;
+
+	for (q = p, depth = 0; *q != '\0'; )
+		switch (*q)
+		{
+		case '\\':
+			q += q[1] != '\0' ? 2 : 1;
+			break;
+		case '[':
+			q = skip_bracket(q);
+			break;
+		case '(':
+			depth++;
+			q++;
+			break;
+		case ')':
+			q++;
+			if (--depth == 0)
+				return q;
+			break;
+		default:
+			q++;
+		}
+
+	return q;
+}
+
+static void
+run_trigrams(const char *run, size_t run_len, uint32_t *keys,
+	     size_t *keys_cnt)
+{
+	size_t	i;
+
+	for (i = 0; i + 3 <= run_len; i++)
+		keys[(*keys_cnt)++] = TRI_KEY(run + i);
+}
+
+/* EOF */
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Trigram index over the filenames in the plist file. For every distinct
+ * (ASCII lowercased) sequence of 3 bytes it keeps the sorted list of plist
+ * lines that contain it, so lines that cannot match a pattern with a long
+ * enough literal part need not be looked at.
+ */
+
+#ifndef TRIGRAM_H
+#define TRIGRAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+struct tri_new_t;
+struct tri_t;
+
+/* index creation */
+
+/*
+ * Start building a new index
+ */
+void tri_new_start(struct tri_new_t **t);
+
+/*
+ * Add the next plist line to the index, `pfile' is the filename part
+ * of the line and `offt' is the offset of the line in the plist file
+ */
+void tri_new_add(struct tri_new_t *t, const char *pfile, size_t offt);
+
+/*
+ * Write the index to `fn' and free `t', `plist_sz' is the size of the
+ * plist file, used to detect an index that does not belong to it
+ */
+void tri_new_end(struct tri_new_t *t, size_t plist_sz, const char *fn);
+
+/* index usage */
+
+/*
+ * Open index `fn' for the plist file which is `plist_sz' bytes long.
+ * Return -1 if the index does not exist or does not match the plist file.
+ */
+int tri_open(struct tri_t **t, const char *fn, size_t plist_sz);
+
+/*
+ * Free resources allocated by tri_open()
+ */
+void tri_close(struct tri_t *t);
+
+/*
+ * Get the offset and the length (without the record separator)
+ * of line number `line' in the plist file
+ */
+void tri_line(const struct tri_t *t, uint32_t line, size_t *offt,
+	      size_t *len);
+
+/*
+ * Find the lines that may match the extended regular expression
+ * `pattern'. On success `*lines' is set to a malloc'ed, sorted array of
+ * `*cnt' line numbers and 0 is returned. If no literal of at least 3
+ * characters can be extracted from `pattern' -1 is returned and
+ * every line has to be examined.
+ */
+int tri_candidates(const struct tri_t *t, const char *pattern,
+		   uint32_t **lines, size_t *cnt);
+
+/* trigram keys, also used by the per port summaries in plistidx */
+
+/*
+ * Store the keys of the trigrams of `str', which is `len' bytes long, in
+ * `keys', which must have room for `len' elements. Return their number.
+ */
+size_t tri_str_keys(const char *str, size_t len, uint32_t *keys);
+
+/*
+ * Extract the keys of the trigrams that every string matching the
+ * extended regular expression `pattern' must contain. On success `*keys'
+ * is set to a malloc'ed, sorted array of `*cnt' distinct keys and 0 is
+ * returned. Return -1 if there are none.
+ */
+int tri_pattern_keys(const char *pattern, uint32_t **keys, size_t *cnt);
+
+#endif  /* TRIGRAM_H */
+
+/* EOF */
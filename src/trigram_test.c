@@ -0,0 +1,360 @@
+/*
+ * Copyright 2026 Vasil Dimov
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Check that the trigrams tri_pattern_keys() extracts from a pattern are
+ * really contained in every string the pattern matches, so the trigram
+ * index never drops a line that should have been found, and that
+ * tri_candidates() returns all matching lines of a small index.
+ * Exits with 1 if any check fails.
+ *
+ * usage: trigram_test
+ */
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+#include <err.h>
+#include <regex.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include "trigram.h"
+#include "xlibc.h"
+
+/* lines of the plist, each pattern below matches at least one of them */
+static const char *const	lines[] = {
+	"bin/port0001",
+	"bin/port0012",
+	"share/doc/port0001/README",
+	"share/doc/Port0002/readme.txt",
+	"lib/libfoo.so.1",
+	"lib/libbar.so.12",
+	"lib/libbaz.a",
+	"include/c++/v1/vector",
+	"share/man/man1/ls.1.gz",
+	"share/man/man8/ntpd.8.gz",
+	"etc/rc.d/ntpd",
+	"etc/rc.d/ntpdate",
+	"share/Weird|Pipe/File",
+	"share/weird/xxx",
+	"share/examples/Foo Bar/x.txt",
+	"lib/perl5/site_perl/A/B.pm",
+	"lib/perl/site_perl/C.pm",
+	"libexec/a+b",
+	"libexec/abc?d",
+	"share/data[1].dat",
+	"share/data2.dat",
+	"share/color/colour",
+	"share/color/color",
+	"share/abcccde",
+	"share/abbcde",
+	"share/abbcd",
+	"share/ade",
+	"share/aaaabcd",
+	"share/a.b/c^d$e",
+	"share/back\\slash",
+	"www/x.html",
+	"www/ab/cd",
+};
+
+#define LINES_CNT	(sizeof(lines) / sizeof(lines[0]))
+
+/* a pattern and whether trigrams must be found in it */
+struct pattern_t {
+	const char	*pattern;
+	int		has_keys;
+};
+
+static const struct pattern_t	patterns[] = {
+	/* plain literals */
+	{"port0001", 1},
+	{"README", 1},
+	{"Foo Bar", 1},
+	/* anchors */
+	{"^bin/port", 1},
+	{"README$", 1},
+	{"(^|/)ntpd$", 1},
+	{"^etc/rc\\.d/ntpd$", 1},
+	/* alternation */
+	{"abc|xyz", 0},
+	{"libfoo|libbar", 0},
+	{"lib(foo|bar)\\.so", 1},
+	{"(man1|man8)/", 0},
+	{"share/(doc|examples)/", 1},
+	{"rc\\.d/ntp(d|date)$", 1},
+	{"(d|/)ntp", 1},
+	{"()ntpd", 1},
+	/* brackets */
+	{"[Ww]eird", 1},
+	{"data[0-9]\\.dat", 1},
+	{"data[][]1[][]\\.dat", 1},
+	{"[^x]ort0012", 1},
+	{"[[:alpha:]]ort0001", 1},
+	{"lib[[:alpha:]]*\\.so", 1},
+	/* repetition */
+	{"colou?r", 1},
+	{"colou*r", 1},
+	{"colou+r", 1},
+	{"abc*de", 0},
+	{"ab+cde", 1},
+	{"a+bcd", 1},
+	{"xx{2}", 0},
+	{"x{2}", 0},
+	{"ab{1,3}cd", 0},
+	{"port0{2,}1", 1},
+	{"por?t0001", 1},
+	{"(por)?t0001", 1},
+	{"(po)*rt0012", 1},
+	{"(port)+0012", 1},
+	{"lib.*\\.so", 1},
+	{"perl5?/site", 1},
+	/* escapes */
+	{"a\\+b", 1},
+	{"abc\\?d", 1},
+	{"data\\[1\\]", 1},
+	{"c\\+\\+/v1", 1},
+	{"Weird\\|Pipe", 1},
+	{"c\\^d\\$e", 1},
+	{"back\\\\slash", 1},
+	{"a\\.b/c", 1},
+	{"\\.so\\.1", 1},
+	/* word and GNU buffer anchors are not literals */
+	{"\\<port0001", 1},
+	{"port0001\\>", 1},
+	{"\\`bin/port", 1},
+	{"README\\'", 1},
+	/* shorter than 3 characters */
+	{"", 0},
+	{"a", 0},
+	{"ab", 0},
+	{"ab.cd", 0},
+	{"a.b", 0},
+	{"^et", 0},
+	{"gz$", 0},
+	{"ab|cd", 0},
+};
+
+#define PATTERNS_CNT	(sizeof(patterns) / sizeof(patterns[0]))
+
+static int	failed;
+
+/*
+ * Report a failed check
+ */
+static void fail(const char *pattern, const char *fmt, const char *arg);
+
+/*
+ * Return nonzero if `key' is one of the trigrams of `str'
+ */
+static int has_key(const char *str, uint32_t key);
+
+/*
+ * Check the trigrams of `p' against all lines matching it, ignoring case
+ * if `icase' is set, since the index is case insensitive
+ */
+static void check_keys(const struct pattern_t *p, int icase);
+
+/*
+ * Check that tri_candidates() on index `t' returns every line matching
+ * `p'
+ */
+static void check_candidates(const struct tri_t *t,
+			     const struct pattern_t *p);
+
+/*
+ * Write an index over `lines' to `fn' and open it
+ */
+static void mkindex(struct tri_t **t, const char *fn);
+
+/***/
+
+int
+main(void)
+{
+	struct tri_t	*t;
+	char		fn[] = "/tmp/trigram_test.XXXXXX";
+	int		fd;
+	size_t		i;
+
+	if ((fd = mkstemp(fn)) == -1)
+		err(EX_CANTCREAT, "mkstemp(): %s", fn);
+	close(fd);
+
+	mkindex(&t, fn);
+
+	for (i = 0; i < PATTERNS_CNT; i++)
+	{
+		check_keys(&patterns[i], 0);
+		check_keys(&patterns[i], 1);
+		check_candidates(t, &patterns[i]);
+	}
+
+	tri_close(t);
+
+	unlink(fn);
+
+	if (failed)
+		return 1;
+
+	printf("trigram_test: %u patterns ok\n", (unsigned)PATTERNS_CNT);
+
+	return 0;
+}
+
+static void
+fail(const char *pattern, const char *fmt, const char *arg)
+{
+	fprintf(stderr, "trigram_test: %s: ", pattern);
+	fprintf(stderr, fmt, arg);
+	fprintf(stderr, "\n");
+
+	failed = 1;
+}
+
+static int
+has_key(const char *str, uint32_t key)
+{
+	uint32_t	*keys;
+	size_t		cnt, i;
+	int		found;
+
+	keys = (uint32_t *)xmalloc((strlen(str) + 1) * sizeof(uint32_t));
+
+	cnt = tri_str_keys(str, strlen(str), keys);
+
+	found = 0;
+	for (i = 0; i < cnt; i++)
+		if (keys[i] == key)
+			found = 1;
+
+	xfree(keys);
+
+	return found;
+}
+
+static void
+check_keys(const struct pattern_t *p, int icase)
+{
+	regex_t		re;
+	uint32_t	*keys;
+	size_t		keys_cnt;
+	size_t		i, k;
+	int		matched;
+
+	if (tri_pattern_keys(p->pattern, &keys, &keys_cnt) == -1)
+	{
+		keys = NULL;
+		keys_cnt = 0;
+	}
+
+	if ((keys_cnt > 0) != p->has_keys)
+		fail(p->pattern, "%s", p->has_keys ?
+		     "no trigrams extracted" : "unexpected trigrams extracted");
+
+	xregcomp(&re, p->pattern,
+		 REG_EXTENDED | REG_NOSUB | (icase ? REG_ICASE : 0));
+
+	matched = 0;
+	for (i = 0; i < LINES_CNT; i++)
+	{
+		if (regexec(&re, lines[i], 0, NULL, 0) != 0)
+			continue;
+
+		matched = 1;
+
+		for (k = 0; k < keys_cnt; k++)
+			if (!has_key(lines[i], keys[k]))
+				fail(p->pattern, "would drop %s", lines[i]);
+	}
+
+	if (!matched)
+		fail(p->pattern, "%s", "matches no line, add one");
+
+	xregfree(&re);
+
+	if (keys != NULL)
+		xfree(keys);
+}
+
+static void
+check_candidates(const struct tri_t *t, const struct pattern_t *p)
+{
+	regex_t		re;
+	uint32_t	*cand;
+	size_t		cand_cnt;
+	size_t		i, c;
+
+	/* no candidates means all lines are examined */
+	if (tri_candidates(t, p->pattern, &cand, &cand_cnt) == -1)
+		return;
+
+	xregcomp(&re, p->pattern, REG_EXTENDED | REG_NOSUB);
+
+	for (i = 0; i < LINES_CNT; i++)
+	{
+		if (regexec(&re, lines[i], 0, NULL, 0) != 0)
+			continue;
+
+		for (c = 0; c < cand_cnt && cand[c] != i; c++)
+			;
+		if (c == cand_cnt)
+			fail(p->pattern, "candidates miss %s", lines[i]);
+	}
+
+	xregfree(&re);
+
+	xfree(cand);
+}
+
+static void
+mkindex(struct tri_t **t, const char *fn)
+{
+	struct tri_new_t	*n;
+	size_t			offt;
+	size_t			i;
+
+	tri_new_start(&n);
+
+	/* offsets of lines in a plist file that is never written */
+	offt = 0;
+	for (i = 0; i < LINES_CNT; i++)
+	{
+		tri_new_add(n, lines[i], offt);
+		offt += strlen(lines[i]) + 1;
+	}
+
+	tri_new_end(n, offt, fn);
+
+	if (tri_open(t, fn, offt) == -1)
+		errx(EX_SOFTWARE, "tri_open(): %s", fn);
+}
+
+/* EOF */
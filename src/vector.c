@@ -34,36 +34,46 @@
 
 #include "vector.h"
 
+/* bytes reserved per element in the first chunk */
+#define V_ELEM_GUESS	64
+
+/* chunks are doubled up to this size */
+#define V_CHUNK_MAX	(64 * 1024)
+
+/* each element is preceded by its size and aligned like it */
+#define V_ALIGN(n)	(((n) + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1))
+
+/***/
+
+static struct v_chunk_t *new_chunk(struct vector_t *v, size_t need);
+
+/***/
+
 void
 v_start(struct vector_t *v, size_t initial_sz)
 {
-	size_t	malloc_bytes;
-
-	malloc_bytes = initial_sz * sizeof(void *);
-
-	if ((v->base = malloc(malloc_bytes)) == NULL)
-		err(EX_OSERR, "malloc(): %u", (unsigned)malloc_bytes);
-	v->base_sz = initial_sz;
+	v->head = v->tail = NULL;
+	v->chunk_sz = initial_sz * V_ELEM_GUESS;
+	if (v->chunk_sz > V_CHUNK_MAX)
+		v->chunk_sz = V_CHUNK_MAX;
 	v->nelems = 0;
 }
 
 void
 v_add(struct vector_t *v, const void *data, size_t size)
 {
-	size_t	realloc_bytes;
+	struct v_chunk_t	*c;
+	size_t			need;
 
-	if (v->nelems >= v->base_sz)
-	{
-		v->base_sz *= 2;
-		realloc_bytes = v->base_sz * sizeof(void *);
-		if ((v->base = realloc(v->base, realloc_bytes)) == NULL)
-			err(EX_OSERR, "realloc(): %u", (unsigned)realloc_bytes);
-	}
+	need = sizeof(size_t) + V_ALIGN(size);
 
-	if ((v->base[v->nelems] = malloc(size)) == NULL)
-		err(EX_OSERR, "malloc(): %u", (unsigned)size);
+	c = v->tail;
+	if (c == NULL || c->sz - c->used < need)
+		c = new_chunk(v, need);
 
-	memcpy(v->base[v->nelems], data, size);
+	memcpy(c->data + c->used, &size, sizeof(size_t));
+	memcpy(c->data + c->used + sizeof(size_t), data, size);
+	c->used += need;
 
 	v->nelems++;
 }
@@ -71,35 +81,86 @@ v_add(struct vector_t *v, const void *data, size_t size)
 void
 v_destroy(struct vector_t *v)
 {
-	size_t	i;
-
-	for (i = 0; i < v->nelems; i++)
-		free(v->base[i]);
+	struct v_chunk_t	*c;
+	struct v_chunk_t	*next;
 
-	free(v->base);
+	for (c = v->head; c != NULL; c = next)
+	{
+		next = c->next;
+		free(c);
+	}
 
-	v->base = NULL;
-	v->base_sz = v->nelems = 0;
+	v->head = v->tail = NULL;
+	v->chunk_sz = v->nelems = 0;
 }
 
 void
 vi_reset(struct vector_iterator_t *vi, const struct vector_t *v)
 {
 	vi->v = v;
+	vi->chunk = v->head;
+	vi->offt = 0;
 	vi->current = 0;
 }
 
 int
 vi_next(struct vector_iterator_t *vi, void **elem)
 {
+	size_t	size;
+
 	if (vi->current >= vi->v->nelems)
 		return 0;
 
-	*elem = vi->v->base[vi->current];
+	if (vi->offt >= vi->chunk->used)
+	{
+		vi->chunk = vi->chunk->next;
+		vi->offt = 0;
+	}
+
+	memcpy(&size, vi->chunk->data + vi->offt, sizeof(size_t));
 
+	*elem = (void *)(vi->chunk->data + vi->offt + sizeof(size_t));
+
+	vi->offt += sizeof(size_t) + V_ALIGN(size);
 	vi->current++;
 
 	return 1;
 }
 
+/*
+ * Append a chunk with room for at least `need' bytes to `v'
+ */
+static struct v_chunk_t *
+new_chunk(struct vector_t *v, size_t need)
+{
+	struct v_chunk_t	*c;
+	size_t			sz;
+	size_t			malloc_bytes;
+
+	sz = v->chunk_sz;
+	if (sz < need)
+		sz = need;
+
+	v->chunk_sz *= 2;
+	if (v->chunk_sz > V_CHUNK_MAX)
+		v->chunk_sz = V_CHUNK_MAX;
+
+	malloc_bytes = sizeof(struct v_chunk_t) + sz;
+
+	if ((c = malloc(malloc_bytes)) == NULL)
+		err(EX_OSERR, "malloc(): %u", (unsigned)malloc_bytes);
+
+	c->next = NULL;
+	c->sz = sz;
+	c->used = 0;
+
+	if (v->tail == NULL)
+		v->head = c;
+	else
+		v->tail->next = c;
+	v->tail = c;
+
+	return c;
+}
+
 /* EOF */
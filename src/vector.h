@@ -29,20 +29,36 @@
 
 #include <stdio.h>
 
+/*
+ * Elements are copied one after another into chunks, each one preceded
+ * by its size, so adding an element does not call malloc() unless the
+ * current chunk is full.
+ */
+struct v_chunk_t {
+	struct v_chunk_t	*next;
+	size_t			sz;  /* bytes in data[] */
+	size_t			used;
+	char			data[];
+};
+
 struct vector_t {
-	void	**base;
-	size_t	base_sz;
-	size_t	nelems;
+	struct v_chunk_t	*head;
+	struct v_chunk_t	*tail;
+	size_t			chunk_sz;  /* size of the next chunk */
+	size_t			nelems;
 };
 
 struct vector_iterator_t {
 	const struct vector_t	*v;
+	const struct v_chunk_t	*chunk;
+	size_t			offt;  /* of the next element in chunk */
 	size_t			current;
 };
 
 /*
- * Create vector with the specified initial size,
- * which must be greater than zero
+ * Create vector with the specified initial size (in elements),
+ * which must be greater than zero. Nothing is allocated until
+ * the first element is added.
  */
 void v_start(struct vector_t *v, size_t initial_sz);
 
@@ -52,7 +68,7 @@ void v_start(struct vector_t *v, size_t initial_sz);
 void v_add(struct vector_t *v, const void *data, size_t size);
 
 /*
- * Free resources, allocated by `v'
+ * Free resources, allocated by `v', all elements are freed at once
  */
 void v_destroy(struct vector_t *v);
 